@@ -0,0 +1,209 @@
+// Throughput of the parsing and transpose passes over generated CSVs.
+//
+//   tabular_bench [--benchmark_filter=FindRowOffsets] [google benchmark flags]
+//
+// Every case reports bytes_per_second and a GB/s counter over the CSV bytes
+// the pass reads. Datasets are generated once into TABULAR_BENCH_DIR
+// (default: <tmp>/tabular_bench) and reused by later runs. CHUNK_SIZE and
+// COLUMNS_PER_CHUNK are compile-time; the TABULAR_BENCH_VARIANTS CMake list
+// builds one tabular_bench_<chunk>_<cols> per setting, and the values a
+// binary was built with are printed in its context block.
+#include <benchmark/benchmark.h>
+#include "TabularData/TabularData.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace fs = std::filesystem;
+using tabular::TabularData;
+
+namespace {
+
+// What a generated CSV looks like. Every cell is drawn from `cardinality`
+// distinct values of its column; quotePct percent of the cells are quoted,
+// with an embedded delimiter and then a doubled quote or, in every fourth
+// one, a line break, so the scanner's quote handling is exercised at that
+// density.
+struct Shape {
+    std::uint64_t rows;
+    std::uint32_t cols;
+    std::uint32_t quotePct;
+    bool crlf;
+    std::uint32_t cardinality;
+
+    std::string name() const {
+        return "r" + std::to_string(rows) + "_c" + std::to_string(cols) + "_q" + std::to_string(quotePct)
+            + (crlf ? "_crlf" : "_lf") + "_k" + std::to_string(cardinality);
+    }
+};
+
+fs::path bench_dir() {
+    const char* env = std::getenv("TABULAR_BENCH_DIR");
+    return env && *env ? fs::path(env) : fs::temp_directory_path() / "tabular_bench";
+}
+
+// deterministic, so a dataset is the same file on every machine
+struct SplitMix {
+    std::uint64_t s;
+    std::uint64_t next() {
+        std::uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+// path of the CSV for `shape`, written on first use
+std::string dataset(const Shape& shape) {
+    const fs::path path = bench_dir() / (shape.name() + ".csv");
+    if (fs::exists(path)) return path.string();
+    fs::create_directories(path.parent_path());
+
+    const fs::path tmp = path.string() + ".part";
+    std::ofstream out(tmp, std::ios::binary);
+    if (!out) throw std::runtime_error("Cannot write " + tmp.string());
+    const char* eol = shape.crlf ? "\r\n" : "\n";
+    SplitMix rng{shape.rows * 31 + shape.cols};
+    std::string line;
+
+    for (std::uint32_t c = 0; c < shape.cols; ++c) {
+        if (c) line += ',';
+        line += "col_" + std::to_string(c);
+    }
+    out << line << eol;
+
+    for (std::uint64_t r = 0; r < shape.rows; ++r) {
+        line.clear();
+        for (std::uint32_t c = 0; c < shape.cols; ++c) {
+            if (c) line += ',';
+            const std::uint64_t x = rng.next();
+            const std::string value = std::to_string(x % shape.cardinality);
+            if ((x >> 32) % 100 < shape.quotePct) {
+                line += "\"v,";
+                line += value;
+                line += ((x >> 40) & 3) ? "\"\"q\"" : "\n\"";
+            } else {
+                line += value;
+            }
+        }
+        line += eol;
+        out << line;
+    }
+    out.close();
+    if (!out) throw std::runtime_error("Cannot write " + tmp.string());
+    fs::rename(tmp, path);
+    return path.string();
+}
+
+std::string output_dir(const std::string& csv) {
+    const fs::path dir = fs::path(csv).replace_extension(".out");
+    fs::create_directories(dir);
+    return dir.string();
+}
+
+void set_throughput(benchmark::State& state, std::uint64_t bytes) {
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes));
+    state.counters["GB/s"] = benchmark::Counter(static_cast<double>(bytes) / 1e9,
+                                                benchmark::Counter::kIsIterationInvariantRate);
+}
+
+unsigned threads_arg(const benchmark::State& state, int i) { return static_cast<unsigned>(state.range(i)); }
+
+// ---- cases ----
+
+// args: columns
+void BM_ParseHeaderRow(benchmark::State& state) {
+    const Shape shape{1, static_cast<std::uint32_t>(state.range(0)), 0, false, 1};
+    const std::string csv = dataset(shape);
+    const std::string out = output_dir(csv);
+    std::string header;
+    std::getline(std::ifstream(csv, std::ios::binary), header);
+    for (auto _ : state) {
+        TabularData td(csv, out);
+        td.parseHeaderRow();
+        benchmark::DoNotOptimize(td.getColumnCount());
+    }
+    set_throughput(state, header.size() + 1);
+}
+
+// args: threads, quotePct, crlf
+void BM_FindRowOffsets(benchmark::State& state) {
+    const Shape shape{400000, 16, static_cast<std::uint32_t>(state.range(1)), state.range(2) != 0, 1000};
+    const std::string csv = dataset(shape);
+    TabularData td(csv, output_dir(csv));
+    td.setThreadCount(threads_arg(state, 0));
+    td.setWriteRowOffsets(false);
+    td.parseHeaderRow();
+    for (auto _ : state) {
+        td.findRowOffsets();
+        benchmark::DoNotOptimize(td.rowOffsets().data());
+    }
+    state.counters["rows"] = td.getRowCount();
+    set_throughput(state, fs::file_size(csv));
+}
+
+// args: threads, columns, cardinality
+void BM_MapIntTranspose(benchmark::State& state) {
+    const auto cols = static_cast<std::uint32_t>(state.range(1));
+    const Shape shape{6400000 / cols, cols, 5, false, static_cast<std::uint32_t>(state.range(2))};
+    const std::string csv = dataset(shape);
+    TabularData td(csv, output_dir(csv));
+    td.setThreadCount(threads_arg(state, 0));
+    td.setWriteRowOffsets(false);
+    td.parseHeaderRow();
+    td.findRowOffsets();
+    for (auto _ : state) td.mapIntTranspose();
+    set_throughput(state, fs::file_size(csv));
+}
+
+// args: threads, cardinality
+void BM_ScanAndTranspose(benchmark::State& state) {
+    const Shape shape{400000, 16, 5, false, static_cast<std::uint32_t>(state.range(1))};
+    const std::string csv = dataset(shape);
+    TabularData td(csv, output_dir(csv));
+    td.setThreadCount(threads_arg(state, 0));
+    td.setWriteRowOffsets(false);
+    for (auto _ : state) td.scanAndTranspose();
+    set_throughput(state, fs::file_size(csv));
+}
+
+} // end anon
+
+BENCHMARK(BM_ParseHeaderRow)->ArgNames({"cols"})->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_FindRowOffsets)
+    ->ArgNames({"threads", "quote%", "crlf"})
+    ->ArgsProduct({{1, 2, 4, 8}, {0, 5, 50}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(BM_MapIntTranspose)
+    ->ArgNames({"threads", "cols", "card"})
+    ->ArgsProduct({{1, 2, 4, 8}, {16, 256}, {16, 100000}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(BM_ScanAndTranspose)
+    ->ArgNames({"threads", "card"})
+    ->ArgsProduct({{1, 2, 4, 8}, {16, 100000}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::AddCustomContext("CHUNK_SIZE", std::to_string(CHUNK_SIZE));
+#ifdef COLUMNS_PER_CHUNK
+    benchmark::AddCustomContext("COLUMNS_PER_CHUNK", std::to_string(COLUMNS_PER_CHUNK));
+#else
+    benchmark::AddCustomContext("COLUMNS_PER_CHUNK", "library default");
+#endif
+    benchmark::AddCustomContext("datasets", bench_dir().string());
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
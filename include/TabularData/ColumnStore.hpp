@@ -0,0 +1,214 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "TabularData/InputSource.hpp"
+
+namespace tabular {
+
+// ============================ on-disk format ============================
+//
+// mapIntTranspose() writes <outputDir>/columns/:
+//
+//   manifest.bin        which chunk file holds which columns
+//   chunk-NNNNN.tdc     one file per column chunk
+//
+// All integers are little-endian. Sections start on 8-byte boundaries.
+//
+// manifest.bin
+//   u32 magic   'TDCM'
+//   u32 version kColumnStoreVersion
+//   u64 rowCount
+//   u32 colCount
+//   u32 chunkCount
+//   chunkCount x { u32 firstCol, u32 ncols, u64 bytes }
+//                 chunk k is chunk-<k>.tdc; its first `bytes` bytes are the
+//                 chunk, anything past them is ignored
+//
+// chunk-NNNNN.tdc
+//   the columns' runs, each either
+//     ids         rows x <width> bytes, width 1, 2 or 4: the narrowest
+//                 that holds dictCount ids plus the all-ones value, which
+//                 marks a missing cell. id = index into the dictionary
+//   or a dictionary run
+//     dict index  (count + 1) x u64, offsets into the run's dict bytes
+//     dict bytes  concatenated values; value firstId + i =
+//                 bytes[index[i], index[i+1]) (in byte order across the
+//                 runs when the entry has kDictSorted)
+//   footer      ncols x ColumnEntry, then per column its idRuns x IdRun
+//               and dictRuns x DictRun
+//   trailer     ChunkTrailer (the last 24 of the chunk's bytes)
+//
+// A column's id runs cover its rows in order, its dictionary runs its ids.
+// mapIntTranspose() writes one of each. TabularData::refresh() appends the
+// new rows and dictionary entries as one more of each behind the chunk's
+// sections, then a new footer and trailer, and commits them by raising
+// `bytes` in the manifest; a column rewritten whole leaves its old runs
+// (and every refresh the old footer) as dead bytes, until the chunk holds
+// more dead bytes than live ones and is copied to a fresh file with one
+// run of each per column.
+//
+// Columns of a type other than String (type inference, see
+// TabularData::setTypeInference) keep native values in place of the ids
+// and an empty dictionary:
+//   Int64    i64, INT64_MIN when missing
+//   Float64  f64, NaN when missing
+//   Bool     u8 0 / 1, 0xFF when missing
+//   Date     i32 days since 1970-01-01, INT32_MIN when missing
+
+inline constexpr std::uint32_t kManifestMagic      = 0x4D434454; // "TDCM"
+inline constexpr std::uint32_t kChunkMagic         = 0x4B434454; // "TDCK"
+inline constexpr std::uint32_t kColumnStoreVersion = 3;
+inline constexpr std::uint32_t kDictSorted         = 1;          // ColumnEntry::flags
+
+enum class ColumnType : std::uint32_t { String = 0, Int64 = 1, Float64 = 2, Bool = 3, Date = 4 };
+
+struct ColumnEntry {
+    std::uint32_t column;      // absolute column index
+    std::uint32_t width;       // bytes per id or value
+    std::uint32_t type;        // ColumnType
+    std::uint32_t flags;       // kDictSorted
+    std::uint64_t rowCount;
+    std::uint64_t dictCount;
+    std::uint32_t idRuns;
+    std::uint32_t dictRuns;
+};
+static_assert(sizeof(ColumnEntry) == 40, "ColumnEntry layout is part of the file format");
+
+struct IdRun {
+    std::uint64_t firstRow;
+    std::uint64_t rows;
+    std::uint64_t offset;      // of the ids
+};
+static_assert(sizeof(IdRun) == 24, "IdRun layout is part of the file format");
+
+struct DictRun {
+    std::uint64_t firstId;
+    std::uint64_t count;
+    std::uint64_t indexOffset;
+    std::uint64_t bytesOffset;
+    std::uint64_t bytes;       // index[count]
+};
+static_assert(sizeof(DictRun) == 40, "DictRun layout is part of the file format");
+
+struct ChunkTrailer {
+    std::uint64_t footerOffset;
+    std::uint32_t ncols;
+    std::uint32_t version;
+    std::uint32_t magic;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(ChunkTrailer) == 24, "ChunkTrailer layout is part of the file format");
+
+// ============================== reader ==================================
+
+// Read-only access to a persisted transpose. Chunk files are mmap'd; ids and
+// dictionary values are served straight from the mapping.
+class ColumnStore {
+    struct DictLookup;
+
+public:
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+
+    class Column {
+    public:
+        u32 index() const { return _entry.column; }
+        u64 rowCount() const { return _entry.rowCount; }
+        u32 width() const { return _entry.width; }
+        u64 dictionarySize() const { return _entry.dictCount; }
+        ColumnType type() const { return static_cast<ColumnType>(_entry.type); }
+        // dictionary values in byte order (TabularData::setSortedDictionaries)
+        bool sortedDictionary() const { return _entry.flags & kDictSorted; }
+
+        // String columns only (std::logic_error otherwise):
+        // dictionary id of a row's value, or -1 for a missing cell
+        std::int64_t id(u64 row) const;
+        std::string_view value(u64 id) const;
+        // value of a row ("" for a missing cell)
+        std::string_view cell(u64 row) const;
+        // dictionary id of `value`, or -1 if it never occurs: a binary
+        // search of a sorted dictionary, else one probe of a hash index
+        // built over the dictionary on the column's first find()
+        std::int64_t find(std::string_view value) const;
+        // ids [first, second) of the values in [lo, hi]; sorted
+        // dictionaries only (std::logic_error otherwise)
+        std::pair<u64,u64> findRange(std::string_view lo, std::string_view hi) const;
+
+        bool isMissing(u64 row) const;
+        // Int64, Bool (0 / 1) and Date (days since 1970-01-01) cells,
+        // INT64_MIN when missing
+        std::int64_t int64(u64 row) const;
+        // Float64 and Int64 cells, NaN when missing
+        double float64(u64 row) const;
+        // any cell as text: numbers in shortest round-trip form, dates as
+        // YYYY-MM-DD, "" when missing
+        std::string text(u64 row) const;
+
+        // The ids (or the values of a typed column) as stored: runs of
+        // consecutive rows, each contiguous at width(). One per refresh()
+        // since the column was last written whole.
+        struct Run {
+            u64 firstRow;
+            u64 rows;
+            const void* cells;
+        };
+        u32 runCount() const { return _entry.idRuns; }
+        Run run(u32 k) const { return {_ids[k].firstRow, _ids[k].rows, _base + _ids[k].offset}; }
+
+    private:
+        friend class ColumnStore;
+        Column(const char* base, const ColumnEntry& e, const IdRun* ids, const DictRun* dict, DictLookup* lookup)
+            : _base(base), _entry(e), _ids(ids), _dict(dict), _lookup(lookup) {}
+        const char* cellAt(u64 row) const;
+        const char* _base;
+        ColumnEntry _entry;
+        const IdRun* _ids;
+        const DictRun* _dict;
+        DictLookup* _lookup; // the store's hash index of this column's dictionary
+    };
+
+    explicit ColumnStore(const std::string& outputDir);
+
+    u64 rowCount() const { return _rowCount; }
+    u32 columnCount() const { return _colCount; }
+    Column column(u32 col) const;
+    // chunk files, in column order; chunkColumns(k) is {firstCol, ncols}
+    u32 chunkCount() const { return static_cast<u32>(_chunks.size()); }
+    std::pair<u32,u32> chunkColumns(u32 chunk) const;
+
+private:
+    // open-addressing table of id + 1 (0: free slot), keyed by Dictionary::hash
+    struct DictLookup {
+        std::once_flag built;
+        std::vector<u32> slots;
+    };
+
+    struct Chunk {
+        std::shared_ptr<InputSource> file;
+        std::vector<char> copy;          // only for unmapped sources
+        const char* base = nullptr;
+        u64 bytes = 0;
+        u32 firstCol = 0;
+        std::vector<ColumnEntry> entries;
+        std::vector<IdRun> idRuns;       // every column's, in column order
+        std::vector<DictRun> dictRuns;
+        std::vector<u32> firstIdRun;     // [column]
+        std::vector<u32> firstDictRun;
+        std::unique_ptr<DictLookup[]> lookups; // [column], built on a String column's first find()
+    };
+
+    friend class ColumnStoreWriter; // extends the chunks in place
+
+    u64 _rowCount = 0;
+    u32 _colCount = 0;
+    std::vector<Chunk> _chunks;
+};
+
+} // namespace tabular
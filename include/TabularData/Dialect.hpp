@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+
+namespace tabular {
+
+// How fields and rows are delimited. Rows always end at LF, CR or CRLF
+// outside quotes. The common dialects (comma, tab or pipe delimited, '"'
+// quoted, no escape or comment) run on parsers specialized for them at
+// compile time; any other combination uses a generic runtime-configured one.
+struct Dialect {
+    char delimiter = ',';
+    // '\0': fields are never quoted
+    char quote = '"';
+    // '\0': a quote inside a quoted field is written twice (""); otherwise
+    // this byte makes the next one literal, in or out of quotes
+    char escape = '\0';
+    // '\0': none; otherwise a row starting with this byte is skipped up to
+    // its line terminator, quotes and escapes inside it included
+    char comment = '\0';
+
+    static constexpr Dialect csv()  { return {}; }
+    static constexpr Dialect tsv()  { return {'\t', '"', '\0', '\0'}; }
+    static constexpr Dialect pipe() { return {'|', '"', '\0', '\0'}; }
+
+    // needs the generic parser: an escape or comment byte
+    constexpr bool generic() const { return escape != '\0' || comment != '\0'; }
+
+    // throws std::invalid_argument when two roles share a byte, or a role is
+    // taken by CR / LF (or the delimiter by '\0')
+    void validate() const;
+
+    // the four bytes, delimiter lowest: a stable id for index files
+    std::uint32_t pack() const {
+        return std::uint32_t(std::uint8_t(delimiter)) | std::uint32_t(std::uint8_t(quote)) << 8
+             | std::uint32_t(std::uint8_t(escape)) << 16 | std::uint32_t(std::uint8_t(comment)) << 24;
+    }
+
+    friend constexpr bool operator==(const Dialect& a, const Dialect& b) {
+        return a.delimiter == b.delimiter && a.quote == b.quote && a.escape == b.escape && a.comment == b.comment;
+    }
+    friend constexpr bool operator!=(const Dialect& a, const Dialect& b) { return !(a == b); }
+};
+
+} // namespace tabular
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tabular {
+
+// What a scan does with a data row whose field count isn't the header's
+// (TabularData::setFaultyRowMode()).
+enum class FaultyRowMode {
+    Skip,   // leave it out of the index
+    Fail,   // throw FaultyRowsError at the first one
+    Record, // leave it out and list it in faulty_rows.bin
+};
+
+struct FaultyRow {
+    std::uint64_t offset = 0; // where the row starts, as rowOffsets() counts
+    std::uint32_t found = 0;  // its field count
+};
+
+// ============================ on-disk format ============================
+//
+// A scan in FaultyRowMode::Record writes <outputDir>/faulty_rows.bin, an
+// empty list for a clean file. All integers are little-endian.
+//
+//   u32 magic     'TDFR'
+//   u32 version   1
+//   u64 count
+//   u32 expected  fields per row, the header's
+//   u32 reserved
+//   count x { u64 offset, u32 found, u32 reserved }, ascending offset
+struct FaultyRowReport {
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+
+    static constexpr u32 kMagic   = 0x52464454; // "TDFR"
+    static constexpr u32 kVersion = 1;
+
+    u32 expected = 0;
+    std::vector<FaultyRow> rows;
+
+    static std::string path(const std::string& outputDir);
+    // false if the file is missing or unreadable
+    static bool load(const std::string& outputDir, FaultyRowReport& out);
+    void save(const std::string& outputDir) const;
+    static void remove(const std::string& outputDir);
+};
+
+// A scan gave up on faulty rows: at the first one in FaultyRowMode::Fail,
+// or in Record mode once more than the limit were found (faulty_rows.bin
+// then lists the ones found up to that point).
+class FaultyRowsError : public std::runtime_error {
+public:
+    FaultyRowsError(const std::string& what, FaultyRow first, std::uint32_t expected, std::uint64_t count)
+        : std::runtime_error(what), _first(first), _expected(expected), _count(count) {}
+
+    // the faulty row with the lowest offset found
+    const FaultyRow& first() const { return _first; }
+    std::uint32_t expected() const { return _expected; }
+    // faulty rows found before the scan stopped
+    std::uint64_t count() const { return _count; }
+
+private:
+    FaultyRow _first;
+    std::uint32_t _expected;
+    std::uint64_t _count;
+};
+
+} // namespace tabular
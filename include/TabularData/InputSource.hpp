@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tabular {
+
+// How a CSV file is opened for reading. Auto maps regular files and falls
+// back to buffered stream reads for anything mmap() refuses (pipes, procfs,
+// empty files, platforms without mmap). For compressed input the mode
+// applies to the compressed bytes.
+enum class InputMode { Auto, Mmap, Stream };
+
+// Read-only, random-access view of the input bytes shared by every pass.
+// Implementations are safe to call from multiple threads concurrently.
+class InputSource {
+public:
+    virtual ~InputSource() = default;
+
+    virtual std::uint64_t size() const = 0;
+
+    // True when read() returns views aliasing the mapping (zero-copy).
+    virtual bool isMapped() const = 0;
+
+    // View of up to `len` bytes starting at `offset`; shorter at EOF and empty
+    // past it. Mapped sources leave `scratch` alone and the view lives as long
+    // as the source; otherwise bytes are copied into `scratch` and the view is
+    // valid until `scratch` is next reused.
+    virtual std::string_view read(std::uint64_t offset, std::size_t len,
+                                  std::vector<char>& scratch) const = 0;
+
+    // Copy up to `len` bytes starting at `offset` into `dst`; returns the
+    // count, shorter only at EOF.
+    virtual std::size_t readInto(std::uint64_t offset, std::size_t len, char* dst) const;
+
+    // True when read() does real I/O worth overlapping with parsing.
+    virtual bool prefersReadAhead() const { return false; }
+    // File descriptor readInto() preads from, or -1.
+    virtual int nativeHandle() const { return -1; }
+
+    // Access pattern hints (madvise). No-ops for unmapped sources.
+    virtual void adviseSequential(std::uint64_t /*offset*/, std::uint64_t /*len*/) const {}
+    virtual void adviseWillNeed(std::uint64_t /*offset*/, std::uint64_t /*len*/) const {}
+
+    const std::string& path() const { return _path; }
+
+protected:
+    explicit InputSource(std::string path) : _path(std::move(path)) {}
+
+private:
+    std::string _path;
+};
+
+// Opens `path` in `mode`. A gzip file (recognized by its magic bytes, not
+// its name) reads as its decompressed bytes: the first open decodes it once
+// to build a seek index, kept in `indexPath` unless that is empty, so later
+// opens and every random read skip straight to the nearest access point.
+// zstd input is recognized and refused with std::runtime_error.
+std::shared_ptr<InputSource> openInputSource(const std::string& path,
+                                             InputMode mode = InputMode::Auto,
+                                             const std::string& indexPath = {});
+
+// Regular files matching `pattern`, sorted by path. '*' and '?' match within
+// the last path component only ("data/2024-*.csv"); a pattern without them
+// names one file.
+std::vector<std::string> globFiles(const std::string& pattern);
+
+// Walks [start, stop) of a source as a sequence of spans. Mapped sources hand
+// out CHUNK_SIZE windows of the mapping (prefetching the next one); stream
+// sources fill a private CHUNK_SIZE buffer, and from the second span on keep
+// READ_AHEAD_DEPTH further spans in flight (see PendingRead).
+class SpanReader {
+public:
+    SpanReader(const InputSource& src, std::uint64_t start, std::uint64_t stop);
+    ~SpanReader();
+    SpanReader(const SpanReader&) = delete;
+    SpanReader& operator=(const SpanReader&) = delete;
+
+    // Next span and the absolute offset of its first byte; false at stop.
+    bool next(std::string_view& span, std::uint64_t& spanOffset);
+
+    // Byte at an absolute offset, or -1 past EOF. Does not disturb next().
+    int peek(std::uint64_t offset);
+
+private:
+    struct ReadAhead;
+
+    const InputSource& _src;
+    std::uint64_t _pos;
+    std::uint64_t _stop;
+    std::vector<char> _buf;
+    std::vector<char> _peekBuf;
+    std::unique_ptr<ReadAhead> _ahead;
+    bool _started = false;
+};
+
+} // namespace tabular
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace tabular {
+
+// Timed stages of the parsing passes. Header, Merge, DictionaryMerge and
+// Write run on the calling thread; Resync, SliceParse and TransposeChunk run
+// on the workers and sum their threads' time.
+enum class Phase {
+    Header,          // parseHeaderRow()
+    Resync,          // quote-parity pre-pass and finding each morsel's first row
+    SliceParse,      // parsing morsels into row offsets (and fused columns)
+    Merge,           // stitching the morsels' offsets into the index
+    TransposeChunk,  // tokenizing and encoding a column chunk's rows
+    DictionaryMerge, // local -> global dictionaries and relabelling
+    Write,           // writing a chunk to the column store
+};
+inline constexpr std::size_t kPhaseCount = 7;
+const char* phaseName(Phase phase);
+
+// What the last runs of TabularData's passes did, accumulated since
+// resetMetrics(). Per-slice and per-chunk entries point at stragglers.
+struct Metrics {
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+
+    struct PhaseStats {
+        double wallSeconds = 0; // thread-seconds for worker phases
+        double cpuSeconds  = 0; // process CPU (calling-thread phases) or thread CPU (worker phases)
+        u64 calls = 0;
+    };
+
+    // one findRowOffsets morsel
+    struct Slice {
+        u64 begin = 0, end = 0; // bytes parsed, [begin, end)
+        u64 rows = 0;
+        u32 worker = 0;
+        double seconds = 0;     // resync + parse, including a re-parse
+        bool reparsed = false;  // the resync guessed the quote state wrong
+    };
+
+    // one mapIntTranspose column chunk (the fused one included)
+    struct Chunk {
+        u32 firstCol = 0, ncols = 0;
+        double seconds = 0;          // wall, all steps
+        double imbalance = 1;        // slowest / mean worker time tokenizing its rows
+        u64 bytes = 0;               // bytes tokenized
+        u64 dictionaryEntries = 0;   // distinct values over the chunk's String columns
+        u64 dictionaryBytes = 0;     // their global dictionaries' heap bytes
+        u64 memoryBytes = 0;         // ids, dictionaries and typed values held at once
+    };
+
+    PhaseStats phases[kPhaseCount];
+    const PhaseStats& phase(Phase p) const { return phases[static_cast<std::size_t>(p)]; }
+    void addPhase(Phase p, double wallSeconds, double cpuSeconds) {
+        PhaseStats& s = phases[static_cast<std::size_t>(p)];
+        s.wallSeconds += wallSeconds;
+        s.cpuSeconds += cpuSeconds;
+        ++s.calls;
+    }
+    void addPhase(Phase p, const PhaseStats& add) {
+        PhaseStats& s = phases[static_cast<std::size_t>(p)];
+        s.wallSeconds += add.wallSeconds;
+        s.cpuSeconds += add.cpuSeconds;
+        s.calls += add.calls;
+    }
+
+    u64 bytesRead = 0;          // input bytes tokenized by every pass
+    u64 rows = 0;               // data rows indexed
+    u64 faultyRows = 0;         // last scan: rows left out for their field count
+    double scanSeconds = 0;     // findRowOffsets / the scan of scanAndTranspose, wall
+    double transposeSeconds = 0;
+    double scanImbalance = 1;   // slowest / mean worker busy time of the last scan
+    std::vector<double> workerSeconds; // last scan, per worker
+    std::vector<Slice> slices;  // last scan, morsel order
+    std::vector<Chunk> chunks;  // last transpose, column order
+
+    u64 dictionaryEntries = 0;  // last transpose, all columns
+    u64 dictionaryBytes = 0;
+    u64 largestDictionary = 0;  // entries of the largest column dictionary
+    u64 peakChunkBytes = 0;     // largest Chunk::memoryBytes
+    u64 peakRssBytes = 0;       // process high-water mark, when the platform reports it
+
+    // rows / (scanSeconds + transposeSeconds)
+    double rowsPerSecond() const;
+
+    std::string toJson() const;
+};
+
+} // namespace tabular
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "TabularData/ColumnStore.hpp"
+
+namespace tabular {
+
+// What TabularData::profile() made of a few evenly spaced blocks of the
+// input: enough to size a job before committing cores to it. Everything
+// but the sampled counts is an estimate unless `exact`.
+struct DataProfile {
+    using u64 = std::uint64_t;
+
+    struct Column {
+        // the type every sampled cell fits (see setTypeInference()); String
+        // once one doesn't, or when no cell had a value
+        ColumnType type = ColumnType::String;
+        // some cell read from a known row start (the first block, or any
+        // block of a dialect without quotes and escapes) fits no type, so
+        // the whole column is String; later passes skip trying
+        bool provenString = false;
+        u64 sampleDistinct = 0; // HyperLogLog estimate over the sampled cells
+        // sampleDistinct extrapolated to the whole file: a column whose
+        // sample is mostly distinct keeps growing with the rows, one that
+        // repeats itself doesn't
+        u64 distinct = 0;
+        double avgBytes = 0;    // mean raw cell length
+    };
+
+    u64 fileBytes = 0;
+    u64 sampledBytes = 0;  // bytes of the sampled rows
+    u64 sampledRows = 0;   // non-blank rows sampled
+    u64 estimatedRows = 0; // data rows in the file
+    double avgRowBytes = 0;
+    bool exact = false;    // the sample was the whole file: estimatedRows is the row count
+    double seconds = 0;    // wall time profile() took
+    std::vector<Column> columns;
+};
+
+} // namespace tabular
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "TabularData/ColumnStore.hpp"
+
+namespace tabular {
+
+// Conjunctive filters and a projection over a ColumnStore. Predicates take
+// values as text (what Column::text() prints) and are resolved against each
+// column once: a String column through its dictionary, to an id range or an
+// id lookup table; a typed column by parsing the value to its type. The
+// filter then runs as fixed-width integer (or double) compares over the
+// stored ids / values, 64 rows per selection-bitmap word. Missing cells
+// never match.
+//
+//   Query q(store);
+//   q.select({0, 3}).whereEquals(2, "red").whereRange(5, "10", "20");
+//   for (auto row : q.rowIds()) ...
+class Query {
+public:
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+
+    explicit Query(const ColumnStore& store) : _store(store) {}
+
+    // columns values() returns, in this order (default: every column)
+    Query& select(std::vector<u32> columns);
+
+    Query& whereEquals(u32 col, std::string_view value);
+    Query& whereIn(u32 col, std::vector<std::string> values);
+    // lo <= cell <= hi: byte order for String columns, numeric / date
+    // order for typed ones
+    Query& whereRange(u32 col, std::string_view lo, std::string_view hi);
+
+    // matching rows, ascending
+    std::vector<u64> rowIds() const;
+    u64 count() const;
+    // [projected column][matching row] as Column::text()
+    std::vector<std::vector<std::string>> values() const;
+
+private:
+    enum class Op { Equals, In, Range };
+    struct Predicate {
+        u32 col;
+        Op op;
+        std::vector<std::string> values; // Equals: 1, In: n, Range: {lo, hi}
+    };
+
+    // selection bitmap, ceil(rowCount / 64) words
+    std::vector<u64> evaluate() const;
+    void apply(const Predicate& p, std::vector<u64>& sel) const;
+
+    const ColumnStore& _store;
+    std::vector<u32> _columns;
+    bool _selected = false;
+    std::vector<Predicate> _where;
+};
+
+} // namespace tabular
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TabularData/InputSource.hpp"
+
+namespace tabular {
+
+// ============================ on-disk format ============================
+//
+// findRowOffsets() writes <outputDir>/row_offsets.bin: the start offset of
+// every data row, in blocks of kRowOffsetBlockRows rows. A block keeps its
+// first offset in the directory and the remaining rows as frame-of-reference
+// bit-packed deltas (offset[i] - offset[i-1] - minDelta), so a row costs
+// about log2(spread of row lengths) bits instead of 64.
+//
+// All integers are little-endian.
+//
+//   u32 magic         'TDRO'
+//   u32 version       kRowOffsetIndexVersion
+//   u64 rowCount
+//   u32 blockRows
+//   u32 reserved
+//   u64 dataBytes
+//   directory         ceil(rowCount / blockRows) x { u64 firstOffset, u64 dataPos }
+//   data              per block, at dataPos from the start of data:
+//                       varint minDelta, u8 bits,
+//                       (rows in block - 1) x <bits> bits, LSB first
+//                     followed by 16 zero bytes of padding
+//
+// A file without the magic is read as the older format, a flat u64 array.
+
+inline constexpr std::uint32_t kRowOffsetMagic        = 0x4F524454; // "TDRO"
+inline constexpr std::uint32_t kRowOffsetIndexVersion = 1;
+inline constexpr std::uint32_t kRowOffsetBlockRows    = 128;
+
+// Read-only view of row_offsets.bin. The file is mmap'd; offset(row) seeks
+// through the directory and decodes at most one block.
+class RowOffsetIndex {
+public:
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+
+    explicit RowOffsetIndex(const std::string& path);
+
+    u64 rowCount() const { return _rowCount; }
+    u64 offset(u64 row) const;
+    // every offset, in row order
+    std::vector<u64> decode() const;
+
+    static void write(const std::string& path, const u64* offsets, u64 count);
+
+private:
+    struct DirEntry {
+        u64 firstOffset;
+        u64 dataPos;
+    };
+
+    // decodes rows [block*blockRows, +n) of a block into out
+    void decodeBlock(u64 block, u32 n, u64* out) const;
+
+    std::shared_ptr<InputSource> _file;
+    std::vector<char> _copy;            // only for unmapped sources
+    const unsigned char* _data = nullptr;
+    const DirEntry* _dir = nullptr;
+    const u64* _legacy = nullptr;       // flat u64 array of the old format
+    u64 _rowCount = 0;
+    u32 _blockRows = kRowOffsetBlockRows;
+};
+
+} // namespace tabular
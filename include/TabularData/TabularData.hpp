@@ -1,11 +1,25 @@
 #pragma once
 #include <cstdint>
 #include <cstddef>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <future>
+#include <mutex>
 #include <utility>
+#include <vector>
+
+#include "TabularData/Dialect.hpp"
+#include "TabularData/FaultyRows.hpp"
+#include "TabularData/InputSource.hpp"
+#include "TabularData/Metrics.hpp"
+#include "TabularData/Profile.hpp"
 
 namespace tabular {
 
+class PartitionedSource;
+class ThreadPool;
+
 class TabularData {
 public:
     int colCount = -1;
@@ -14,36 +28,206 @@ public:
     using u32 = std::uint32_t;
     using u16 = std::uint16_t;
 
+    // A gzip-compressed CSV (or partition) is read through its decompressed
+    // bytes; row offsets count those, and the seek index that makes them
+    // cheap to reach is kept as <outputDir>/input_index.bin (input_index_<i>.bin
+    // per partition).
     TabularData(std::string csvPath, std::string outputDir);
     TabularData(std::string csvPath, std::string outputDir, bool createStandAloneFiles);
+    // Dataset mode: partitions with identical header rows (e.g. globFiles()
+    // of daily exports), indexed as one table. Every pass runs over all of
+    // them at once, so morsels of different files share the worker threads,
+    // and each column gets one dictionary across the partitions. Row offsets
+    // are virtual (see rowLocation()). A partition must not end inside a
+    // quoted field. Throws std::runtime_error, once the input is opened, if
+    // a partition's header row differs from the first one's.
+    TabularData(std::vector<std::string> csvPaths, std::string outputDir, bool createStandAloneFiles = true);
+    ~TabularData();
 
     void createHeaderJSON();
     void parseHeaderRow();
 
+    // Header names are loaded once (from the CSV, or headers.json in
+    // standalone mode) and served from memory afterwards.
     std::string getHeader(std::size_t colNum) const;
+    // first column with this header name, or -1
+    std::int64_t findColumn(std::string_view name) const;
 
     const std::string& csvPath()   const { return _csvPath;   }
+    const std::vector<std::string>& csvPaths() const { return _csvPaths; }
     const std::string& outputDir() const { return _outputDir; }
     const u32 getColumnCount() const;
     const u32 getCCcount() const { return colCount; }
     void findRowOffsets() ;
     const u32 getRowCount() const;
     void mapIntTranspose();
+    // parseHeaderRow() + findRowOffsets() + mapIntTranspose(), tokenizing
+    // and encoding the first COLUMNS_PER_CHUNK columns while the row offsets
+    // are found, so the data rows are read once instead of twice.
+    void scanAndTranspose();
 
+    // Handling of data rows whose field count isn't the header's, in every
+    // scan: Skip (default) leaves them out of the index; Fail throws
+    // FaultyRowsError at the first one; Record leaves them out and writes
+    // their offsets and field counts to <outputDir>/faulty_rows.bin (see
+    // FaultyRowReport) without slowing the scan. With maxFaults > 0, Record
+    // throws FaultyRowsError once more than that many turn up. Either way,
+    // Metrics::faultyRows counts them.
+    void setFaultyRowMode(FaultyRowMode mode, std::uint64_t maxFaults = 0);
+    FaultyRowMode faultyRowMode() const { return _faultMode; }
+    // setFaultyRowMode(skip ? Skip : Fail)
     void skipFaultyRows(bool skip);
 
+    // Select how the CSV is read (default: mmap with stream fallback).
+    // Takes effect the next time the file is opened.
+    void setInputMode(InputMode mode);
+    const InputSource& input() const;
+
+    // Field delimiter, quote, escape and comment bytes of the input (default
+    // Dialect::csv()). Throws std::invalid_argument for an unusable one (see
+    // Dialect::validate()); takes effect from the next parseHeaderRow().
+    void setDialect(const Dialect& dialect);
+    const Dialect& dialect() const { return _dialect; }
+
+    // Assign each column's dictionary ids in byte order of the values
+    // instead of first occurrence, so id order matches value order.
+    void setSortedDictionaries(bool sorted) { _sortedDictionaries = sorted; }
+
+    // Detect int64 / double / bool / date columns while tokenizing and store
+    // them as native values (ColumnStore::Column::type()) instead of
+    // dictionary ids. Empty cells of a typed column are missing values.
+    void setTypeInference(bool infer) { _inferTypes = infer; }
+
+    // Bytes mapIntTranspose may hold per column chunk (ids and dictionaries).
+    // Chunks are then sized to fit from sampled rows and adjusted by what
+    // each finished chunk used; 0 (default) keeps COLUMNS_PER_CHUNK columns.
+    void setMemoryBudget(std::size_t bytes) { _memoryBudget = bytes; }
+
+    // Estimate the job from PROFILE_BLOCKS evenly spaced blocks of the
+    // input, each resynced to a row start like a morsel: row count and
+    // width, and per column the type and a HyperLogLog cardinality. Reads
+    // the header first if needed; the whole file only when it's smaller
+    // than the sample. The result is kept until the input or dialect
+    // changes, and pre-sizes the row offset arrays, dictionaries and id
+    // segments of later passes.
+    const DataProfile& profile();
+
+    // Worker threads used by every parallel pass; 0 = hardware concurrency.
+    void setThreadCount(unsigned n);
+    unsigned threadCount() const;
+    // Workers every pass runs on. By default a pool of threadCount()
+    // threads this object creates on first use and keeps; hand in one to
+    // share it between instances (nullptr goes back to an owned one).
+    // threadCount() still sets how many lanes each pass splits into.
+    void setThreadPool(std::shared_ptr<ThreadPool> pool);
+    ThreadPool& threadPool() const;
+
+    // Row start offsets found by findRowOffsets(), kept in memory for the
+    // transpose. row_offsets.bin is written in the background unless
+    // disabled; flushRowOffsets() waits for it and rethrows a write error.
+    const std::vector<std::uint64_t>& rowOffsets() const { return _rowOffsets; }
+    void setWriteRowOffsets(bool write) { _writeRowOffsets = write; }
+    void flushRowOffsets();
+    // Load row_offsets.bin from an earlier run instead of re-scanning.
+    void loadRowOffsets();
+
+    // Random access to the rows indexed by findRowOffsets() / loadRowOffsets().
+    // A row is its bytes up to the terminator; a cell is a field as the
+    // column store holds it (trimmed, quotes kept), "" past the end of a
+    // short row. Views point into the mapped CSV and stay valid until the
+    // input is reopened; for an unmapped input they point into a buffer
+    // reused by the next call. Not thread-safe.
+    std::string_view getRow(std::uint64_t row) const;
+    std::string_view getCell(std::uint64_t row, std::size_t col) const;
+    // out[i] = getRow(rows[i]), fetched in offset order so a batch reads the
+    // file front to back; every view stays valid until the next call
+    void getRows(const std::uint64_t* rows, std::size_t n, std::vector<std::string_view>& out) const;
+
+    // Where a row starts: the index into csvPaths() and the byte offset in
+    // that file. rowOffsets() of a dataset are offsets into its partitions
+    // read back to back, headers after the first one's left out.
+    struct RowLocation {
+        std::size_t file = 0;
+        std::uint64_t offset = 0;
+    };
+    RowLocation rowLocation(std::uint64_t row) const;
+
+    // Bring the output directory up to date with a CSV that was only
+    // appended to since the last scanAndTranspose() / mapIntTranspose():
+    // only the new bytes are scanned, and row_offsets.bin and every column
+    // are extended, keeping the existing dictionary ids (so the result
+    // matches a full rebuild). Falls back to scanAndTranspose() and returns
+    // false when there is no earlier index, its first or last bytes changed,
+    // the settings differ, or a typed column can't hold the new values.
+    // The new rows and dictionary values are appended to the chunk files,
+    // so a refresh costs the new rows plus one pass over each dictionary.
+    // A column is rewritten whole when its ids have to grow wider (the
+    // dictionary outgrew 255 or 65535 values) or, with sorted
+    // dictionaries, when a new value sorts before an existing one; a chunk
+    // left with more dead bytes than live ones is copied compacted.
+    bool refresh();
+
+    // Phase timings, bytes, dictionary sizes and per-slice / per-chunk stats
+    // of the passes run since construction or resetMetrics(); see Metrics.hpp.
+    // May be polled from another thread while a pass runs: phases, slices and
+    // chunks show up as they finish. toJson() gives the same as JSON.
+    Metrics metrics() const;
+    void resetMetrics();
+
 private:
+    struct HeaderTable;
+    struct FusedScan;
+    struct RowFetch;
+    RowFetch& rowFetch() const;
+    // from > 0: append the rows starting at or after `from` (a row start)
+    void scanRows(FusedScan* fused, std::uint64_t from = 0);
+    void transposeFrom(FusedScan* fused);
+    // extend the column store by the rows from firstNewRow on; false (the
+    // store left as it was) if a typed column can't hold them
+    bool transposeAppended(std::size_t firstNewRow);
+    void saveIndexState();
+    // faulty_rows.bin for a scan from `from`, keeping the earlier rows' entries
+    void saveFaultyRows(std::vector<FaultyRow> rows, std::uint64_t from);
+    template <class Fn>
+    void updateMetrics(Fn&& fn) {
+        std::lock_guard<std::mutex> lock(_metricsMutex);
+        fn(_metrics);
+    }
+    std::shared_ptr<PartitionedSource> openPartitions() const;
+    const HeaderTable& headerTable(bool withNames) const;
     std::pair<u32,u16> readPair(std::size_t colNum) const;
+    void write_row_offsets_async(const std::string& path);
 
-    // Helper: replace doubled quotes ("") → ("), used by getHeader()
-    static std::string unescapeCsvField(std::string_view raw);
+    // Helper: replace doubled quotes ("") → (") and drop escape bytes, used
+    // by getHeader(). Returns raw itself when there is nothing to replace,
+    // else the result written to scratch.
+    static std::string_view unescapeCsvField(std::string_view raw, const Dialect& dialect, std::string& scratch);
 
     std::string _csvPath;
+    std::vector<std::string> _csvPaths;           // dataset mode: more than one
     std::string _outputDir;
     std::string _headersbinFilePath;
-    uint64_t *_rowOffsets; //array of row offsets
+    mutable std::unique_ptr<HeaderTable> _headers; // cached header index and names
+    InputMode _inputMode = InputMode::Auto;
+    Dialect _dialect;
+    mutable std::shared_ptr<InputSource> _input; // opened lazily, shared by all passes
+    mutable std::shared_ptr<PartitionedSource> _partitions; // _input, in dataset mode
+    mutable std::unique_ptr<RowFetch> _fetch;    // getRow / getCell state, reset with _input
+    std::vector<std::uint64_t> _rowOffsets; //row start offsets, in file order
+    bool _writeRowOffsets = true;
+    std::future<void> _rowOffsetsWrite; // pending background write of row_offsets.bin
     u32 rowCount = 0; //number of rows
-    bool skipRows = true; //whether to skip rows with column count mismatch
+    FaultyRowMode _faultMode = FaultyRowMode::Skip;
+    std::uint64_t _maxFaults = 0; // Record: 0 = no limit
+    bool _sortedDictionaries = false;
+    bool _inferTypes = false;
+    std::size_t _memoryBudget = 0;
+    unsigned _threadCount = 0; // 0 = NUM_THREADS / hardware concurrency
+    std::unique_ptr<DataProfile> _profile; // last profile(), for sizing
+    mutable std::shared_ptr<ThreadPool> _pool;
+    bool _poolShared = false; // _pool came from setThreadPool()
+    mutable std::mutex _metricsMutex;
+    Metrics _metrics;
 };
 
 } // namespace tabular
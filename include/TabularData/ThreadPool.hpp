@@ -0,0 +1,54 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tabular {
+
+// Worker threads kept for the life of the pool and shared by every pass of
+// every TabularData handed it (setThreadPool()), so wide files with many
+// column chunks, or a service opening many small files, stop paying for
+// thread creation per phase. Safe to use from several threads at once.
+class ThreadPool {
+public:
+    // `threads` is the concurrency of run(), the calling thread included
+    // (0 = std::thread::hardware_concurrency()). With `pinned`, each worker
+    // is bound to one CPU, taken round-robin across NUMA nodes so a pool
+    // smaller than the machine spreads its memory bandwidth; a no-op where
+    // affinity isn't supported.
+    explicit ThreadPool(unsigned threads = 0, bool pinned = false);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(_workers.size()) + 1; }
+
+    // Run fn(lane) once for every lane in [0, lanes) and return when all
+    // have; the first exception (by lane) is rethrown here. Lanes are
+    // claimed by idle workers and the caller alike, so lanes beyond size()
+    // simply queue, and a lane may itself call run() without deadlocking.
+    // Lanes must not wait on one another.
+    void run(unsigned lanes, const std::function<void(unsigned)>& fn);
+
+private:
+    struct Batch;
+
+    void loop();
+    // claim and run one lane of b; false when none is left. Call with _mu
+    // held; returns with it held.
+    bool runLane(Batch& b, std::unique_lock<std::mutex>& lock);
+
+    std::mutex _mu;
+    std::condition_variable _cv;
+    std::deque<std::shared_ptr<Batch>> _batches; // with lanes left to claim
+    std::vector<std::thread> _workers;
+    bool _stop = false;
+};
+
+} // namespace tabular
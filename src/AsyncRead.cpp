@@ -0,0 +1,330 @@
+#include "AsyncRead.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define TABULAR_HAVE_IO_URING 1
+#endif
+#endif
+
+namespace tabular {
+
+namespace {
+
+enum class Backend { Off, Threads, Uring };
+
+// set when the kernel rejects IORING_OP_READ (older than 5.6): later reads
+// use the pool
+std::atomic<bool> g_uringRejected{false};
+
+Backend choose() {
+    const char* env = std::getenv("TABULAR_ASYNC_IO");
+    const std::string want = env ? env : "";
+    if (want == "off") return Backend::Off;
+    if (want == "threads") return Backend::Threads;
+#ifdef TABULAR_HAVE_IO_URING
+    io_uring_params p{};
+    const int fd = static_cast<int>(::syscall(__NR_io_uring_setup, 1, &p));
+    if (fd >= 0) {
+        ::close(fd);
+        return Backend::Uring;
+    }
+#endif
+    return Backend::Threads;
+}
+
+Backend backend() {
+    static const Backend b = choose();
+    if (b == Backend::Uring && g_uringRejected.load(std::memory_order_relaxed)) return Backend::Threads;
+    return b;
+}
+
+// ------------------------------- I/O pool --------------------------------
+// Plain FIFO of reads; a handful of threads is enough to keep a disk queue
+// busy, the parsing itself stays on the workers.
+class IoPool {
+public:
+    IoPool() {
+        for (int i = 0; i < IO_THREADS; ++i) _threads.emplace_back([this] { loop(); });
+    }
+
+    ~IoPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mu);
+            _stop = true;
+        }
+        _cv.notify_all();
+        for (auto& t : _threads) t.join();
+    }
+
+    std::future<std::size_t> submit(std::packaged_task<std::size_t()> job) {
+        auto f = job.get_future();
+        {
+            std::lock_guard<std::mutex> lock(_mu);
+            _jobs.push_back(std::move(job));
+        }
+        _cv.notify_one();
+        return f;
+    }
+
+private:
+    void loop() {
+        for (;;) {
+            std::packaged_task<std::size_t()> job;
+            {
+                std::unique_lock<std::mutex> lock(_mu);
+                _cv.wait(lock, [this] { return _stop || !_jobs.empty(); });
+                if (_jobs.empty()) return;
+                job = std::move(_jobs.front());
+                _jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::mutex _mu;
+    std::condition_variable _cv;
+    std::deque<std::packaged_task<std::size_t()>> _jobs;
+    std::vector<std::thread> _threads;
+    bool _stop = false;
+};
+
+IoPool& io_pool() {
+    static IoPool pool;
+    return pool;
+}
+
+} // end anon
+
+#ifdef TABULAR_HAVE_IO_URING
+// -------------------------------- io_uring -------------------------------
+// One ring per thread, set up on first use, driven with the raw syscalls
+// (no liburing). Completions carry their PendingRead in user_data, so any
+// wait() on the thread reaps for every read in flight there.
+struct UringRing {
+    static constexpr unsigned kEntries = 64;
+
+    int fd = -1;
+    bool tried = false;
+    unsigned inFlight = 0;
+    unsigned cqCapacity = 0;
+
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    void* sqRing = MAP_FAILED;
+    std::size_t sqRingBytes = 0;
+    void* cqRing = MAP_FAILED;
+    std::size_t cqRingBytes = 0;
+    void* sqeMem = MAP_FAILED;
+    std::size_t sqeBytes = 0;
+
+    ~UringRing() { release(); }
+
+    bool ready() {
+        if (!tried) {
+            tried = true;
+            if (!setup()) release();
+        }
+        return fd >= 0;
+    }
+
+    void release() {
+        if (sqeMem != MAP_FAILED) ::munmap(sqeMem, sqeBytes);
+        if (cqRing != MAP_FAILED && cqRing != sqRing) ::munmap(cqRing, cqRingBytes);
+        if (sqRing != MAP_FAILED) ::munmap(sqRing, sqRingBytes);
+        if (fd >= 0) ::close(fd);
+        sqeMem = cqRing = sqRing = MAP_FAILED;
+        fd = -1;
+    }
+
+    bool setup() {
+        io_uring_params p{};
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, kEntries, &p));
+        if (fd < 0) return false;
+
+        sqRingBytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cqRingBytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) sqRingBytes = cqRingBytes = std::max(sqRingBytes, cqRingBytes);
+
+        sqRing = ::mmap(nullptr, sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) return false;
+        cqRing = single ? sqRing
+                        : ::mmap(nullptr, cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) return false;
+        sqeBytes = p.sq_entries * sizeof(io_uring_sqe);
+        sqeMem = ::mmap(nullptr, sqeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqeMem == MAP_FAILED) return false;
+
+        char* sq = static_cast<char*>(sqRing);
+        char* cq = static_cast<char*>(cqRing);
+        sqTail  = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sqMask  = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        cqHead  = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cqTail  = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cqMask  = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes    = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        sqes    = static_cast<io_uring_sqe*>(sqeMem);
+        cqCapacity = p.cq_entries;
+        return true;
+    }
+
+    // false when the ring is full or the kernel refused the entry
+    bool submit(PendingRead* r, int file) {
+        if (inFlight >= cqCapacity || r->_len > UINT_MAX) return false;
+        const unsigned tail = *sqTail;
+        const unsigned idx = tail & *sqMask;
+        io_uring_sqe& e = sqes[idx];
+        std::memset(&e, 0, sizeof(e));
+        e.opcode = IORING_OP_READ;
+        e.fd = file;
+        e.off = r->_offset;
+        e.addr = reinterpret_cast<std::uintptr_t>(r->_dst);
+        e.len = static_cast<unsigned>(r->_len);
+        e.user_data = reinterpret_cast<std::uintptr_t>(r);
+        sqArray[idx] = idx;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        long rc;
+        do rc = ::syscall(__NR_io_uring_enter, fd, 1, 0, 0, nullptr, 0);
+        while (rc < 0 && errno == EINTR);
+        if (rc < 1) {
+            // not consumed; without SQPOLL the kernel only reads SQEs in enter
+            __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+            return false;
+        }
+        ++inFlight;
+        return true;
+    }
+
+    // blocks for at least one completion, then drains the queue
+    void reap() {
+        while (::syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+            if (errno != EINTR) throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+        }
+        unsigned head = *cqHead;
+        const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& c = cqes[head & *cqMask];
+            auto* r = reinterpret_cast<PendingRead*>(static_cast<std::uintptr_t>(c.user_data));
+            r->_result = c.res;
+            r->_completed = true;
+            --inFlight;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+};
+
+namespace {
+UringRing& thread_ring() {
+    static thread_local UringRing ring;
+    return ring;
+}
+} // end anon
+#endif
+
+// ------------------------------ PendingRead ------------------------------
+
+PendingRead::~PendingRead() {
+    if (!active()) return;
+    try { wait(); } catch (...) {}
+}
+
+void PendingRead::start(const InputSource& src, u64 offset, std::size_t len, char* dst) {
+    if (active()) wait();
+    _src = &src;
+    _dst = dst;
+    _offset = offset;
+    _len = len;
+    _completed = false;
+
+    switch (backend()) {
+    case Backend::Uring:
+#ifdef TABULAR_HAVE_IO_URING
+        if (src.nativeHandle() >= 0 && thread_ring().ready() && thread_ring().submit(this, src.nativeHandle())) {
+            _state = State::Uring;
+            return;
+        }
+#endif
+        [[fallthrough]];
+    case Backend::Threads:
+        _future = io_pool().submit(std::packaged_task<std::size_t()>(
+            [&src, offset, len, dst] { return src.readInto(offset, len, dst); }));
+        _state = State::Pool;
+        return;
+    case Backend::Off:
+        _result = static_cast<std::int64_t>(src.readInto(offset, len, dst));
+        _state = State::Ready;
+        return;
+    }
+}
+
+std::size_t PendingRead::wait() {
+    const State state = _state;
+    _state = State::Idle;
+    switch (state) {
+    case State::Idle:
+        return 0;
+    case State::Pool:
+        return _future.get();
+    case State::Ready:
+        return static_cast<std::size_t>(_result);
+    case State::Uring:
+        break;
+    }
+
+#ifdef TABULAR_HAVE_IO_URING
+    while (!_completed) thread_ring().reap();
+    if (_result < 0) {
+        if (_result == -EINVAL || _result == -EOPNOTSUPP) {
+            g_uringRejected.store(true, std::memory_order_relaxed);
+            return _src->readInto(_offset, _len, _dst);
+        }
+        throw std::runtime_error("Failed to read CSV file: " + _src->path() + ": " + std::strerror(static_cast<int>(-_result)));
+    }
+    std::size_t n = static_cast<std::size_t>(_result);
+    // short read before EOF: finish it synchronously
+    if (n < _len && _offset + n < _src->size()) n += _src->readInto(_offset + n, _len - n, _dst + n);
+    return n;
+#else
+    return 0;
+#endif
+}
+
+const char* PendingRead::backendName() {
+    switch (backend()) {
+    case Backend::Uring:   return "io_uring";
+    case Backend::Threads: return "threads";
+    case Backend::Off:     break;
+    }
+    return "off";
+}
+
+bool PendingRead::enabled() { return backend() != Backend::Off; }
+
+} // namespace tabular
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <future>
+
+#include "TabularData/InputSource.hpp"
+
+#ifndef READ_AHEAD_DEPTH
+#define READ_AHEAD_DEPTH 2 // spans in flight per SpanReader
+#endif
+
+#ifndef IO_THREADS
+#define IO_THREADS 4 // threads of the fallback read pool
+#endif
+
+namespace tabular {
+
+// One readInto() in flight, so parsing the previous buffer overlaps the
+// fetch. Sources with a file descriptor go through a per-thread io_uring
+// where the kernel has one (Linux); otherwise the read runs on a small pool
+// of I/O threads shared by the process.
+// TABULAR_ASYNC_IO=uring|threads|off in the environment forces a backend.
+//
+// wait() must be called on the thread that called start(), and the object
+// must not move while a read is in flight; the destructor waits.
+class PendingRead {
+public:
+    using u64 = std::uint64_t;
+
+    PendingRead() = default;
+    PendingRead(const PendingRead&) = delete;
+    PendingRead& operator=(const PendingRead&) = delete;
+    ~PendingRead();
+
+    // read [offset, offset + len) of src into dst[0, len)
+    void start(const InputSource& src, u64 offset, std::size_t len, char* dst);
+    // bytes read, shorter only at EOF
+    std::size_t wait();
+
+    bool active() const { return _state != State::Idle; }
+    u64 offset() const { return _offset; }
+
+    // backend in use: "io_uring", "threads" or "off"
+    static const char* backendName();
+    // false for backend "off": callers read synchronously
+    static bool enabled();
+
+private:
+    friend struct UringRing;
+    enum class State { Idle, Uring, Pool, Ready };
+
+    const InputSource* _src = nullptr;
+    char* _dst = nullptr;
+    u64 _offset = 0;
+    std::size_t _len = 0;
+    State _state = State::Idle;
+    bool _completed = false;            // io_uring: CQE reaped
+    std::int64_t _result = 0;           // io_uring: bytes or -errno; off: bytes
+    std::future<std::size_t> _future;   // threads
+};
+
+} // namespace tabular
@@ -0,0 +1,85 @@
+#include "ChunkPlanner.hpp"
+#include "Dictionary.hpp"
+#include "PackedColumn.hpp"
+#include "RowTokenizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tabular {
+
+namespace {
+
+constexpr double      kEntryBytes  = 42;        // Dictionary entry + ~1.7 slots, excluding the key
+constexpr double      kObjectBytes = 256;       // PackedColumn / Dictionary headers and first blocks
+constexpr std::size_t kSampleCells = 4u << 20;  // sampled hashes kept at once
+
+} // end anon
+
+std::size_t ChunkPlanner::sampleRows(int ncols) {
+    return std::clamp<std::size_t>(kSampleCells / static_cast<std::size_t>(std::max(1, ncols)), 16, 256);
+}
+
+ChunkPlanner::ChunkPlanner(const InputSource& src, const Dialect& dialect, std::size_t budget, int firstCol,
+                           int colCount, u64 rowCount, int nmorsels, const std::vector<std::pair<u64,u64>>& samples)
+    : _budget(static_cast<double>(budget)), _firstCol(firstCol), _colCount(colCount) {
+    const std::size_t ncols = static_cast<std::size_t>(std::max(0, colCount - firstCol));
+    const std::size_t n = samples.size();
+
+    // hashes[c * n + j]: j-th value seen in column firstCol + c
+    std::vector<u64> hashes(ncols * n);
+    std::vector<std::size_t> present(ncols, 0);
+    std::vector<double> keyBytes(ncols, 0);
+    RowTokenizer tokenizer(src, 0, 0, dialect);
+    for (const auto& [cursor, bound] : samples) {
+        std::size_t c = 0;
+        tokenizer.fields(cursor, bound, static_cast<int>(ncols), [&](std::string_view token) {
+            hashes[c * n + present[c]++] = Dictionary::hash(token);
+            keyBytes[c] += static_cast<double>(token.size());
+            ++c;
+        });
+    }
+
+    const double rows = static_cast<double>(rowCount);
+    const double morsels = static_cast<double>(std::max(1, nmorsels));
+    _cost.reserve(ncols);
+    for (std::size_t c = 0; c < ncols; ++c) {
+        const std::size_t p = present[c];
+        const auto begin = hashes.begin() + static_cast<std::ptrdiff_t>(c * n);
+        const auto end = begin + static_cast<std::ptrdiff_t>(p);
+        std::sort(begin, end);
+        const std::size_t d = static_cast<std::size_t>(std::unique(begin, end) - begin);
+
+        // every sampled value distinct: assume the column is unique
+        const double distinct = (p == 0) ? 1
+                              : (d == p) ? rows
+                              : std::min(rows, std::ceil(static_cast<double>(d) * rows / static_cast<double>(p)));
+        const double entry = kEntryBytes + (p ? keyBytes[c] / static_cast<double>(p) : 0);
+        const double localEntries = morsels * std::min(distinct, std::ceil(rows / morsels));
+
+        _cost.push_back(rows * PackedColumn::widthFor(static_cast<u64>(distinct))
+                        + localEntries * (entry + sizeof(std::uint32_t))   // local dicts + remap tables
+                        + distinct * entry                                 // global dict
+                        + (morsels + 1) * kObjectBytes);
+    }
+}
+
+int ChunkPlanner::next(int col) {
+    double sum = 0;
+    int end = col;
+    while (end < _colCount) {
+        const double cost = _cost[static_cast<std::size_t>(end - _firstCol)];
+        if (end > col && (sum + cost) * _scale > _budget) break;
+        sum += cost;
+        ++end;
+    }
+    _lastEstimate = sum;
+    return end - col;
+}
+
+void ChunkPlanner::observe(std::size_t actualBytes) {
+    if (_lastEstimate <= 0) return;
+    _scale = std::clamp(static_cast<double>(actualBytes) / _lastEstimate, 0.01, 100.0);
+}
+
+} // namespace tabular
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "TabularData/Dialect.hpp"
+#include "TabularData/InputSource.hpp"
+
+namespace tabular {
+
+// Sizes mapIntTranspose's column chunks to a memory budget. A column's cost
+// (ids at their encoded width, per-morsel and global dictionaries, remap
+// tables) is estimated from a few sampled rows: their distinct-value ratio
+// and value length. Each finished chunk reports what it really held, and the
+// ratio of actual to estimated bytes rescales the estimates of the next one.
+class ChunkPlanner {
+public:
+    using u64 = std::uint64_t;
+
+    // samples: {cursor, bound} of the sampled rows, each cursor at firstCol;
+    // every column from firstCol on is estimated up front
+    ChunkPlanner(const InputSource& src, const Dialect& dialect, std::size_t budget, int firstCol, int colCount,
+                 u64 rowCount, int nmorsels, const std::vector<std::pair<u64,u64>>& samples);
+
+    // rows worth sampling for a table this wide (fewer for wide tables, so
+    // the per-column hash samples stay a few dozen MB)
+    static std::size_t sampleRows(int ncols);
+
+    // columns for the chunk starting at `col`: as many as fit, at least one
+    int next(int col);
+    // heap bytes the chunk handed out by the last next() actually used
+    void observe(std::size_t actualBytes);
+
+    double scale() const { return _scale; }
+
+private:
+    double _budget;
+    int _firstCol;
+    int _colCount;
+    std::vector<double> _cost;                // estimated bytes of columns _firstCol + i
+    double _scale = 1.0;
+    double _lastEstimate = 0;
+};
+
+} // namespace tabular
@@ -0,0 +1,617 @@
+#include "TabularData/ColumnStore.hpp"
+#include "ColumnStoreWriter.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace tabular {
+
+// ------------------------------- writer ----------------------------------
+
+ColumnStoreWriter::ColumnStoreWriter(std::string dir, u64 rowCount, u32 colCount)
+    : _dir(std::move(dir)), _rowCount(rowCount), _colCount(colCount) {
+    fs::create_directories(_dir);
+    // drop chunk files of an earlier, possibly wider, run
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(_dir, ec)) {
+        const fs::path ext = entry.path().extension();
+        if (ext == ".tdc" || ext == ".new") fs::remove(entry.path(), ec);
+    }
+    fs::remove(fs::path(_dir) / "manifest.bin", ec);
+}
+
+ColumnStoreWriter::ColumnStoreWriter(std::string dir, const ColumnStore& existing, u64 rowCount)
+    : _dir(std::move(dir)), _rowCount(rowCount), _colCount(existing.columnCount()), _existing(&existing) {
+    if (rowCount < existing.rowCount()) throw std::logic_error("A column store can only be extended");
+    // left over from an extension that didn't finish
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(_dir, ec)) {
+        if (entry.path().extension() == ".new") fs::remove(entry.path(), ec);
+    }
+}
+
+std::string ColumnStoreWriter::chunkFileName(u32 chunkIndex) {
+    std::ostringstream oss;
+    oss << "chunk-" << std::setw(5) << std::setfill('0') << chunkIndex << ".tdc";
+    return oss.str();
+}
+
+ColumnStoreWriter::u32 ColumnStoreWriter::valueWidth(ColumnType type) {
+    switch (type) {
+        case ColumnType::Bool: return 1;
+        case ColumnType::Date: return 4;
+        default:               return 8;
+    }
+}
+
+// a typed run narrowed to its on-disk encoding
+static std::vector<char> encodeValues(const TypedColumn& seg, ColumnType type) {
+    const std::uint32_t width = ColumnStoreWriter::valueWidth(type);
+    std::vector<char> out(seg.size() * width);
+    for (std::size_t r = 0; r < seg.size(); ++r) {
+        const std::uint64_t bits = seg.bits(r);
+        const bool missing = bits == TypedColumn::missingBits(type);
+        if (type == ColumnType::Bool) {
+            out[r] = static_cast<char>(missing ? 0xFF : bits);
+        } else if (type == ColumnType::Date) {
+            const std::int32_t v = missing ? INT32_MIN : static_cast<std::int32_t>(static_cast<std::int64_t>(bits));
+            std::memcpy(&out[r * 4], &v, 4);
+        } else {
+            std::memcpy(&out[r * 8], &bits, 8);
+        }
+    }
+    return out;
+}
+
+void ColumnStoreWriter::loadDictionary(const ColumnStore::Column& col, Dictionary& dict) {
+    dict.reserve(static_cast<std::size_t>(col.dictionarySize()));
+    for (u64 id = 0; id < col.dictionarySize(); ++id) dict.intern(col.value(id));
+}
+
+void ColumnStoreWriter::loadIds(const ColumnStore::Column& col, PackedColumn& ids) {
+    ids.reset(0, col.width());
+    for (u32 k = 0; k < col.runCount(); ++k) {
+        const ColumnStore::Column::Run run = col.run(k);
+        ids.extend(run.cells, static_cast<std::size_t>(run.rows));
+    }
+}
+
+namespace {
+
+// A chunk file written front to back (or extended at its end), tracking
+// the offset of each section.
+class ChunkOut {
+public:
+    ChunkOut(fs::path path, std::uint64_t from) : _path(std::move(path)), _pos(from) {
+        _out.open(_path, std::ios::binary | (from ? std::ios::app : std::ios::trunc));
+        if (!_out) throw std::runtime_error("Failed to open column chunk for writing: " + _path.string());
+    }
+
+    std::uint64_t pos() const { return _pos; }
+    void put(const void* p, std::size_t n) {
+        _out.write(static_cast<const char*>(p), static_cast<std::streamsize>(n));
+        _pos += n;
+    }
+    void align8() {
+        static const char zeros[8] = {};
+        put(zeros, static_cast<std::size_t>((8 - _pos % 8) % 8));
+    }
+    void close() {
+        _out.close();
+        if (!_out) throw std::runtime_error("Failed to write column chunk: " + _path.string());
+    }
+
+private:
+    fs::path _path;
+    std::ofstream _out;
+    std::uint64_t _pos;
+};
+
+// Column c of the segments (or typed runs) as one id run starting at
+// firstRow; no run when they're all empty. Returns the rows written.
+std::uint64_t putIds(ChunkOut& out, PackedColumn* const* segments, TypedColumn* const* typed, int nsegments,
+                     std::uint32_t c, ColumnType type, std::uint32_t width, std::uint64_t firstRow,
+                     std::vector<IdRun>& runs) {
+    IdRun run{firstRow, 0, out.pos()};
+    for (int t = 0; t < nsegments; ++t) {
+        if (type != ColumnType::String) {
+            const TypedColumn& seg = typed[t][c];
+            if (seg.empty() || seg.type() != type) {
+                if (seg.size() == 0) continue;
+                throw std::logic_error("Typed column segment not settled on the column type");
+            }
+            const std::vector<char> values = encodeValues(seg, type);
+            out.put(values.data(), values.size());
+            run.rows += seg.size();
+            continue;
+        }
+        const PackedColumn& seg = segments[t][c];
+        if (seg.size() == 0) continue;
+        if (seg.width() != width) throw std::logic_error("Column segment width mismatch");
+        out.put(seg.data(), seg.bytes());
+        run.rows += seg.size();
+    }
+    if (run.rows == 0) return 0;
+    out.align8();
+    runs.push_back(run);
+    return run.rows;
+}
+
+// dictionary ids [first, dict.size()) as one run; none when that's empty
+void putDictionary(ChunkOut& out, const Dictionary& dict, std::uint32_t first, std::vector<DictRun>& runs) {
+    if (first >= dict.size()) return;
+    DictRun run{first, dict.size() - first, out.pos(), 0, 0};
+    std::uint64_t off = 0;
+    out.put(&off, sizeof(off));
+    for (std::uint32_t id = first; id < dict.size(); ++id) {
+        off += dict.key(id).size();
+        out.put(&off, sizeof(off));
+    }
+    run.bytesOffset = out.pos();
+    for (std::uint32_t id = first; id < dict.size(); ++id) {
+        const std::string_view v = dict.key(id);
+        out.put(v.data(), v.size());
+    }
+    run.bytes = off;
+    out.align8();
+    runs.push_back(run);
+}
+
+struct ColumnRuns {
+    ColumnEntry entry;
+    std::vector<IdRun> ids;
+    std::vector<DictRun> dict;
+};
+
+// footer and trailer: the entries, then each column's runs
+void putFooter(ChunkOut& out, std::vector<ColumnRuns>& cols) {
+    const ChunkTrailer trailer{out.pos(), static_cast<std::uint32_t>(cols.size()), kColumnStoreVersion,
+                               kChunkMagic, 0};
+    for (ColumnRuns& col : cols) {
+        col.entry.idRuns = static_cast<std::uint32_t>(col.ids.size());
+        col.entry.dictRuns = static_cast<std::uint32_t>(col.dict.size());
+        out.put(&col.entry, sizeof(ColumnEntry));
+    }
+    for (const ColumnRuns& col : cols) {
+        out.put(col.ids.data(), col.ids.size() * sizeof(IdRun));
+        out.put(col.dict.data(), col.dict.size() * sizeof(DictRun));
+    }
+    out.put(&trailer, sizeof(trailer));
+}
+
+// bytes a compacted copy of the chunk would take, alignment aside
+std::uint64_t liveBytes(const std::vector<ColumnRuns>& cols) {
+    std::uint64_t n = sizeof(ChunkTrailer);
+    for (const ColumnRuns& col : cols) {
+        n += sizeof(ColumnEntry) + sizeof(IdRun) + sizeof(DictRun);
+        n += col.entry.rowCount * col.entry.width;
+        for (const DictRun& d : col.dict) n += d.count * sizeof(std::uint64_t) + d.bytes;
+    }
+    return n;
+}
+
+// Copies the runs of the chunk at `path` to <path>.new, each column's id
+// runs as one and its dictionary runs as one; returns the copy's size.
+std::uint64_t compact(const fs::path& path, std::vector<ColumnRuns>& cols) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Failed to open column chunk: " + path.string());
+    ChunkOut out(path.string() + ".new", 0);
+    std::vector<char> buf(std::size_t(1) << 20);
+    auto copy = [&](std::uint64_t offset, std::uint64_t n) {
+        in.seekg(static_cast<std::streamoff>(offset));
+        while (n > 0) {
+            const std::size_t len = static_cast<std::size_t>(std::min<std::uint64_t>(n, buf.size()));
+            if (!in.read(buf.data(), static_cast<std::streamsize>(len)))
+                throw std::runtime_error("Truncated column chunk: " + path.string());
+            out.put(buf.data(), len);
+            n -= len;
+        }
+    };
+    for (ColumnRuns& col : cols) {
+        if (!col.ids.empty()) {
+            const IdRun run{0, col.entry.rowCount, out.pos()};
+            for (const IdRun& r : col.ids) copy(r.offset, r.rows * col.entry.width);
+            out.align8();
+            col.ids.assign(1, run);
+        }
+        if (!col.dict.empty()) {
+            DictRun run{col.dict.front().firstId, 0, out.pos(), 0, 0};
+            std::uint64_t base = 0;
+            out.put(&base, sizeof(base));
+            for (const DictRun& d : col.dict) {
+                std::vector<std::uint64_t> index(static_cast<std::size_t>(d.count + 1));
+                in.seekg(static_cast<std::streamoff>(d.indexOffset));
+                if (!in.read(reinterpret_cast<char*>(index.data()), static_cast<std::streamsize>(index.size() * 8)))
+                    throw std::runtime_error("Truncated column chunk: " + path.string());
+                for (std::size_t i = 1; i < index.size(); ++i) {
+                    const std::uint64_t off = base + index[i];
+                    out.put(&off, sizeof(off));
+                }
+                base += d.bytes;
+                run.count += d.count;
+            }
+            run.bytesOffset = out.pos();
+            for (const DictRun& d : col.dict) copy(d.bytesOffset, d.bytes);
+            run.bytes = base;
+            out.align8();
+            col.dict.assign(1, run);
+        }
+    }
+    putFooter(out, cols);
+    out.close();
+    return out.pos();
+}
+
+// keys from `first` on ascending, the one before included
+bool ascendingFrom(const Dictionary& dict, std::uint32_t first) {
+    for (std::uint32_t id = std::max<std::uint32_t>(first, 1); id < dict.size(); ++id) {
+        if (!(dict.key(id - 1) < dict.key(id))) return false;
+    }
+    return true;
+}
+
+} // end anon
+
+void ColumnStoreWriter::writeChunk(u32 firstCol, u32 ncols, PackedColumn* const* segments, int nsegments,
+                                   const std::vector<Dictionary>& dicts,
+                                   TypedColumn* const* typed, const std::vector<ColumnType>* types) {
+    if (_existing) throw std::logic_error("An extended column store takes appendChunk()");
+    ChunkOut out(fs::path(_dir) / chunkFileName(static_cast<u32>(_chunks.size())), 0);
+    std::vector<ColumnRuns> cols(ncols);
+    for (u32 c = 0; c < ncols; ++c) {
+        ColumnEntry& e = cols[c].entry;
+        const Dictionary& dict = dicts[c];
+        const ColumnType type = types ? (*types)[c] : ColumnType::String;
+        e = ColumnEntry{};
+        e.column    = firstCol + c;
+        e.type      = static_cast<u32>(type);
+        e.width     = type == ColumnType::String ? PackedColumn::widthFor(dict.size()) : valueWidth(type);
+        e.rowCount  = _rowCount;
+        e.dictCount = dict.size();
+        if (putIds(out, segments, typed, nsegments, c, type, e.width, 0, cols[c].ids) != _rowCount)
+            throw std::logic_error("Column segments don't cover every row");
+        putDictionary(out, dict, 0, cols[c].dict);
+        if (type == ColumnType::String && ascendingFrom(dict, 0)) e.flags |= kDictSorted;
+    }
+    putFooter(out, cols);
+    out.close();
+    _chunks.push_back({firstCol, ncols, out.pos()});
+}
+
+void ColumnStoreWriter::appendChunk(PackedColumn* const* segments, int nsegments, const std::vector<Dictionary>& dicts,
+                                    const std::vector<Extension>& extensions,
+                                    TypedColumn* const* typed, const std::vector<ColumnType>* types) {
+    const u32 k = static_cast<u32>(_chunks.size());
+    if (!_existing || k >= _existing->_chunks.size()) throw std::logic_error("No existing column chunk to extend");
+    const ColumnStore::Chunk& old = _existing->_chunks[k];
+    const u32 ncols = static_cast<u32>(old.entries.size());
+    const fs::path path = fs::path(_dir) / chunkFileName(k);
+
+    fs::resize_file(path, old.bytes); // drop what an unfinished extension appended
+    ChunkOut out(path, old.bytes);
+    std::vector<ColumnRuns> cols(ncols);
+    for (u32 c = 0; c < ncols; ++c) {
+        const ColumnEntry& prev = old.entries[c];
+        const Extension how = extensions[c];
+        const Dictionary& dict = dicts[c];
+        const ColumnType type = types ? (*types)[c] : ColumnType::String;
+        if (static_cast<u32>(type) != prev.type) throw std::logic_error("Extended column changed its type");
+
+        ColumnRuns& col = cols[c];
+        ColumnEntry& e = col.entry;
+        e = prev;
+        e.width     = type == ColumnType::String ? PackedColumn::widthFor(dict.size()) : valueWidth(type);
+        e.rowCount  = _rowCount;
+        e.dictCount = dict.size();
+        e.flags     = 0;
+        u64 firstRow = 0;
+        if (how == Extension::Append) {
+            if (e.width != prev.width) throw std::logic_error("Appended ids are wider than the column's");
+            const IdRun* runs = old.idRuns.data() + old.firstIdRun[c];
+            col.ids.assign(runs, runs + prev.idRuns);
+            firstRow = prev.rowCount;
+        }
+        if (firstRow + putIds(out, segments, typed, nsegments, c, type, e.width, firstRow, col.ids) != _rowCount)
+            throw std::logic_error("Column segments don't cover every row");
+
+        u32 firstId = 0;
+        if (how != Extension::Rewrite) {
+            const DictRun* runs = old.dictRuns.data() + old.firstDictRun[c];
+            col.dict.assign(runs, runs + prev.dictRuns);
+            firstId = static_cast<u32>(prev.dictCount);
+        }
+        putDictionary(out, dict, firstId, col.dict);
+        const bool sorted = how == Extension::Rewrite || (prev.flags & kDictSorted);
+        if (type == ColumnType::String && sorted && ascendingFrom(dict, firstId)) e.flags |= kDictSorted;
+    }
+    putFooter(out, cols);
+    out.close();
+
+    u64 bytes = out.pos();
+    const u64 live = liveBytes(cols);
+    if (bytes - std::min(bytes, live) > live) {
+        bytes = compact(path, cols);
+        _compacted.push_back(k);
+    }
+    _chunks.push_back({old.firstCol, ncols, bytes});
+}
+void ColumnStoreWriter::finish() {
+    if (_existing && _chunks.size() != _existing->chunkCount())
+        throw std::logic_error("Every chunk of an extended column store must be appended to");
+    for (u32 k : _compacted) {
+        const fs::path path = fs::path(_dir) / chunkFileName(k);
+        fs::rename(path.string() + ".new", path);
+    }
+
+    const fs::path path = fs::path(_dir) / "manifest.bin";
+    const fs::path next = path.string() + ".new";
+    std::ofstream out(next, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Failed to open column store manifest: " + next.string());
+
+    const u32 header[2] = {kManifestMagic, kColumnStoreVersion};
+    const u32 chunkCount = static_cast<u32>(_chunks.size());
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&_rowCount), sizeof(_rowCount));
+    out.write(reinterpret_cast<const char*>(&_colCount), sizeof(_colCount));
+    out.write(reinterpret_cast<const char*>(&chunkCount), sizeof(chunkCount));
+    for (const ChunkInfo& ch : _chunks) {
+        out.write(reinterpret_cast<const char*>(&ch.firstCol), sizeof(ch.firstCol));
+        out.write(reinterpret_cast<const char*>(&ch.ncols), sizeof(ch.ncols));
+        out.write(reinterpret_cast<const char*>(&ch.bytes), sizeof(ch.bytes));
+    }
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write column store manifest: " + next.string());
+    fs::rename(next, path); // the new rows become visible at once
+}
+
+// ------------------------------- reader ----------------------------------
+
+ColumnStore::ColumnStore(const std::string& outputDir) {
+    const fs::path dir = fs::path(outputDir) / "columns";
+    std::ifstream in(dir / "manifest.bin", std::ios::binary);
+    if (!in) throw std::runtime_error("Missing column store manifest. Run mapIntTranspose() first.");
+
+    u32 header[2] = {};
+    u32 chunkCount = 0;
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    in.read(reinterpret_cast<char*>(&_rowCount), sizeof(_rowCount));
+    in.read(reinterpret_cast<char*>(&_colCount), sizeof(_colCount));
+    in.read(reinterpret_cast<char*>(&chunkCount), sizeof(chunkCount));
+    if (!in || header[0] != kManifestMagic) throw std::runtime_error("Corrupted column store manifest");
+    if (header[1] != kColumnStoreVersion) throw std::runtime_error("Unsupported column store version");
+
+    _chunks.resize(chunkCount);
+    for (u32 k = 0; k < chunkCount; ++k) {
+        Chunk& ch = _chunks[k];
+        u32 ncols = 0;
+        in.read(reinterpret_cast<char*>(&ch.firstCol), sizeof(ch.firstCol));
+        in.read(reinterpret_cast<char*>(&ncols), sizeof(ncols));
+        in.read(reinterpret_cast<char*>(&ch.bytes), sizeof(ch.bytes));
+        if (!in) throw std::runtime_error("Corrupted column store manifest");
+
+        const std::string path = (dir / ColumnStoreWriter::chunkFileName(k)).string();
+        ch.file = openInputSource(path);
+        const u64 size = ch.bytes;
+        if (size < sizeof(ChunkTrailer) || ch.file->size() < size)
+            throw std::runtime_error("Truncated column chunk: " + path);
+        ch.base = ch.file->read(0, static_cast<std::size_t>(size), ch.copy).data();
+
+        ChunkTrailer trailer;
+        std::memcpy(&trailer, ch.base + size - sizeof(trailer), sizeof(trailer));
+        if (trailer.version != kColumnStoreVersion)
+            throw std::runtime_error("Unsupported column chunk version: " + path);
+        if (trailer.magic != kChunkMagic || trailer.ncols != ncols
+            || trailer.footerOffset + ncols * sizeof(ColumnEntry) + sizeof(trailer) > size)
+            throw std::runtime_error("Corrupted column chunk: " + path);
+
+        ch.entries.resize(ncols);
+        std::memcpy(ch.entries.data(), ch.base + trailer.footerOffset, ncols * sizeof(ColumnEntry));
+        u64 nids = 0, ndict = 0;
+        ch.firstIdRun.resize(ncols);
+        ch.firstDictRun.resize(ncols);
+        for (u32 c = 0; c < ncols; ++c) {
+            ch.firstIdRun[c] = static_cast<u32>(nids);
+            ch.firstDictRun[c] = static_cast<u32>(ndict);
+            nids += ch.entries[c].idRuns;
+            ndict += ch.entries[c].dictRuns;
+        }
+        const u64 runsOffset = trailer.footerOffset + ncols * sizeof(ColumnEntry);
+        if (runsOffset + nids * sizeof(IdRun) + ndict * sizeof(DictRun) + sizeof(trailer) != size)
+            throw std::runtime_error("Corrupted column chunk: " + path);
+        ch.idRuns.resize(static_cast<std::size_t>(nids));
+        ch.dictRuns.resize(static_cast<std::size_t>(ndict));
+        // the runs are stored column by column, id runs first
+        const char* p = ch.base + runsOffset;
+        for (u32 c = 0; c < ncols; ++c) {
+            const std::size_t idBytes = ch.entries[c].idRuns * sizeof(IdRun);
+            const std::size_t dictBytes = ch.entries[c].dictRuns * sizeof(DictRun);
+            std::memcpy(ch.idRuns.data() + ch.firstIdRun[c], p, idBytes);
+            std::memcpy(ch.dictRuns.data() + ch.firstDictRun[c], p + idBytes, dictBytes);
+            p += idBytes + dictBytes;
+        }
+        ch.lookups = std::make_unique<DictLookup[]>(ncols);
+    }
+}
+
+ColumnStore::Column ColumnStore::column(u32 col) const {
+    if (col >= _colCount) throw std::out_of_range("Column index out of range");
+    auto it = std::upper_bound(_chunks.begin(), _chunks.end(), col,
+                               [](u32 c, const Chunk& ch) { return c < ch.firstCol; });
+    if (it == _chunks.begin()) throw std::out_of_range("Column not present in column store");
+    --it;
+    const u32 i = col - it->firstCol;
+    if (i >= it->entries.size()) throw std::out_of_range("Column not present in column store");
+    return Column(it->base, it->entries[i], it->idRuns.data() + it->firstIdRun[i],
+                  it->dictRuns.data() + it->firstDictRun[i], &it->lookups[i]);
+}
+
+std::pair<ColumnStore::u32, ColumnStore::u32> ColumnStore::chunkColumns(u32 chunk) const {
+    if (chunk >= _chunks.size()) throw std::out_of_range("Chunk index out of range");
+    return {_chunks[chunk].firstCol, static_cast<u32>(_chunks[chunk].entries.size())};
+}
+
+const char* ColumnStore::Column::cellAt(u64 row) const {
+    if (row >= _entry.rowCount) throw std::out_of_range("Row index out of range");
+    const IdRun* r = _ids;
+    if (_entry.idRuns > 1) {
+        r = std::upper_bound(_ids, _ids + _entry.idRuns, row,
+                             [](u64 v, const IdRun& run) { return v < run.firstRow; }) - 1;
+    }
+    return _base + r->offset + (row - r->firstRow) * _entry.width;
+}
+
+std::int64_t ColumnStore::Column::id(u64 row) const {
+    if (type() != ColumnType::String) throw std::logic_error("Typed column has no dictionary ids");
+    const char* p = cellAt(row);
+    switch (_entry.width) {
+        case 1: { const auto v = *reinterpret_cast<const std::uint8_t*>(p);  return v == UINT8_MAX  ? -1 : v; }
+        case 2: { const auto v = *reinterpret_cast<const std::uint16_t*>(p); return v == UINT16_MAX ? -1 : v; }
+        case 4: { const auto v = *reinterpret_cast<const std::uint32_t*>(p); return v == UINT32_MAX ? -1 : v; }
+        default: throw std::runtime_error("Unsupported id width in column chunk");
+    }
+}
+
+std::string_view ColumnStore::Column::value(u64 id) const {
+    if (id >= _entry.dictCount) throw std::out_of_range("Dictionary id out of range");
+    const DictRun* d = _dict;
+    if (_entry.dictRuns > 1) {
+        d = std::upper_bound(_dict, _dict + _entry.dictRuns, id,
+                             [](u64 v, const DictRun& run) { return v < run.firstId; }) - 1;
+    }
+    const u64* index = reinterpret_cast<const u64*>(_base + d->indexOffset);
+    const u64 i = id - d->firstId;
+    return {_base + d->bytesOffset + index[i], static_cast<std::size_t>(index[i + 1] - index[i])};
+}
+
+std::string_view ColumnStore::Column::cell(u64 row) const {
+    const std::int64_t v = id(row);
+    return v < 0 ? std::string_view() : value(static_cast<u64>(v));
+}
+
+std::int64_t ColumnStore::Column::find(std::string_view v) const {
+    if (type() != ColumnType::String) throw std::logic_error("Column has no dictionary");
+    if (sortedDictionary()) {
+        const u64 id = findRange(v, v).first;
+        return id < _entry.dictCount && value(id) == v ? static_cast<std::int64_t>(id) : -1;
+    }
+    std::call_once(_lookup->built, [&] {
+        std::size_t nslots = 16;
+        while (nslots < _entry.dictCount * 2) nslots <<= 1;
+        _lookup->slots.assign(nslots, 0);
+        for (u64 id = 0; id < _entry.dictCount; ++id) {
+            std::size_t i = static_cast<std::size_t>(Dictionary::hash(value(id))) & (nslots - 1);
+            while (_lookup->slots[i]) i = (i + 1) & (nslots - 1);
+            _lookup->slots[i] = static_cast<u32>(id + 1);
+        }
+    });
+    const std::vector<u32>& slots = _lookup->slots;
+    const std::size_t mask = slots.size() - 1;
+    for (std::size_t i = static_cast<std::size_t>(Dictionary::hash(v)) & mask; slots[i]; i = (i + 1) & mask) {
+        if (value(slots[i] - 1) == v) return static_cast<std::int64_t>(slots[i] - 1);
+    }
+    return -1;
+}
+
+std::pair<ColumnStore::u64,ColumnStore::u64> ColumnStore::Column::findRange(std::string_view lo,
+                                                                           std::string_view hi) const {
+    if (!sortedDictionary()) throw std::logic_error("Column dictionary is not sorted");
+    // first id whose value is not below `bound` (or, with `past`, is above it)
+    auto bound = [&](std::string_view b, bool past) {
+        u64 first = 0, n = _entry.dictCount;
+        while (n > 0) {
+            const u64 half = n / 2;
+            const std::string_view v = value(first + half);
+            if (past ? v <= b : v < b) {
+                first += half + 1;
+                n -= half + 1;
+            } else {
+                n = half;
+            }
+        }
+        return first;
+    };
+    const u64 first = bound(lo, false);
+    return {first, std::max(first, bound(hi, true))};
+}
+
+bool ColumnStore::Column::isMissing(u64 row) const {
+    switch (type()) {
+        case ColumnType::String:  return id(row) < 0;
+        case ColumnType::Float64: return std::isnan(float64(row));
+        default:                  return int64(row) == INT64_MIN;
+    }
+}
+
+std::int64_t ColumnStore::Column::int64(u64 row) const {
+    switch (type()) {
+        case ColumnType::Int64: {
+            std::int64_t v;
+            std::memcpy(&v, cellAt(row), 8);
+            return v;
+        }
+        case ColumnType::Bool: {
+            const auto v = static_cast<std::uint8_t>(*cellAt(row));
+            return v == 0xFF ? INT64_MIN : v;
+        }
+        case ColumnType::Date: {
+            std::int32_t v;
+            std::memcpy(&v, cellAt(row), 4);
+            return v == INT32_MIN ? INT64_MIN : v;
+        }
+        default:
+            throw std::logic_error("Column has no integer values");
+    }
+}
+
+double ColumnStore::Column::float64(u64 row) const {
+    if (type() == ColumnType::Int64) {
+        const std::int64_t v = int64(row);
+        return v == INT64_MIN ? std::numeric_limits<double>::quiet_NaN() : static_cast<double>(v);
+    }
+    if (type() != ColumnType::Float64) throw std::logic_error("Column has no numeric values");
+    double v;
+    std::memcpy(&v, cellAt(row), 8);
+    return v;
+}
+
+std::string ColumnStore::Column::text(u64 row) const {
+    if (type() == ColumnType::String) return std::string(cell(row));
+    if (isMissing(row)) return std::string();
+
+    char buf[32];
+    std::to_chars_result r{};
+    switch (type()) {
+        case ColumnType::Float64: r = std::to_chars(buf, buf + sizeof(buf), float64(row)); break;
+        case ColumnType::Bool:    return int64(row) ? "true" : "false";
+        case ColumnType::Date: {
+            // days -> civil date (H. Hinnant's civil_from_days)
+            const std::int64_t z = int64(row) + 719468;
+            const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+            const unsigned doe = static_cast<unsigned>(z - era * 146097);
+            const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+            const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+            const unsigned mp = (5 * doy + 2) / 153;
+            const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+            const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+            const std::int64_t y = static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2);
+            std::snprintf(buf, sizeof(buf), "%04lld-%02u-%02u", static_cast<long long>(y), m, d);
+            return buf;
+        }
+        default:                  r = std::to_chars(buf, buf + sizeof(buf), int64(row)); break;
+    }
+    return std::string(buf, r.ptr);
+}
+
+} // namespace tabular
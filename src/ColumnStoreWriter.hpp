@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TabularData/ColumnStore.hpp"
+#include "Dictionary.hpp"
+#include "PackedColumn.hpp"
+#include "TypedColumn.hpp"
+
+namespace tabular {
+
+// Writes the format documented in ColumnStore.hpp, one chunk file per call
+// to writeChunk() or appendChunk(); finish() writes the manifest that makes
+// the set readable.
+class ColumnStoreWriter {
+public:
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+
+    // a new store in dir, replacing any there
+    ColumnStoreWriter(std::string dir, u64 rowCount, u32 colCount);
+    // Extends `existing`, the store in dir, to rowCount rows: appendChunk()
+    // once per chunk, in order. The store reads as before until finish().
+    ColumnStoreWriter(std::string dir, const ColumnStore& existing, u64 rowCount);
+
+    // segments is [nsegments][ncols]: consecutive row ranges of global ids,
+    // all segments of a column at the same width; dicts[c] is the global
+    // dictionary of column firstCol + c. A column whose types[c] isn't
+    // String is written from typed[t][c] instead, every run settled on it.
+    void writeChunk(u32 firstCol, u32 ncols, PackedColumn* const* segments, int nsegments,
+                    const std::vector<Dictionary>& dicts,
+                    TypedColumn* const* typed = nullptr, const std::vector<ColumnType>* types = nullptr);
+
+    // how appendChunk() extends a column
+    enum class Extension : std::uint8_t {
+        Append,     // the segments hold the new rows
+        RewriteIds, // they hold every row, at a wider id width
+        Rewrite,    // they hold every row, and dicts[c] reordered the ids
+    };
+    // Extends the next chunk of the existing store, segments and the rest
+    // as for writeChunk() (the types unchanged). dicts[c] holds the
+    // column's dictionary plus the new values; only the new ones are
+    // written, except for a Rewrite. The segments' rows are written as one
+    // more run, replacing the column's runs unless it's an Append. A chunk
+    // left with more dead bytes than live ones is copied compacted to
+    // <chunk>.new, which replaces it in finish().
+    void appendChunk(PackedColumn* const* segments, int nsegments, const std::vector<Dictionary>& dicts,
+                     const std::vector<Extension>& extensions,
+                     TypedColumn* const* typed = nullptr, const std::vector<ColumnType>* types = nullptr);
+
+    // bytes per value of a typed column
+    static u32 valueWidth(ColumnType type);
+    // An existing String column's dictionary (same ids) and ids, in the
+    // forms writeChunk() takes, for extending it without re-tokenizing.
+    static void loadDictionary(const ColumnStore::Column& col, Dictionary& dict);
+    static void loadIds(const ColumnStore::Column& col, PackedColumn& ids);
+
+    void finish();
+
+    static std::string chunkFileName(u32 chunkIndex);
+
+private:
+    struct ChunkInfo {
+        u32 firstCol;
+        u32 ncols;
+        u64 bytes;
+    };
+
+    std::string _dir;
+    u64 _rowCount;
+    u32 _colCount;
+    const ColumnStore* _existing = nullptr;
+    std::vector<ChunkInfo> _chunks;
+    std::vector<u32> _compacted; // chunks whose <chunk>.new replaces them in finish()
+};
+
+} // namespace tabular
@@ -0,0 +1,212 @@
+#include "CsvScanner.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TABULAR_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define TABULAR_NEON 1
+#endif
+
+namespace tabular {
+
+namespace {
+
+using u64 = std::uint64_t;
+
+void classify_scalar(const char* p, char delimiter, char quote, BlockMasks& m) {
+    BlockMasks r;
+    for (int i = 0; i < 64; ++i) {
+        const u64 bit = 1ull << i;
+        const char c = p[i];
+        if (c == quote) r.quote |= bit;
+        if (c == delimiter) r.delimiter |= bit;
+        switch (c) {
+            case '\r': r.cr |= bit; break;
+            case '\n': r.lf |= bit; break;
+            case ' ':
+            case '\t': break;
+            default:   r.nonBlank |= bit; break;
+        }
+    }
+    r.nonBlank |= r.delimiter;
+    m = r;
+}
+
+#ifdef TABULAR_X86
+void classify_sse2(const char* p, char delimiter, char quote, BlockMasks& m) {
+    const __m128i q  = _mm_set1_epi8(quote);
+    const __m128i c  = _mm_set1_epi8(delimiter);
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i sp = _mm_set1_epi8(' ');
+    const __m128i tb = _mm_set1_epi8('\t');
+    BlockMasks r;
+    for (int k = 0; k < 4; ++k) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+        const __m128i eqCr = _mm_cmpeq_epi8(v, cr);
+        const __m128i eqLf = _mm_cmpeq_epi8(v, lf);
+        const __m128i blank = _mm_or_si128(_mm_or_si128(eqCr, eqLf),
+                                           _mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, tb)));
+        const int shift = 16 * k;
+        r.quote    |= u64(unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(v, q))))  << shift;
+        r.delimiter |= u64(unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(v, c)))) << shift;
+        r.cr       |= u64(unsigned(_mm_movemask_epi8(eqCr)))                  << shift;
+        r.lf       |= u64(unsigned(_mm_movemask_epi8(eqLf)))                  << shift;
+        r.nonBlank |= u64(unsigned(~_mm_movemask_epi8(blank) & 0xFFFF))       << shift;
+    }
+    r.nonBlank |= r.delimiter;
+    m = r;
+}
+
+__attribute__((target("avx2")))
+void classify_avx2(const char* p, char delimiter, char quote, BlockMasks& m) {
+    const __m256i q  = _mm256_set1_epi8(quote);
+    const __m256i c  = _mm256_set1_epi8(delimiter);
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i sp = _mm256_set1_epi8(' ');
+    const __m256i tb = _mm256_set1_epi8('\t');
+    BlockMasks r;
+    for (int k = 0; k < 2; ++k) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * k));
+        const __m256i eqCr = _mm256_cmpeq_epi8(v, cr);
+        const __m256i eqLf = _mm256_cmpeq_epi8(v, lf);
+        const __m256i blank = _mm256_or_si256(_mm256_or_si256(eqCr, eqLf),
+                                              _mm256_or_si256(_mm256_cmpeq_epi8(v, sp), _mm256_cmpeq_epi8(v, tb)));
+        const int shift = 32 * k;
+        r.quote    |= u64(unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, q)))) << shift;
+        r.delimiter |= u64(unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, c)))) << shift;
+        r.cr       |= u64(unsigned(_mm256_movemask_epi8(eqCr)))                    << shift;
+        r.lf       |= u64(unsigned(_mm256_movemask_epi8(eqLf)))                    << shift;
+        r.nonBlank |= u64(~unsigned(_mm256_movemask_epi8(blank)))                  << shift;
+    }
+    r.nonBlank |= r.delimiter;
+    m = r;
+}
+#endif
+
+#ifdef TABULAR_NEON
+// 64 compare results (0x00/0xFF) -> 64-bit mask
+inline u64 neon_movemask(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d) {
+    const uint8x16_t bits = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t s0 = vpaddq_u8(vandq_u8(a, bits), vandq_u8(b, bits));
+    uint8x16_t s1 = vpaddq_u8(vandq_u8(c, bits), vandq_u8(d, bits));
+    s0 = vpaddq_u8(s0, s1);
+    s0 = vpaddq_u8(s0, s0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(s0), 0);
+}
+
+void classify_neon(const char* p, char delimiter, char quote, BlockMasks& m) {
+    const uint8_t* u = reinterpret_cast<const uint8_t*>(p);
+    uint8x16_t v[4];
+    for (int k = 0; k < 4; ++k) v[k] = vld1q_u8(u + 16 * k);
+    auto eq = [&](uint8_t ch, int k) { return vceqq_u8(v[k], vdupq_n_u8(ch)); };
+    auto blank = [&](int k) {
+        return vorrq_u8(vorrq_u8(eq('\r', k), eq('\n', k)), vorrq_u8(eq(' ', k), eq('\t', k)));
+    };
+    const uint8_t q = uint8_t(quote), d = uint8_t(delimiter);
+    m.quote     = neon_movemask(eq(q, 0),    eq(q, 1),    eq(q, 2),    eq(q, 3));
+    m.delimiter = neon_movemask(eq(d, 0),    eq(d, 1),    eq(d, 2),    eq(d, 3));
+    m.cr        = neon_movemask(eq('\r', 0), eq('\r', 1), eq('\r', 2), eq('\r', 3));
+    m.lf        = neon_movemask(eq('\n', 0), eq('\n', 1), eq('\n', 2), eq('\n', 3));
+    m.nonBlank  = ~neon_movemask(blank(0), blank(1), blank(2), blank(3)) | m.delimiter;
+}
+#endif
+
+struct Choice { ClassifyFn fn; const char* name; };
+
+Choice choose() {
+    const char* env = std::getenv("TABULAR_SIMD");
+    if (env) {
+        if (const ClassifyFn fn = classifierNamed(env)) return {fn, env};
+    }
+#ifdef TABULAR_X86
+    if (__builtin_cpu_supports("avx2")) return {classify_avx2, "avx2"};
+    return {classify_sse2, "sse2"};
+#elif defined(TABULAR_NEON)
+    return {classify_neon, "neon"};
+#else
+    return {classify_scalar, "scalar"};
+#endif
+}
+
+const Choice& chosen() {
+    static const Choice c = choose();
+    return c;
+}
+
+} // end anon
+
+ClassifyFn classifierNamed(const std::string& name) {
+    if (name == "scalar") return classify_scalar;
+#ifdef TABULAR_X86
+    if (name == "sse2") return classify_sse2;
+    if (name == "avx2" && __builtin_cpu_supports("avx2")) return classify_avx2;
+#elif defined(TABULAR_NEON)
+    if (name == "neon") return classify_neon;
+#endif
+    return nullptr;
+}
+
+ClassifyFn selectClassifier() { return chosen().fn; }
+const char* classifierName() { return chosen().name; }
+
+// ---- DialectScanner ----
+
+DialectScanner::DialectScanner(const Dialect& dialect, State state) : _state(state) {
+    std::memset(_role, Other, sizeof _role);
+    _role[static_cast<unsigned char>(' ')] = Blank;
+    _role[static_cast<unsigned char>('\t')] = Blank;
+    _role[static_cast<unsigned char>('\r')] = Terminator;
+    _role[static_cast<unsigned char>('\n')] = Terminator;
+    _role[static_cast<unsigned char>(dialect.delimiter)] = Delimiter;
+    if (dialect.quote) _role[static_cast<unsigned char>(dialect.quote)] = Quote;
+    if (dialect.escape) _role[static_cast<unsigned char>(dialect.escape)] = Escape;
+    if (dialect.comment) _role[static_cast<unsigned char>(dialect.comment)] = CommentMark;
+
+    for (int r = 0; r < kRoles; ++r) {
+        const Role role = static_cast<Role>(r);
+        const std::uint8_t unquoted = role == Terminator ? RowStart
+                                    : role == Quote      ? Quoted
+                                    : role == Escape     ? FieldEscaped
+                                                         : Field;
+        _next[RowStart][r]      = role == CommentMark ? static_cast<std::uint8_t>(Comment) : unquoted;
+        _next[Field][r]         = unquoted;
+        _next[Quoted][r]        = role == Quote ? Field : role == Escape ? QuotedEscaped : Quoted;
+        _next[Comment][r]       = role == Terminator ? RowStart : Comment;
+        _next[FieldEscaped][r]  = Field;
+        _next[QuotedEscaped][r] = Quoted;
+    }
+}
+
+void DialectScanner::transitions(std::string_view bytes, State (&end)[kStates]) const {
+    std::uint8_t s[kStates];
+    for (int k = 0; k < kStates; ++k) s[k] = static_cast<std::uint8_t>(k);
+    for (const char ch : bytes) {
+        const std::uint8_t role = _role[static_cast<unsigned char>(ch)];
+        for (int k = 0; k < kStates; ++k) s[k] = _next[s[k]][role];
+    }
+    for (int k = 0; k < kStates; ++k) end[k] = static_cast<State>(s[k]);
+}
+
+// ---- Dialect ----
+
+void Dialect::validate() const {
+    auto line_byte = [](char c) { return c == '\r' || c == '\n'; };
+    if (delimiter == '\0' || line_byte(delimiter))
+        throw std::invalid_argument("Dialect: the delimiter must not be NUL, CR or LF");
+    if (line_byte(quote) || line_byte(escape) || line_byte(comment))
+        throw std::invalid_argument("Dialect: quote, escape and comment must not be CR or LF");
+    const char roles[] = {delimiter, quote, escape, comment};
+    for (int a = 0; a < 4; ++a)
+        for (int b = a + 1; b < 4; ++b)
+            if (roles[a] != '\0' && roles[a] == roles[b])
+                throw std::invalid_argument(std::string("Dialect: byte '") + roles[a] + "' has two roles");
+}
+
+} // namespace tabular
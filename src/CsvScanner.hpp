@@ -0,0 +1,219 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "TabularData/Dialect.hpp"
+
+namespace tabular {
+
+// Bitmasks over one 64-byte block; bit i describes byte i.
+struct BlockMasks {
+    std::uint64_t quote     = 0;
+    std::uint64_t delimiter = 0;
+    std::uint64_t cr        = 0;
+    std::uint64_t lf        = 0;
+    std::uint64_t nonBlank  = 0; // anything but ' ', '\t', '\r', '\n'; the delimiter always counts
+};
+
+// The classifiers compare against broadcast registers, so the delimiter and
+// quote are runtime bytes at no cost per block. A '\0' quote still sets bits
+// for NUL bytes: StructuralScanner masks them off.
+using ClassifyFn = void (*)(const char* p, char delimiter, char quote, BlockMasks& m);
+
+// Best classifier for this CPU (AVX2, SSE2, NEON or scalar), picked once.
+// TABULAR_SIMD=scalar|sse2|avx2|neon in the environment forces one.
+ClassifyFn selectClassifier();
+const char* classifierName();
+
+// The classifier called `name` (as in TABULAR_SIMD), or nullptr when this
+// build or CPU has none by that name
+ClassifyFn classifierNamed(const std::string& name);
+
+// inclusive prefix xor: bit i = xor of bits 0..i
+inline std::uint64_t prefixXor(std::uint64_t x) {
+    x ^= x << 1;  x ^= x << 2;  x ^= x << 4;
+    x ^= x << 8;  x ^= x << 16; x ^= x << 32;
+    return x;
+}
+
+// Finds row boundaries across consecutive spans, 64 bytes at a time. Quoted
+// regions come from prefix-xor of the quote mask ("" toggles twice and so
+// stays quoted); a row ends at LF or at a CR not followed by LF, outside
+// quotes. Matches the byte-wise rules of the header parser. Handles the
+// dialects without an escape or comment byte.
+class StructuralScanner {
+public:
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+
+    explicit StructuralScanner(const Dialect& dialect = Dialect::csv(), bool inQuotes = false)
+        : _classify(selectClassifier()), _delimiter(dialect.delimiter), _quote(dialect.quote),
+          _quoteMask(dialect.quote != '\0' ? ~0ull : 0), _inQuotes(inQuotes ? ~0ull : 0) {}
+
+    // Calls onRow(nextStart, delimiterCount, notBlank) for every row ending in
+    // span; onRow returns false to stop. byteAfter is the byte following the
+    // span (-1 at EOF) so a CR at the very end can pair with the next LF.
+    // Returns false when onRow stopped the scan.
+    template <class OnRow>
+    bool scan(std::string_view span, u64 spanOffset, int byteAfter, OnRow&& onRow) {
+        const std::size_t n = span.size();
+        for (std::size_t i = 0; i < n; i += 64) {
+            const std::size_t len = (n - i < 64) ? n - i : 64;
+            const char* p = span.data() + i;
+            char tail[64];
+            if (len < 64) {
+                std::memcpy(tail, p, len);
+                std::memset(tail + len, 0, 64 - len);
+                p = tail;
+            }
+
+            BlockMasks m;
+            _classify(p, _delimiter, _quote, m);
+            const u64 valid = (len == 64) ? ~0ull : ((1ull << len) - 1);
+
+            const u64 inside = prefixXor(m.quote & _quoteMask & valid) ^ _inQuotes;
+            _inQuotes = (inside >> (len - 1)) & 1 ? ~0ull : 0;
+
+            const u64 outside  = ~inside & valid;
+            const u64 comma    = m.delimiter & outside;
+            const u64 lf       = m.lf & outside;
+            const u64 cr       = m.cr & outside;
+            const u64 notBlank = (m.nonBlank | inside) & valid;
+
+            const int next = (i + 64 < n) ? static_cast<unsigned char>(span[i + 64]) : byteAfter;
+            const u64 lfAhead = (lf >> 1) | (next == '\n' ? (1ull << (len - 1)) : 0);
+            u64 term = lf | (cr & ~lfAhead);
+
+            u64 consumed = 0;
+            while (term) {
+                const int b = __builtin_ctzll(term);
+                const u64 upto = (b == 63) ? ~0ull : ((2ull << b) - 1);
+                const u64 row = upto & ~consumed;
+                _commas  += static_cast<u32>(__builtin_popcountll(comma & row));
+                _notBlank = _notBlank || (notBlank & row) != 0;
+                consumed = upto;
+
+                const bool more = onRow(spanOffset + i + static_cast<u64>(b) + 1, _commas, _notBlank);
+                _commas = 0;
+                _notBlank = false;
+                if (!more) return false;
+                term &= term - 1;
+            }
+            const u64 rest = valid & ~consumed;
+            _commas  += static_cast<u32>(__builtin_popcountll(comma & rest));
+            _notBlank = _notBlank || (notBlank & rest) != 0;
+        }
+        return true;
+    }
+
+    // the row still open after the last span (EOF without terminator)
+    u32 pendingCommas() const { return _commas; }
+    bool pendingNotBlank() const { return _notBlank; }
+    bool inQuotes() const { return _inQuotes != 0; }
+
+private:
+    ClassifyFn _classify;
+    char _delimiter, _quote;
+    u64  _quoteMask;      // all-ones when the dialect quotes
+    u64  _inQuotes;       // all-ones while the previous block ended inside quotes
+    u32  _commas = 0;
+    bool _notBlank = false;
+};
+
+// Byte-at-a-time row finder for dialects with an escape or comment byte,
+// with StructuralScanner's interface and notBlank rules. A comment row is
+// reported like a blank one. The state after any byte depends only on the
+// state before it and the byte's role, so a morsel's end state can be
+// computed for every start state at once (transitions()).
+class DialectScanner {
+public:
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+
+    enum State : std::uint8_t {
+        RowStart,       // nothing of the row read yet
+        Field,          // in the row, outside quotes
+        Quoted,
+        Comment,
+        FieldEscaped,   // the byte after an escape, outside quotes
+        QuotedEscaped,  // ... inside quotes
+    };
+    static constexpr int kStates = 6;
+
+    explicit DialectScanner(const Dialect& dialect, State state = RowStart);
+
+    template <class OnRow>
+    bool scan(std::string_view span, u64 spanOffset, int byteAfter, OnRow&& onRow) {
+        const std::size_t n = span.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            const unsigned char c = static_cast<unsigned char>(span[i]);
+            const Role role = static_cast<Role>(_role[c]);
+            const State next = static_cast<State>(_next[_state][role]);
+
+            if (role == Terminator && (_state == RowStart || _state == Field || _state == Comment)) {
+                const int after = (i + 1 < n) ? static_cast<unsigned char>(span[i + 1]) : byteAfter;
+                if (c == '\r' && after == '\n') continue; // the LF ends the row
+                const bool more = onRow(spanOffset + i + 1, _commas, _notBlank);
+                _commas = 0;
+                _notBlank = false;
+                _state = next;
+                if (!more) return false;
+                continue;
+            }
+            if (next != Comment) {
+                const bool literal = _state == Quoted || _state == QuotedEscaped || _state == FieldEscaped;
+                if (role == Delimiter && !literal) ++_commas;
+                _notBlank = _notBlank || literal || (role != Blank && role != Terminator);
+            }
+            _state = next;
+        }
+        return true;
+    }
+
+    u32 pendingCommas() const { return _commas; }
+    bool pendingNotBlank() const { return _notBlank; }
+    State state() const { return _state; }
+
+    // end state of `bytes` for every start state
+    void transitions(std::string_view bytes, State (&end)[kStates]) const;
+
+private:
+    enum Role : std::uint8_t { Other, Blank, Terminator, Delimiter, Quote, Escape, CommentMark, kRoles };
+
+    std::uint8_t _role[256];
+    std::uint8_t _next[kStates][kRoles];
+    State _state;
+    u32  _commas = 0;
+    bool _notBlank = false;
+};
+
+// The scanner for a dialect: StructuralScanner unless it has an escape or
+// comment byte. Picked at construction; the per-byte loops stay monomorphic.
+// `state` is where the first byte is read from: DialectScanner::State, of
+// which only RowStart/Field (0/1 -> outside) and Quoted matter here.
+class RowScanner {
+public:
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+
+    explicit RowScanner(const Dialect& dialect, DialectScanner::State state = DialectScanner::RowStart)
+        : _generic(dialect.generic()), _fast(dialect, state == DialectScanner::Quoted), _slow(dialect, state) {}
+
+    template <class OnRow>
+    bool scan(std::string_view span, u64 spanOffset, int byteAfter, OnRow&& onRow) {
+        return _generic ? _slow.scan(span, spanOffset, byteAfter, onRow)
+                        : _fast.scan(span, spanOffset, byteAfter, onRow);
+    }
+
+    u32 pendingCommas() const { return _generic ? _slow.pendingCommas() : _fast.pendingCommas(); }
+    bool pendingNotBlank() const { return _generic ? _slow.pendingNotBlank() : _fast.pendingNotBlank(); }
+
+private:
+    bool _generic;
+    StructuralScanner _fast;
+    DialectScanner _slow;
+};
+
+} // namespace tabular
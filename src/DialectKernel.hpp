@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+
+#include "TabularData/Dialect.hpp"
+
+namespace tabular {
+
+// Byte roles of a dialect for the byte-wise parsers (RowTokenizer, the header
+// row). FixedDialect answers with constants, so its loops compare against
+// immediates and the escape test folds away; RuntimeDialect reads the
+// Dialect's bytes and is the fallback for everything else.
+template <char Delimiter>
+struct FixedDialect {
+    static constexpr char quote = '"';
+    static constexpr bool isDelimiter(char c) { return c == Delimiter; }
+    static constexpr bool isQuote(char c) { return c == '"'; }
+    static constexpr bool isEscape(char) { return false; }
+};
+
+struct RuntimeDialect {
+    explicit RuntimeDialect(const Dialect& d)
+        : delimiter(d.delimiter), quote(d.quote), escape(d.escape),
+          quoteOn(d.quote != '\0'), escapeOn(d.escape != '\0') {}
+
+    bool isDelimiter(char c) const { return c == delimiter; }
+    bool isQuote(char c) const { return quoteOn && c == quote; }
+    bool isEscape(char c) const { return escapeOn && c == escape; }
+
+    char delimiter, quote, escape;
+    bool quoteOn, escapeOn;
+};
+
+enum class DialectKind : std::uint8_t { Csv, Tsv, Pipe, Runtime };
+
+inline DialectKind kindOf(const Dialect& d) {
+    if (d.generic() || d.quote != '"') return DialectKind::Runtime;
+    switch (d.delimiter) {
+        case ',':  return DialectKind::Csv;
+        case '\t': return DialectKind::Tsv;
+        case '|':  return DialectKind::Pipe;
+        default:   return DialectKind::Runtime;
+    }
+}
+
+// fn(kernel) with the kernel for `kind`; pick the kind once per pass
+template <class Fn>
+decltype(auto) withDialect(DialectKind kind, const Dialect& d, Fn&& fn) {
+    switch (kind) {
+        case DialectKind::Csv:  return fn(FixedDialect<','>{});
+        case DialectKind::Tsv:  return fn(FixedDialect<'\t'>{});
+        case DialectKind::Pipe: return fn(FixedDialect<'|'>{});
+        default:                return fn(RuntimeDialect(d));
+    }
+}
+
+} // namespace tabular
@@ -0,0 +1,47 @@
+#include "Dictionary.hpp"
+
+#include <algorithm>
+
+namespace tabular {
+
+std::string_view StringArena::store(std::string_view s) {
+    if (s.empty()) return {};
+    if (s.size() > _left) {
+        // oversized values get a block of their own
+        const std::size_t next = std::min(kBlockSize, std::max(kFirstBlock, _reserved));
+        const std::size_t n = std::max(next, s.size());
+        _blocks.emplace_back(new char[n]);
+        _cur = _blocks.back().get();
+        _left = n;
+        _reserved += n;
+    }
+    std::memcpy(_cur, s.data(), s.size());
+    std::string_view out(_cur, s.size());
+    _cur += s.size();
+    _left -= s.size();
+    return out;
+}
+
+void Dictionary::grow() { rehash(_slots.empty() ? 16 : _slots.size() * 2); }
+
+void Dictionary::reserve(std::size_t n) {
+    if (n == 0) return;
+    std::size_t cap = std::max<std::size_t>(16, _slots.size());
+    while ((n + 1) * 10 > cap * 7) cap *= 2;
+    if (cap > _slots.size()) rehash(cap);
+    _entries.reserve(n);
+}
+
+void Dictionary::rehash(std::size_t cap) {
+    std::vector<Slot> slots(cap);
+    const std::size_t mask = cap - 1;
+    for (u32 id = 0; id < _entries.size(); ++id) {
+        const u64 h = _entries[id].hash;
+        std::size_t i = static_cast<std::size_t>(h) & mask;
+        while (slots[i].idPlus1 != 0) i = (i + 1) & mask;
+        slots[i] = {id + 1, static_cast<u32>(h >> 32)};
+    }
+    _slots.swap(slots);
+}
+
+} // namespace tabular
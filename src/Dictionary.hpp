@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace tabular {
+
+// Append-only byte storage. Views handed out stay valid for the arena's life.
+class StringArena {
+public:
+    std::string_view store(std::string_view s);
+    std::size_t bytesReserved() const { return _reserved; }
+
+private:
+    // blocks double from kFirstBlock up to kBlockSize, so the many small
+    // dictionaries of a wide chunk don't each pin 64 KiB
+    static constexpr std::size_t kFirstBlock = 256;
+    static constexpr std::size_t kBlockSize = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> _blocks;
+    char*       _cur  = nullptr;
+    std::size_t _left = 0;
+    std::size_t _reserved = 0;
+};
+
+// Distinct-value dictionary for one column: string -> dense id in insertion
+// order. Open addressing with linear probing; keys live in an arena and each
+// entry keeps its hash so merges into another Dictionary never rehash bytes.
+class Dictionary {
+public:
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+
+    static u64 hash(std::string_view s) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(s.data());
+        std::size_t n = s.size();
+        u64 h = 0x9E3779B97F4A7C15ull ^ (n * 0xC2B2AE3D27D4EB4Full);
+        while (n >= 8) {
+            u64 k; std::memcpy(&k, p, 8);
+            h = (h ^ mix(k)) * 0x9FB21C651E98DF25ull;
+            p += 8; n -= 8;
+        }
+        if (n) {
+            u64 k = 0; std::memcpy(&k, p, n);
+            h = (h ^ mix(k)) * 0x9FB21C651E98DF25ull;
+        }
+        return mix(h);
+    }
+
+    u32 intern(std::string_view key) { return intern(key, hash(key)); }
+
+    // id of key, inserting it (copied into the arena) when absent
+    u32 intern(std::string_view key, u64 h) {
+        if ((_entries.size() + 1) * 10 > _slots.size() * 7) grow();
+        const std::size_t mask = _slots.size() - 1;
+        const u32 tag = static_cast<u32>(h >> 32);
+        for (std::size_t i = static_cast<std::size_t>(h) & mask;; i = (i + 1) & mask) {
+            Slot& s = _slots[i];
+            if (s.idPlus1 == 0) {
+                const u32 id = static_cast<u32>(_entries.size());
+                _entries.push_back({_arena.store(key), h});
+                s = {id + 1, tag};
+                return id;
+            }
+            if (s.tag == tag && _entries[s.idPlus1 - 1].key == key) return s.idPlus1 - 1;
+        }
+    }
+
+    // id of key, or -1
+    std::int64_t find(std::string_view key) const { return find(key, hash(key)); }
+    std::int64_t find(std::string_view key, u64 h) const {
+        if (_slots.empty()) return -1;
+        const std::size_t mask = _slots.size() - 1;
+        const u32 tag = static_cast<u32>(h >> 32);
+        for (std::size_t i = static_cast<std::size_t>(h) & mask;; i = (i + 1) & mask) {
+            const Slot& s = _slots[i];
+            if (s.idPlus1 == 0) return -1;
+            if (s.tag == tag && _entries[s.idPlus1 - 1].key == key) return s.idPlus1 - 1;
+        }
+    }
+
+    std::size_t size() const { return _entries.size(); }
+    // room for n keys without growing, e.g. from a cardinality estimate
+    void reserve(std::size_t n);
+    std::string_view key(u32 id) const { return _entries[id].key; }
+    u64 hashAt(u32 id) const { return _entries[id].hash; }
+
+    // heap bytes held: keys, entries and slots
+    std::size_t memoryBytes() const {
+        return _arena.bytesReserved() + _entries.capacity() * sizeof(Entry) + _slots.capacity() * sizeof(Slot);
+    }
+
+private:
+    struct Slot  { u32 idPlus1 = 0; u32 tag = 0; };   // 0 = empty
+    struct Entry { std::string_view key; u64 hash; };
+
+    static u64 mix(u64 x) {
+        x ^= x >> 33; x *= 0xFF51AFD7ED558CCDull;
+        x ^= x >> 33; x *= 0xC4CEB9FE1A85EC53ull;
+        x ^= x >> 33;
+        return x;
+    }
+
+    void grow();
+    void rehash(std::size_t cap);
+
+    std::vector<Slot>  _slots;
+    std::vector<Entry> _entries;
+    StringArena        _arena;
+};
+
+} // namespace tabular
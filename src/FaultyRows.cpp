@@ -0,0 +1,63 @@
+#include "TabularData/FaultyRows.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace tabular {
+
+std::string FaultyRowReport::path(const std::string& outputDir) {
+    return (fs::path(outputDir) / "faulty_rows.bin").string();
+}
+
+bool FaultyRowReport::load(const std::string& outputDir, FaultyRowReport& out) {
+    std::ifstream in(path(outputDir), std::ios::binary);
+    if (!in) return false;
+    u32 head[2] = {};
+    u64 count = 0;
+    u32 meta[2] = {};
+    in.read(reinterpret_cast<char*>(head), sizeof(head));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    in.read(reinterpret_cast<char*>(meta), sizeof(meta));
+    if (!in || head[0] != kMagic || head[1] != kVersion) return false;
+    std::error_code ec;
+    const u64 bytes = fs::file_size(path(outputDir), ec);
+    if (ec || bytes != 24 + count * 16) return false;
+
+    out.expected = meta[0];
+    out.rows.resize(static_cast<std::size_t>(count));
+    for (FaultyRow& row : out.rows) {
+        u32 rest[2];
+        in.read(reinterpret_cast<char*>(&row.offset), sizeof(row.offset));
+        in.read(reinterpret_cast<char*>(rest), sizeof(rest));
+        row.found = rest[0];
+    }
+    return static_cast<bool>(in);
+}
+
+void FaultyRowReport::save(const std::string& outputDir) const {
+    const std::string p = path(outputDir);
+    std::ofstream out(p, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Failed to open faulty row report for writing: " + p);
+    const u32 head[2] = {kMagic, kVersion};
+    const u64 count = rows.size();
+    const u32 meta[2] = {expected, 0};
+    out.write(reinterpret_cast<const char*>(head), sizeof(head));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(meta), sizeof(meta));
+    for (const FaultyRow& row : rows) {
+        const u32 rest[2] = {row.found, 0};
+        out.write(reinterpret_cast<const char*>(&row.offset), sizeof(row.offset));
+        out.write(reinterpret_cast<const char*>(rest), sizeof(rest));
+    }
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write faulty row report: " + p);
+}
+
+void FaultyRowReport::remove(const std::string& outputDir) {
+    std::error_code ec;
+    fs::remove(path(outputDir), ec);
+}
+
+} // namespace tabular
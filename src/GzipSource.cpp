@@ -0,0 +1,296 @@
+#include "GzipSource.hpp"
+#include "Dictionary.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <zlib.h>
+
+namespace tabular {
+
+namespace {
+
+using u32 = std::uint32_t;
+using u64 = std::uint64_t;
+
+constexpr u32 kIndexMagic   = 0x5a474454; // "TDGZ"
+constexpr u32 kIndexVersion = 1;
+constexpr u64 kSampleBytes  = 64 * 1024;
+constexpr std::size_t kWindow = 32 * 1024; // deflate's history limit
+constexpr std::size_t kInput  = 256 * 1024;
+
+// ------------------------------ inflate state ----------------------------
+// A zlib stream fed from the compressed source at a tracked offset.
+class Inflater {
+public:
+    // windowBits 31: a gzip member header comes first; -15: raw deflate
+    Inflater(const InputSource& raw, u64 at, int windowBits)
+        : _raw(raw), _in(kInput), _next(at), _wrapped(windowBits > 0) {
+        if (inflateInit2(&_strm, windowBits) != Z_OK) throw std::runtime_error("inflateInit2 failed");
+    }
+    ~Inflater() { inflateEnd(&_strm); }
+    Inflater(const Inflater&) = delete;
+    Inflater& operator=(const Inflater&) = delete;
+
+    z_stream& strm() { return _strm; }
+
+    // compressed offset of the next byte inflate() will take
+    u64 consumed() const { return _next - _strm.avail_in; }
+
+    // false at the end of the compressed bytes
+    bool refill() {
+        if (_strm.avail_in > 0) return true;
+        const std::size_t n = _raw.readInto(_next, _in.size(), reinterpret_cast<char*>(_in.data()));
+        _next += n;
+        _strm.next_in = _in.data();
+        _strm.avail_in = static_cast<uInt>(n);
+        return n > 0;
+    }
+
+    // After Z_STREAM_END: start on the member that follows, if one does.
+    // Raw deflate stops short of the member's 8-byte trailer; anything past
+    // it but another gzip header is padding and ends the file.
+    bool nextMember() {
+        const u64 at = consumed() + (_wrapped ? 0 : 8);
+        unsigned char magic[2] = {};
+        if (_raw.readInto(at, 2, reinterpret_cast<char*>(magic)) != 2 || magic[0] != 0x1f || magic[1] != 0x8b) return false;
+        if (inflateReset2(&_strm, 31) != Z_OK) throw std::runtime_error("inflateReset2 failed");
+        _next = at;
+        _strm.avail_in = 0;
+        _wrapped = true;
+        return true;
+    }
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error(what + ": " + _raw.path() + (_strm.msg ? std::string(": ") + _strm.msg : std::string()));
+    }
+
+private:
+    const InputSource& _raw;
+    z_stream _strm {};
+    std::vector<unsigned char> _in;
+    u64 _next;
+    bool _wrapped;
+};
+
+u64 hash_raw(const InputSource& src, u64 offset, u64 len) {
+    std::vector<char> scratch;
+    return Dictionary::hash(src.read(offset, static_cast<std::size_t>(len), scratch));
+}
+
+template <class T>
+bool get(std::ifstream& in, T& v) { return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(v))); }
+
+template <class T>
+void put(std::ofstream& out, const T& v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); }
+
+} // end anon
+
+bool isGzip(const InputSource& src) {
+    std::vector<char> scratch;
+    const std::string_view head = src.read(0, 2, scratch);
+    return head.size() == 2 && static_cast<unsigned char>(head[0]) == 0x1f && static_cast<unsigned char>(head[1]) == 0x8b;
+}
+
+GzipInputSource::GzipInputSource(std::shared_ptr<InputSource> raw, const std::string& indexPath)
+    : InputSource(raw->path()), _raw(std::move(raw)) {
+    if (!indexPath.empty() && load(indexPath)) {
+        _reused = true;
+        return;
+    }
+    build();
+    if (!indexPath.empty()) save(indexPath);
+}
+
+// ------------------------------ access points ----------------------------
+
+void GzipInputSource::build() {
+    // zlib's examples/zran.c: inflate a block at a time into a circular
+    // window, and at a block boundary (not inside the last block, whose end
+    // is the member's) record where it is once the span has filled
+    Inflater z(*_raw, 0, 31);
+    z_stream& strm = z.strm();
+    std::vector<unsigned char> window(kWindow);
+    u64 out = 0, last = 0;
+    bool first = true;
+    strm.avail_out = 0;
+    for (;;) {
+        const bool more = z.refill(); // a copy in progress can outlast the input
+        if (strm.avail_out == 0) {
+            strm.next_out = window.data();
+            strm.avail_out = static_cast<uInt>(kWindow);
+        }
+        const uInt room = strm.avail_out;
+        const int ret = inflate(&strm, Z_BLOCK);
+        out += room - strm.avail_out;
+        if (ret == Z_STREAM_END) {
+            if (!z.nextMember()) break;
+            continue;
+        }
+        if (ret == Z_BUF_ERROR && !more) z.fail("Truncated gzip input");
+        if (ret != Z_OK && ret != Z_BUF_ERROR) z.fail("Corrupt gzip input");
+
+        if ((strm.data_type & 128) && !(strm.data_type & 64) && (first || out - last >= GZIP_INDEX_SPAN)) {
+            Point p;
+            p.out = out;
+            p.in = z.consumed();
+            p.bits = static_cast<unsigned>(strm.data_type & 7);
+            // the last min(out, 32 KiB) bytes, oldest first
+            const std::size_t newest = kWindow - strm.avail_out;
+            if (out >= kWindow) {
+                p.window.assign(window.begin() + static_cast<std::ptrdiff_t>(newest), window.end());
+                p.window.insert(p.window.end(), window.begin(), window.begin() + static_cast<std::ptrdiff_t>(newest));
+            } else {
+                p.window.assign(window.begin(), window.begin() + static_cast<std::ptrdiff_t>(newest));
+            }
+            _points.push_back(std::move(p));
+            last = out;
+            first = false;
+        }
+    }
+    if (_points.empty()) z.fail("Corrupt gzip input");
+    _size = out;
+}
+
+void GzipInputSource::fingerprint(u64& head, u64& tail) const {
+    const u64 bytes = _raw->size();
+    const u64 n = std::min(bytes, kSampleBytes);
+    head = hash_raw(*_raw, 0, n);
+    tail = hash_raw(*_raw, bytes - n, n);
+}
+
+bool GzipInputSource::load(const std::string& indexPath) {
+    std::ifstream in(indexPath, std::ios::binary);
+    if (!in) return false;
+    u32 magic = 0, version = 0;
+    u64 bytes = 0, head = 0, tail = 0, size = 0, count = 0;
+    if (!get(in, magic) || !get(in, version) || magic != kIndexMagic || version != kIndexVersion) return false;
+    if (!get(in, bytes) || !get(in, head) || !get(in, tail) || !get(in, size) || !get(in, count)) return false;
+
+    // an index of other compressed bytes (the file was replaced or grew)
+    u64 nowHead = 0, nowTail = 0;
+    if (bytes != _raw->size()) return false;
+    fingerprint(nowHead, nowTail);
+    if (head != nowHead || tail != nowTail || count == 0) return false;
+
+    std::vector<Point> points(static_cast<std::size_t>(count));
+    for (Point& p : points) {
+        u32 bits = 0, window = 0;
+        if (!get(in, p.out) || !get(in, p.in) || !get(in, bits) || !get(in, window) || bits > 7 || window > kWindow) return false;
+        p.bits = bits;
+        p.window.resize(window);
+        if (!in.read(reinterpret_cast<char*>(p.window.data()), window)) return false;
+    }
+    _points = std::move(points);
+    _size = size;
+    return true;
+}
+
+void GzipInputSource::save(const std::string& indexPath) const {
+    std::ofstream out(indexPath, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Failed to open gzip index for writing: " + indexPath);
+    u64 head = 0, tail = 0;
+    fingerprint(head, tail);
+    put(out, kIndexMagic);
+    put(out, kIndexVersion);
+    put(out, _raw->size());
+    put(out, head);
+    put(out, tail);
+    put(out, _size);
+    put(out, static_cast<u64>(_points.size()));
+    for (const Point& p : _points) {
+        put(out, p.out);
+        put(out, p.in);
+        put(out, static_cast<u32>(p.bits));
+        put(out, static_cast<u32>(p.window.size()));
+        out.write(reinterpret_cast<const char*>(p.window.data()), static_cast<std::streamsize>(p.window.size()));
+    }
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write gzip index: " + indexPath);
+}
+
+// --------------------------------- reads ---------------------------------
+
+std::size_t GzipInputSource::spanAt(u64 offset) const {
+    const auto it = std::upper_bound(_points.begin(), _points.end(), offset,
+                                     [](u64 off, const Point& p) { return off < p.out; });
+    return static_cast<std::size_t>(it - _points.begin()) - 1;
+}
+
+GzipInputSource::Span GzipInputSource::decode(std::size_t k) const {
+    const Point& p = _points[k];
+    const u64 want = (k + 1 < _points.size() ? _points[k + 1].out : _size) - p.out;
+
+    Inflater z(*_raw, p.in, -15);
+    z_stream& strm = z.strm();
+    if (p.bits) {
+        char partial = 0;
+        if (_raw->readInto(p.in - 1, 1, &partial) != 1) z.fail("Truncated gzip input");
+        inflatePrime(&strm, static_cast<int>(p.bits), static_cast<unsigned char>(partial) >> (8 - p.bits));
+    }
+    if (!p.window.empty()) inflateSetDictionary(&strm, p.window.data(), static_cast<uInt>(p.window.size()));
+
+    auto bytes = std::make_shared<std::vector<char>>(static_cast<std::size_t>(want));
+    strm.next_out = reinterpret_cast<Bytef*>(bytes->data());
+    strm.avail_out = static_cast<uInt>(want);
+    while (strm.avail_out > 0) {
+        const bool more = z.refill();
+        const int ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            if (!z.nextMember()) break;
+            continue;
+        }
+        if (ret == Z_BUF_ERROR && !more) z.fail("Truncated gzip input");
+        if (ret != Z_OK && ret != Z_BUF_ERROR) z.fail("Corrupt gzip input");
+    }
+    if (strm.avail_out > 0) z.fail("gzip input changed since it was indexed");
+    return bytes;
+}
+
+GzipInputSource::Span GzipInputSource::span(std::size_t k) const {
+    {
+        std::lock_guard<std::mutex> lock(_mu);
+        for (Cached& c : _cache) {
+            if (c.index == k) {
+                c.used = ++_tick;
+                return c.bytes;
+            }
+        }
+    }
+    // decoded outside the lock; two readers missing together both decode
+    Span bytes = decode(k);
+    std::lock_guard<std::mutex> lock(_mu);
+    if (_cache.size() < GZIP_CACHED_SPANS) {
+        _cache.push_back({k, bytes, ++_tick});
+    } else {
+        auto oldest = std::min_element(_cache.begin(), _cache.end(),
+                                       [](const Cached& a, const Cached& b) { return a.used < b.used; });
+        *oldest = {k, bytes, ++_tick};
+    }
+    return bytes;
+}
+
+std::string_view GzipInputSource::read(u64 offset, std::size_t len, std::vector<char>& scratch) const {
+    if (offset >= _size) return {};
+    len = static_cast<std::size_t>(std::min<u64>(len, _size - offset));
+    if (scratch.size() < len) scratch.resize(len);
+    return {scratch.data(), readInto(offset, len, scratch.data())};
+}
+
+std::size_t GzipInputSource::readInto(u64 offset, std::size_t len, char* dst) const {
+    if (offset >= _size) return 0;
+    len = static_cast<std::size_t>(std::min<u64>(len, _size - offset));
+    std::size_t done = 0;
+    for (std::size_t k = spanAt(offset); done < len; ++k) {
+        const Span bytes = span(k);
+        const u64 at = offset + done - _points[k].out;
+        const std::size_t n = static_cast<std::size_t>(std::min<u64>(len - done, bytes->size() - at));
+        std::memcpy(dst + done, bytes->data() + at, n);
+        done += n;
+    }
+    return done;
+}
+
+} // namespace tabular
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "TabularData/InputSource.hpp"
+
+// Uncompressed bytes between access points. Smaller spans make random row
+// fetches cheaper and the index larger (one 32 KiB window per point).
+#ifndef GZIP_INDEX_SPAN
+#define GZIP_INDEX_SPAN (4u << 20)
+#endif
+
+// Decoded spans kept for reuse across reads (GZIP_INDEX_SPAN bytes each).
+#ifndef GZIP_CACHED_SPANS
+#define GZIP_CACHED_SPANS 16
+#endif
+
+namespace tabular {
+
+// True when src starts with the gzip magic bytes.
+bool isGzip(const InputSource& src);
+
+// The decompressed bytes of a gzip file (one member or several back to
+// back, as pigz and bgzip write them), readable at any offset. Opening it
+// decodes the file once to place an access point every GZIP_INDEX_SPAN
+// bytes of output: the compressed bit position of a deflate block boundary
+// and the 32 KiB of output before it. A read resumes inflating at the
+// access point before its offset, so an offset in row_offsets.bin resolves
+// to {point, bytes into its span} and concurrent morsels or row fetches
+// each decode only the spans they touch.
+//
+// The access points are kept in `indexPath` (unless empty) and reused by
+// the next open of the same compressed bytes:
+//
+//   u32 magic      'TDGZ'
+//   u32 version    1
+//   u64 fileBytes  compressed size
+//   u64 headHash   hash of the first min(fileBytes, 64 KiB) compressed bytes
+//   u64 tailHash   hash of the last min(fileBytes, 64 KiB) compressed bytes
+//   u64 size       decompressed size
+//   u64 count      access points, then per point:
+//     u64 out      decompressed offset
+//     u64 in       compressed offset of the first full byte after it
+//     u32 bits     bits of the byte before `in` that belong to it
+//     u32 window   bytes of history that follow
+class GzipInputSource final : public InputSource {
+public:
+    using u64 = std::uint64_t;
+
+    // Throws std::runtime_error on corrupt or truncated input.
+    GzipInputSource(std::shared_ptr<InputSource> raw, const std::string& indexPath);
+
+    u64 size() const override { return _size; }
+    bool isMapped() const override { return false; }
+    bool prefersReadAhead() const override { return true; } // inflating is worth overlapping
+
+    std::string_view read(u64 offset, std::size_t len, std::vector<char>& scratch) const override;
+    std::size_t readInto(u64 offset, std::size_t len, char* dst) const override;
+
+    std::size_t pointCount() const { return _points.size(); }
+    // true when the access points came from indexPath instead of a decode
+    bool indexReused() const { return _reused; }
+
+private:
+    struct Point {
+        u64 out = 0;
+        u64 in = 0;
+        unsigned bits = 0;
+        std::vector<unsigned char> window;
+    };
+    using Span = std::shared_ptr<const std::vector<char>>;
+
+    void build();
+    bool load(const std::string& indexPath);
+    void save(const std::string& indexPath) const;
+    void fingerprint(u64& head, u64& tail) const;
+
+    std::size_t spanAt(u64 offset) const;
+    // decoded bytes [points[k].out, points[k + 1].out), cached
+    Span span(std::size_t k) const;
+    Span decode(std::size_t k) const;
+
+    struct Cached {
+        std::size_t index;
+        Span bytes;
+        u64 used;
+    };
+
+    std::shared_ptr<InputSource> _raw;
+    std::vector<Point> _points;
+    u64 _size = 0;
+    bool _reused = false;
+
+    mutable std::mutex _mu;
+    mutable std::vector<Cached> _cache;
+    mutable u64 _tick = 0;
+};
+
+} // namespace tabular
@@ -0,0 +1,48 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace tabular {
+
+// Distinct-count sketch over 64-bit hashes (Flajolet et al., "HyperLogLog",
+// 2007): 2^precision one-byte registers, standard error about
+// 1.04 / sqrt(2^precision), with linear counting for small cardinalities.
+// Feed it well-mixed hashes, e.g. Dictionary::hash().
+class HyperLogLog {
+public:
+    using u64 = std::uint64_t;
+
+    explicit HyperLogLog(unsigned precision = 12)
+        : _p(std::clamp(precision, 4u, 18u)), _regs(std::size_t(1) << _p, 0) {}
+
+    void add(u64 hash) {
+        const std::size_t idx = static_cast<std::size_t>(hash >> (64 - _p));
+        // rank of the first set bit after the index bits; the guard bit caps it
+        const u64 rest = (hash << _p) | (u64(1) << (_p - 1));
+        const std::uint8_t rank = static_cast<std::uint8_t>(__builtin_clzll(rest) + 1);
+        if (rank > _regs[idx]) _regs[idx] = rank;
+    }
+
+    double estimate() const {
+        const double m = static_cast<double>(_regs.size());
+        double sum = 0;
+        std::size_t zeros = 0;
+        for (const std::uint8_t r : _regs) {
+            sum += std::ldexp(1.0, -r);
+            zeros += r == 0;
+        }
+        const double alpha = _regs.size() == 16 ? 0.673 : _regs.size() == 32 ? 0.697
+                           : _regs.size() == 64 ? 0.709 : 0.7213 / (1.0 + 1.079 / m);
+        const double raw = alpha * m * m / sum;
+        if (raw <= 2.5 * m && zeros > 0) return m * std::log(m / static_cast<double>(zeros));
+        return raw; // 64-bit hashes: no large-range correction
+    }
+
+private:
+    unsigned _p;
+    std::vector<std::uint8_t> _regs;
+};
+
+} // namespace tabular
@@ -0,0 +1,85 @@
+#include "IndexState.hpp"
+#include "Dictionary.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace tabular {
+
+namespace {
+
+std::uint64_t hash_range(const InputSource& src, std::uint64_t offset, std::uint64_t len) {
+    std::vector<char> scratch;
+    return Dictionary::hash(src.read(offset, static_cast<std::size_t>(len), scratch));
+}
+
+} // end anon
+
+IndexState IndexState::capture(const InputSource& src, u64 rowCount, u32 colCount, u32 flags,
+                               const Dialect& dialect) {
+    IndexState s;
+    s.fileBytes = src.size();
+    const u64 n = std::min(s.fileBytes, kSampleBytes);
+    s.headHash = hash_range(src, 0, n);
+    s.tailHash = hash_range(src, s.fileBytes - n, n);
+    s.rowCount = rowCount;
+    s.colCount = colCount;
+    s.flags = flags;
+    s.dialect = dialect.pack();
+    return s;
+}
+
+bool IndexState::prefixOf(const InputSource& src) const {
+    if (src.size() < fileBytes) return false;
+    const u64 n = std::min(fileBytes, kSampleBytes);
+    return hash_range(src, 0, n) == headHash && hash_range(src, fileBytes - n, n) == tailHash;
+}
+
+std::string IndexState::path(const std::string& outputDir) {
+    return (fs::path(outputDir) / "index_state.bin").string();
+}
+
+bool IndexState::load(const std::string& outputDir, IndexState& out) {
+    std::ifstream in(path(outputDir), std::ios::binary);
+    if (!in) return false;
+    u32 head[2] = {};
+    in.read(reinterpret_cast<char*>(head), sizeof(head));
+    in.read(reinterpret_cast<char*>(&out.fileBytes), sizeof(out.fileBytes));
+    in.read(reinterpret_cast<char*>(&out.headHash), sizeof(out.headHash));
+    in.read(reinterpret_cast<char*>(&out.tailHash), sizeof(out.tailHash));
+    in.read(reinterpret_cast<char*>(&out.rowCount), sizeof(out.rowCount));
+    in.read(reinterpret_cast<char*>(&out.colCount), sizeof(out.colCount));
+    in.read(reinterpret_cast<char*>(&out.flags), sizeof(out.flags));
+    if (head[1] == 1) out.dialect = Dialect::csv().pack();
+    else in.read(reinterpret_cast<char*>(&out.dialect), sizeof(out.dialect));
+    return in && head[0] == kMagic && (head[1] == 1 || head[1] == kVersion);
+}
+
+void IndexState::save(const std::string& outputDir) const {
+    const std::string p = path(outputDir);
+    std::ofstream out(p, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Failed to open index state for writing: " + p);
+    const u32 head[2] = {kMagic, kVersion};
+    out.write(reinterpret_cast<const char*>(head), sizeof(head));
+    out.write(reinterpret_cast<const char*>(&fileBytes), sizeof(fileBytes));
+    out.write(reinterpret_cast<const char*>(&headHash), sizeof(headHash));
+    out.write(reinterpret_cast<const char*>(&tailHash), sizeof(tailHash));
+    out.write(reinterpret_cast<const char*>(&rowCount), sizeof(rowCount));
+    out.write(reinterpret_cast<const char*>(&colCount), sizeof(colCount));
+    out.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
+    out.write(reinterpret_cast<const char*>(&dialect), sizeof(dialect));
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write index state: " + p);
+}
+
+void IndexState::remove(const std::string& outputDir) {
+    std::error_code ec;
+    fs::remove(path(outputDir), ec);
+}
+
+} // namespace tabular
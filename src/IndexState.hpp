@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "TabularData/Dialect.hpp"
+#include "TabularData/InputSource.hpp"
+
+namespace tabular {
+
+// What a finished transpose indexed, so TabularData::refresh() can tell an
+// appended-to CSV from a rewritten one. <outputDir>/index_state.bin:
+//
+//   u32 magic      'TDIS'
+//   u32 version    2
+//   u64 fileBytes  CSV size the row offsets and columns cover
+//   u64 headHash   hash of the first min(fileBytes, kSampleBytes) bytes
+//   u64 tailHash   hash of the last min(fileBytes, kSampleBytes) bytes
+//   u64 rowCount
+//   u32 colCount
+//   u32 flags      kInferTypes | kSortedIds | kEndsAtRow
+//   u32 dialect    Dialect::pack() (version 2 on; version 1 files were CSV)
+//
+// All integers are little-endian.
+struct IndexState {
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+
+    static constexpr u32 kMagic   = 0x53494454; // "TDIS"
+    static constexpr u32 kVersion = 2;
+    static constexpr u64 kSampleBytes = 64 * 1024;
+
+    static constexpr u32 kInferTypes = 1u << 0;
+    static constexpr u32 kSortedIds  = 1u << 1;
+    static constexpr u32 kEndsAtRow  = 1u << 2; // last indexed byte ends a row: appends start new ones
+
+    u64 fileBytes = 0;
+    u64 headHash = 0;
+    u64 tailHash = 0;
+    u64 rowCount = 0;
+    u32 colCount = 0;
+    u32 flags = 0;
+    u32 dialect = Dialect::csv().pack();
+
+    // state of src as indexed now
+    static IndexState capture(const InputSource& src, u64 rowCount, u32 colCount, u32 flags, const Dialect& dialect);
+    // true when src still begins with the bytes this state indexed
+    bool prefixOf(const InputSource& src) const;
+
+    static std::string path(const std::string& outputDir);
+    // false if the file is missing or unreadable
+    static bool load(const std::string& outputDir, IndexState& out);
+    void save(const std::string& outputDir) const;
+    static void remove(const std::string& outputDir);
+};
+
+} // namespace tabular
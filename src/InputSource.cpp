@@ -0,0 +1,342 @@
+#include "TabularData/InputSource.hpp"
+#include "AsyncRead.hpp"
+#ifdef TABULAR_HAVE_ZLIB
+#include "GzipSource.hpp"
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TABULAR_HAVE_MMAP 1
+#define TABULAR_HAVE_PREAD 1
+#endif
+
+#ifndef CHUNK_SIZE
+#define CHUNK_SIZE (1u<<20) // 1 MiB
+#endif
+
+namespace tabular {
+
+namespace {
+
+using u64 = std::uint64_t;
+
+// ------------------------------ stream source ----------------------------
+// Unmapped reads. Regular files are pread() on POSIX, lock-free; elsewhere
+// seekable files go through an ifstream under a lock. Pipes and other
+// non-seekable inputs are drained into memory once, since every pass needs
+// to revisit earlier bytes.
+class StreamInputSource final : public InputSource {
+public:
+    explicit StreamInputSource(const std::string& path) : InputSource(path) {
+#ifdef TABULAR_HAVE_PREAD
+        _fd = ::open(path.c_str(), O_RDONLY);
+        if (_fd >= 0) {
+            struct stat st {};
+            if (::fstat(_fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+                _size = static_cast<u64>(st.st_size);
+                return;
+            }
+            ::close(_fd);
+            _fd = -1;
+        }
+#endif
+        _in.open(path, std::ios::binary);
+        if (!_in) throw std::runtime_error("Failed to open CSV file: " + path);
+        _in.seekg(0, std::ios::end);
+        const auto end = _in.tellg();
+        if (end >= 0 && _in) {
+            _size = static_cast<u64>(end);
+            _in.seekg(0, std::ios::beg);
+            return;
+        }
+        // not seekable: buffer the whole stream
+        _in.clear();
+        std::vector<char> buf(CHUNK_SIZE);
+        while (_in.read(buf.data(), static_cast<std::streamsize>(buf.size())) || _in.gcount() > 0) {
+            _spooled.insert(_spooled.end(), buf.data(), buf.data() + _in.gcount());
+        }
+        _size = _spooled.size();
+        _isSpooled = true;
+    }
+
+    ~StreamInputSource() override {
+#ifdef TABULAR_HAVE_PREAD
+        if (_fd >= 0) ::close(_fd);
+#endif
+    }
+
+    u64 size() const override { return _size; }
+    bool isMapped() const override { return false; }
+    bool prefersReadAhead() const override { return !_isSpooled; }
+    int nativeHandle() const override { return _fd; }
+
+    std::string_view read(u64 offset, std::size_t len, std::vector<char>& scratch) const override {
+        if (offset >= _size) return {};
+        len = static_cast<std::size_t>(std::min<u64>(len, _size - offset));
+        if (_isSpooled) return {_spooled.data() + offset, len};
+
+        if (scratch.size() < len) scratch.resize(len);
+        return {scratch.data(), readInto(offset, len, scratch.data())};
+    }
+
+    std::size_t readInto(u64 offset, std::size_t len, char* dst) const override {
+        if (offset >= _size) return 0;
+        len = static_cast<std::size_t>(std::min<u64>(len, _size - offset));
+        if (_isSpooled) {
+            std::memcpy(dst, _spooled.data() + offset, len);
+            return len;
+        }
+#ifdef TABULAR_HAVE_PREAD
+        if (_fd >= 0) {
+            std::size_t done = 0;
+            while (done < len) {
+                const ssize_t n = ::pread(_fd, dst + done, len - done, static_cast<off_t>(offset + done));
+                if (n == 0) break;
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error("Failed to read CSV file: " + path() + ": " + std::strerror(errno));
+                }
+                done += static_cast<std::size_t>(n);
+            }
+            return done;
+        }
+#endif
+        std::lock_guard<std::mutex> lock(_mu);
+        _in.clear();
+        _in.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+        _in.read(dst, static_cast<std::streamsize>(len));
+        return static_cast<std::size_t>(_in.gcount());
+    }
+
+private:
+    int _fd = -1;
+    mutable std::ifstream _in;
+    mutable std::mutex _mu;
+    std::vector<char> _spooled;
+    bool _isSpooled = false;
+    u64 _size = 0;
+};
+
+#ifdef TABULAR_HAVE_MMAP
+// ------------------------------- mmap source -----------------------------
+class MmapInputSource final : public InputSource {
+public:
+    MmapInputSource(const std::string& path, int fd, u64 size, void* base)
+        : InputSource(path), _fd(fd), _size(size), _base(static_cast<const char*>(base)) {}
+
+    ~MmapInputSource() override {
+        ::munmap(const_cast<char*>(_base), static_cast<std::size_t>(_size));
+        ::close(_fd);
+    }
+
+    u64 size() const override { return _size; }
+    bool isMapped() const override { return true; }
+
+    std::string_view read(u64 offset, std::size_t len, std::vector<char>&) const override {
+        if (offset >= _size) return {};
+        len = static_cast<std::size_t>(std::min<u64>(len, _size - offset));
+        return {_base + offset, len};
+    }
+
+    void adviseSequential(u64 offset, u64 len) const override { advise(offset, len, MADV_SEQUENTIAL); }
+    void adviseWillNeed(u64 offset, u64 len) const override { advise(offset, len, MADV_WILLNEED); }
+
+private:
+    void advise(u64 offset, u64 len, int advice) const {
+        if (offset >= _size || len == 0) return;
+        static const u64 page = static_cast<u64>(::sysconf(_SC_PAGESIZE));
+        const u64 begin = offset - offset % page;
+        const u64 end   = std::min(_size, offset + len);
+        ::madvise(const_cast<char*>(_base) + begin, static_cast<std::size_t>(end - begin), advice);
+    }
+
+    int _fd;
+    u64 _size;
+    const char* _base;
+};
+
+// nullptr when the file can't be mapped (caller falls back to streaming)
+std::shared_ptr<InputSource> try_map(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) { ::close(fd); return nullptr; }
+    const u64 size = static_cast<u64>(st.st_size);
+    void* base = ::mmap(nullptr, static_cast<std::size_t>(size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) { ::close(fd); return nullptr; }
+    return std::make_shared<MmapInputSource>(path, fd, size, base);
+}
+#endif
+
+} // end anon
+
+namespace {
+
+// the file's bytes as stored
+std::shared_ptr<InputSource> open_raw(const std::string& path, InputMode mode) {
+#ifdef TABULAR_HAVE_MMAP
+    if (mode != InputMode::Stream) {
+        if (auto mapped = try_map(path)) return mapped;
+        if (mode == InputMode::Mmap) throw std::runtime_error("Failed to mmap CSV file: " + path);
+    }
+#else
+    if (mode == InputMode::Mmap) throw std::runtime_error("mmap is not supported on this platform");
+#endif
+    return std::make_shared<StreamInputSource>(path);
+}
+
+bool starts_with_bytes(const InputSource& src, std::string_view magic) {
+    std::vector<char> scratch;
+    return src.read(0, magic.size(), scratch) == magic;
+}
+
+} // end anon
+
+std::shared_ptr<InputSource> openInputSource(const std::string& path, InputMode mode, const std::string& indexPath) {
+    std::shared_ptr<InputSource> raw = open_raw(path, mode);
+    if (starts_with_bytes(*raw, "\x1f\x8b")) {
+#ifdef TABULAR_HAVE_ZLIB
+        return std::make_shared<GzipInputSource>(std::move(raw), indexPath);
+#else
+        (void)indexPath;
+        throw std::runtime_error("gzip input needs a build with zlib: " + path);
+#endif
+    }
+    if (starts_with_bytes(*raw, "\x28\xb5\x2f\xfd")) {
+        throw std::runtime_error("zstd input is not supported, recompress it with gzip: " + path);
+    }
+    return raw;
+}
+
+namespace {
+
+// '*' any run, '?' any one byte
+bool wildcard_match(std::string_view pattern, std::string_view name) {
+    std::size_t p = 0, n = 0, star = std::string_view::npos, resume = 0;
+    while (n < name.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) { ++p; ++n; }
+        else if (p < pattern.size() && pattern[p] == '*') { star = p++; resume = n; }
+        else if (star != std::string_view::npos) { p = star + 1; n = ++resume; }
+        else return false;
+    }
+    while (p < pattern.size() && pattern[p] == '*') ++p;
+    return p == pattern.size();
+}
+
+} // end anon
+
+std::vector<std::string> globFiles(const std::string& pattern) {
+    namespace fs = std::filesystem;
+    const fs::path path(pattern);
+    const std::string name = path.filename().string();
+    std::vector<std::string> out;
+    if (name.find_first_of("*?") == std::string::npos) {
+        if (fs::is_regular_file(path)) out.push_back(pattern);
+        return out;
+    }
+    const fs::path dir = path.has_parent_path() ? path.parent_path() : fs::path(".");
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (!entry.is_regular_file(ec)) continue;
+        if (wildcard_match(name, entry.path().filename().string())) {
+            out.push_back(path.has_parent_path() ? entry.path().string() : entry.path().filename().string());
+        }
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+std::size_t InputSource::readInto(u64 offset, std::size_t len, char* dst) const {
+    std::vector<char> scratch;
+    const std::string_view v = read(offset, len, scratch);
+    std::memcpy(dst, v.data(), v.size());
+    return v.size();
+}
+
+// ------------------------------- SpanReader ------------------------------
+
+// READ_AHEAD_DEPTH buffers, filled in span order. The slot handed out last
+// is resubmitted on the following next(), once its span is released.
+struct SpanReader::ReadAhead {
+    struct Slot {
+        std::vector<char> buf;
+        std::size_t len = 0;
+        PendingRead read;               // declared last: waits before buf goes
+    };
+
+    Slot slots[READ_AHEAD_DEPTH];
+    std::size_t head = 0;               // slot of the next span
+    std::size_t held = READ_AHEAD_DEPTH; // slot of the span handed out last
+    u64 issue;                          // offset of the next span to submit
+
+    explicit ReadAhead(u64 start) : issue(start) {}
+
+    void submit(const InputSource& src, Slot& s, u64 stop) {
+        s.len = 0;
+        if (issue >= stop) return;
+        s.len = static_cast<std::size_t>(std::min<u64>(CHUNK_SIZE, stop - issue));
+        if (s.buf.size() < s.len) s.buf.resize(CHUNK_SIZE);
+        s.read.start(src, issue, s.len, s.buf.data());
+        issue += s.len;
+    }
+};
+
+SpanReader::SpanReader(const InputSource& src, u64 start, u64 stop)
+    : _src(src), _pos(start), _stop(std::min(stop, src.size())) {
+    if (_pos < _stop) _src.adviseSequential(_pos, _stop - _pos);
+}
+
+SpanReader::~SpanReader() = default;
+
+bool SpanReader::next(std::string_view& span, u64& spanOffset) {
+    if (_pos >= _stop) return false;
+
+    // the first span is read in place: resyncs and short scans stop there
+    if (!_started || !_src.prefersReadAhead() || !PendingRead::enabled()) {
+        _started = true;
+        const std::size_t len = static_cast<std::size_t>(std::min<u64>(CHUNK_SIZE, _stop - _pos));
+        span = _src.read(_pos, len, _buf);
+        if (span.empty()) { _pos = _stop; return false; }
+        spanOffset = _pos;
+        _pos += span.size();
+        if (_pos < _stop) _src.adviseWillNeed(_pos, std::min<u64>(CHUNK_SIZE, _stop - _pos));
+        return true;
+    }
+
+    if (!_ahead) {
+        _ahead = std::make_unique<ReadAhead>(_pos);
+        for (auto& s : _ahead->slots) _ahead->submit(_src, s, _stop);
+    } else if (_ahead->held < READ_AHEAD_DEPTH) {
+        _ahead->submit(_src, _ahead->slots[_ahead->held], _stop);
+    }
+
+    ReadAhead::Slot& s = _ahead->slots[_ahead->head];
+    const std::size_t want = s.len;
+    const std::size_t n = s.read.wait();
+    _ahead->held = _ahead->head;
+    _ahead->head = (_ahead->head + 1) % READ_AHEAD_DEPTH;
+    if (n == 0) { _pos = _stop; return false; }
+
+    span = std::string_view(s.buf.data(), n);
+    spanOffset = _pos;
+    _pos += n;
+    if (n < want) _stop = _pos; // the file ended early
+    return true;
+}
+int SpanReader::peek(u64 offset) {
+    const std::string_view b = _src.read(offset, 1, _peekBuf);
+    return b.empty() ? -1 : static_cast<unsigned char>(b[0]);
+}
+
+} // namespace tabular
@@ -0,0 +1,77 @@
+#include "TabularData/Metrics.hpp"
+
+#include <cmath>
+#include <sstream>
+
+namespace tabular {
+
+const char* phaseName(Phase phase) {
+    switch (phase) {
+        case Phase::Header:          return "header";
+        case Phase::Resync:          return "resync";
+        case Phase::SliceParse:      return "slice_parse";
+        case Phase::Merge:           return "merge";
+        case Phase::TransposeChunk:  return "transpose_chunk";
+        case Phase::DictionaryMerge: return "dictionary_merge";
+        case Phase::Write:           return "write";
+    }
+    return "unknown";
+}
+
+double Metrics::rowsPerSecond() const {
+    const double seconds = scanSeconds + transposeSeconds;
+    return seconds > 0 ? double(rows) / seconds : 0;
+}
+
+namespace {
+
+// JSON has no NaN / infinity
+double finite(double v) { return std::isfinite(v) ? v : 0; }
+
+} // end anon
+
+std::string Metrics::toJson() const {
+    std::ostringstream out;
+    out.precision(9);
+    out << "{\n  \"phases\": {";
+    for (std::size_t p = 0; p < kPhaseCount; ++p) {
+        const PhaseStats& s = phases[p];
+        out << (p ? "," : "") << "\n    \"" << phaseName(static_cast<Phase>(p)) << "\": {\"wall_seconds\": "
+            << finite(s.wallSeconds) << ", \"cpu_seconds\": " << finite(s.cpuSeconds) << ", \"calls\": " << s.calls
+            << "}";
+    }
+    out << "\n  },\n"
+        << "  \"bytes_read\": " << bytesRead << ",\n"
+        << "  \"rows\": " << rows << ",\n"
+        << "  \"faulty_rows\": " << faultyRows << ",\n"
+        << "  \"rows_per_second\": " << finite(rowsPerSecond()) << ",\n"
+        << "  \"scan_seconds\": " << finite(scanSeconds) << ",\n"
+        << "  \"transpose_seconds\": " << finite(transposeSeconds) << ",\n"
+        << "  \"scan_imbalance\": " << finite(scanImbalance) << ",\n"
+        << "  \"worker_seconds\": [";
+    for (std::size_t w = 0; w < workerSeconds.size(); ++w) out << (w ? ", " : "") << finite(workerSeconds[w]);
+    out << "],\n  \"slices\": [";
+    for (std::size_t i = 0; i < slices.size(); ++i) {
+        const Slice& s = slices[i];
+        out << (i ? "," : "") << "\n    {\"begin\": " << s.begin << ", \"end\": " << s.end << ", \"rows\": " << s.rows
+            << ", \"worker\": " << s.worker << ", \"seconds\": " << finite(s.seconds)
+            << ", \"reparsed\": " << (s.reparsed ? "true" : "false") << "}";
+    }
+    out << (slices.empty() ? "" : "\n  ") << "],\n  \"chunks\": [";
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        const Chunk& c = chunks[i];
+        out << (i ? "," : "") << "\n    {\"first_col\": " << c.firstCol << ", \"ncols\": " << c.ncols
+            << ", \"seconds\": " << finite(c.seconds) << ", \"imbalance\": " << finite(c.imbalance)
+            << ", \"bytes\": " << c.bytes << ", \"dictionary_entries\": " << c.dictionaryEntries
+            << ", \"dictionary_bytes\": " << c.dictionaryBytes << ", \"memory_bytes\": " << c.memoryBytes << "}";
+    }
+    out << (chunks.empty() ? "" : "\n  ") << "],\n"
+        << "  \"dictionary_entries\": " << dictionaryEntries << ",\n"
+        << "  \"dictionary_bytes\": " << dictionaryBytes << ",\n"
+        << "  \"largest_dictionary\": " << largestDictionary << ",\n"
+        << "  \"peak_chunk_bytes\": " << peakChunkBytes << ",\n"
+        << "  \"peak_rss_bytes\": " << peakRssBytes << "\n}\n";
+    return out.str();
+}
+
+} // namespace tabular
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace tabular {
+
+// Dictionary ids for a run of rows at 1, 2 or 4 bytes per cell. The all-ones
+// value of the current width marks a missing cell, so width w holds ids
+// 0 .. 2^(8w)-2. set() widens in place the first time an id doesn't fit.
+class PackedColumn {
+public:
+    using u32 = std::uint32_t;
+
+    // narrowest width able to hold ids 0..distinct-1 plus the missing marker
+    static u32 widthFor(std::uint64_t distinct) {
+        return distinct < 0xFFu ? 1 : distinct < 0xFFFFu ? 2 : 4;
+    }
+
+    void reset(std::size_t rows, u32 width = 1) {
+        _rows = rows;
+        _width = width;
+        _buf.assign(rows * width, 0);
+    }
+
+    // take rows cells already encoded at `width`, e.g. from a column chunk
+    void assign(const void* cells, std::size_t rows, u32 width) {
+        _rows = rows;
+        _width = width;
+        const auto* p = static_cast<const std::uint8_t*>(cells);
+        _buf.assign(p, p + rows * width);
+    }
+    // add rows cells already encoded at width()
+    void extend(const void* cells, std::size_t rows) {
+        const auto* p = static_cast<const std::uint8_t*>(cells);
+        _buf.insert(_buf.end(), p, p + rows * _width);
+        _rows += rows;
+    }
+
+    u32 width() const { return _width; }
+    std::size_t size() const { return _rows; }
+    std::size_t bytes() const { return _buf.size(); }
+    const void* data() const { return _buf.data(); }
+
+    void set(std::size_t row, u32 id) {
+        if (id >= missing(_width)) widen(widthFor(std::uint64_t(id) + 1));
+        store(row, id);
+    }
+    void setMissing(std::size_t row) { store(row, missing(_width)); }
+
+    // grow by one row, for runs whose length isn't known up front
+    void append(u32 id) {
+        _buf.resize(_buf.size() + _width);
+        set(_rows++, id);
+    }
+    void appendMissing() {
+        _buf.resize(_buf.size() + _width);
+        setMissing(_rows++);
+    }
+
+    // id at row, or -1 when missing
+    std::int64_t get(std::size_t row) const {
+        u32 v;
+        switch (_width) {
+            case 1:  v = _buf[row]; break;
+            case 2:  { std::uint16_t x; std::memcpy(&x, &_buf[row * 2], 2); v = x; break; }
+            default: std::memcpy(&v, &_buf[row * 4], 4); break;
+        }
+        return v == missing(_width) ? -1 : std::int64_t(v);
+    }
+
+    // re-encode every cell at a larger width, keeping missing markers
+    void widen(u32 width) {
+        if (width <= _width) return;
+        const u32 old = _width;
+        _buf.resize(_rows * width);
+        _width = width;
+        for (std::size_t r = _rows; r-- > 0;) { // back to front: never clobbers unread cells
+            u32 v;
+            switch (old) {
+                case 1:  v = _buf[r]; break;
+                default: { std::uint16_t x; std::memcpy(&x, &_buf[r * 2], 2); v = x; break; }
+            }
+            store(r, v == missing(old) ? missing(width) : v);
+        }
+    }
+
+    // replace every id by lut[id] and re-encode at `width` (which must hold
+    // every lut value), keeping missing markers; one pass, no per-cell switch
+    void remap(const std::vector<u32>& lut, u32 width) {
+        std::vector<std::uint8_t> out(_rows * width);
+        switch (_width) {
+            case 1:  remapFrom<std::uint8_t>(out.data(), width, lut.data()); break;
+            case 2:  remapFrom<std::uint16_t>(out.data(), width, lut.data()); break;
+            default: remapFrom<std::uint32_t>(out.data(), width, lut.data()); break;
+        }
+        _buf.swap(out);
+        _width = width;
+    }
+
+private:
+    template <class From>
+    void remapFrom(std::uint8_t* out, u32 width, const u32* lut) const {
+        switch (width) {
+            case 1:  remapCells<From, std::uint8_t>(out, lut); break;
+            case 2:  remapCells<From, std::uint16_t>(out, lut); break;
+            default: remapCells<From, std::uint32_t>(out, lut); break;
+        }
+    }
+
+    template <class From, class To>
+    void remapCells(std::uint8_t* out, const u32* lut) const {
+        const std::uint8_t* in = _buf.data();
+        for (std::size_t r = 0; r < _rows; ++r) {
+            From v;
+            std::memcpy(&v, in + r * sizeof(From), sizeof(From));
+            const To w = (v == From(~From(0))) ? To(~To(0)) : static_cast<To>(lut[v]);
+            std::memcpy(out + r * sizeof(To), &w, sizeof(To));
+        }
+    }
+
+    static u32 missing(u32 width) { return width == 4 ? 0xFFFFFFFFu : (1u << (8 * width)) - 1; }
+
+    void store(std::size_t row, u32 v) {
+        switch (_width) {
+            case 1:  _buf[row] = static_cast<std::uint8_t>(v); break;
+            case 2:  { const std::uint16_t x = static_cast<std::uint16_t>(v); std::memcpy(&_buf[row * 2], &x, 2); break; }
+            default: std::memcpy(&_buf[row * 4], &v, 4); break;
+        }
+    }
+
+    std::vector<std::uint8_t> _buf;
+    std::size_t _rows = 0;
+    u32 _width = 1;
+};
+
+} // namespace tabular
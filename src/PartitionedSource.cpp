@@ -0,0 +1,79 @@
+#include "PartitionedSource.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace tabular {
+
+PartitionedSource::PartitionedSource(std::vector<std::shared_ptr<InputSource>> parts, const std::vector<u64>& skips)
+    : InputSource(parts.empty() ? std::string() : parts.front()->path()) {
+    if (parts.empty() || parts.size() != skips.size()) throw std::invalid_argument("PartitionedSource: no parts");
+    std::vector<char> scratch;
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        Part p;
+        p.source = std::move(parts[i]);
+        p.skip = std::min(skips[i], p.source->size());
+        p.base = _size;
+        p.bytes = p.source->size() - p.skip;
+        if (p.bytes > 0 && i + 1 < parts.size()) {
+            const char last = p.source->read(p.source->size() - 1, 1, scratch)[0];
+            p.newline = last != '\n' && last != '\r';
+        }
+        _size += p.bytes + (p.newline ? 1 : 0);
+        _readAhead = _readAhead || p.source->prefersReadAhead();
+        _parts.push_back(std::move(p));
+    }
+}
+
+std::size_t PartitionedSource::partAt(u64 offset) const {
+    // last part starting at or before offset; empty parts share a base
+    const auto it = std::upper_bound(_parts.begin(), _parts.end(), offset,
+                                     [](u64 off, const Part& p) { return off < p.base; });
+    return static_cast<std::size_t>(it - _parts.begin()) - 1;
+}
+
+std::pair<std::size_t, PartitionedSource::u64> PartitionedSource::locate(u64 offset) const {
+    const std::size_t k = partAt(offset);
+    return {k, _parts[k].skip + (offset - _parts[k].base)};
+}
+
+std::string_view PartitionedSource::read(u64 offset, std::size_t len, std::vector<char>& scratch) const {
+    if (offset >= _size) return {};
+    len = static_cast<std::size_t>(std::min<u64>(len, _size - offset));
+    const Part& p = _parts[partAt(offset)];
+    const u64 into = offset - p.base;
+    if (into + len <= p.bytes) return p.source->read(p.skip + into, len, scratch);
+
+    // straddles a part boundary (or is the synthetic line break)
+    if (scratch.size() < len) scratch.resize(len);
+    return {scratch.data(), readInto(offset, len, scratch.data())};
+}
+
+std::size_t PartitionedSource::readInto(u64 offset, std::size_t len, char* dst) const {
+    if (offset >= _size) return 0;
+    len = static_cast<std::size_t>(std::min<u64>(len, _size - offset));
+    std::size_t done = 0;
+    for (std::size_t k = partAt(offset); done < len && k < _parts.size(); ++k) {
+        const Part& p = _parts[k];
+        const u64 at = offset + done;
+        if (at < p.base + p.bytes) {
+            const std::size_t n = static_cast<std::size_t>(std::min<u64>(len - done, p.base + p.bytes - at));
+            const std::size_t got = p.source->readInto(p.skip + (at - p.base), n, dst + done);
+            done += got;
+            if (got < n) break; // the file shrank under us
+        }
+        if (done < len && p.newline) dst[done++] = '\n';
+    }
+    return done;
+}
+
+void PartitionedSource::adviseSequential(u64 offset, u64 len) const {
+    eachPart(offset, len, [](const InputSource& src, u64 at, u64 n) { src.adviseSequential(at, n); });
+}
+
+void PartitionedSource::adviseWillNeed(u64 offset, u64 len) const {
+    eachPart(offset, len, [](const InputSource& src, u64 at, u64 n) { src.adviseWillNeed(at, n); });
+}
+
+} // namespace tabular
@@ -0,0 +1,70 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "TabularData/InputSource.hpp"
+
+namespace tabular {
+
+// Several files read back to back as one source: part i contributes its
+// bytes from skip[i] on (past its header row, for every part but the
+// first), and a '\n' after them when they don't end in a line break, so
+// every part starts a new row. Offsets are virtual; locate() maps one back
+// to its file. Reads that stay within one part are passed through, so a
+// mapped part still hands out views of its mapping.
+class PartitionedSource final : public InputSource {
+public:
+    using u64 = std::uint64_t;
+
+    PartitionedSource(std::vector<std::shared_ptr<InputSource>> parts, const std::vector<u64>& skips);
+
+    u64 size() const override { return _size; }
+    bool isMapped() const override { return false; }
+    bool prefersReadAhead() const override { return _readAhead; }
+
+    std::string_view read(u64 offset, std::size_t len, std::vector<char>& scratch) const override;
+    std::size_t readInto(u64 offset, std::size_t len, char* dst) const override;
+
+    void adviseSequential(u64 offset, u64 len) const override;
+    void adviseWillNeed(u64 offset, u64 len) const override;
+
+    std::size_t partCount() const { return _parts.size(); }
+    const InputSource& part(std::size_t i) const { return *_parts[i].source; }
+    // virtual offset of part i's first byte
+    u64 partBase(std::size_t i) const { return _parts[i].base; }
+    // {part, offset in its file} of a virtual offset below size()
+    std::pair<std::size_t, u64> locate(u64 offset) const;
+
+private:
+    struct Part {
+        std::shared_ptr<InputSource> source;
+        u64 skip = 0;       // file bytes before the part's first
+        u64 base = 0;       // virtual offset of that byte
+        u64 bytes = 0;      // file bytes contributed
+        bool newline = false; // a '\n' follows them
+    };
+
+    std::size_t partAt(u64 offset) const;
+
+    // fn(source, fileOffset, len) for the file bytes of [offset, offset + len)
+    template <class Fn>
+    void eachPart(u64 offset, u64 len, Fn&& fn) const {
+        if (offset >= _size) return;
+        for (std::size_t k = partAt(offset); k < _parts.size() && _parts[k].base < offset + len; ++k) {
+            const Part& p = _parts[k];
+            const u64 from = std::max(offset, p.base);
+            const u64 to = std::min(offset + len, p.base + p.bytes);
+            if (from < to) fn(*p.source, p.skip + (from - p.base), to - from);
+        }
+    }
+
+    std::vector<Part> _parts;
+    u64 _size = 0;
+    bool _readAhead = false;
+};
+
+} // namespace tabular
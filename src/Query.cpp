@@ -0,0 +1,309 @@
+#include "TabularData/Query.hpp"
+#include "TypedColumn.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace tabular {
+
+namespace {
+
+using u64 = std::uint64_t;
+
+// ---- kernels: one selection word per 64 rows ----
+// Cells t with (t - lo) <= span, compared as unsigned T, so a range costs
+// one compare and the missing marker (all-ones, or the signed minimum) falls
+// outside any range that doesn't name it. The inner loop is branch-free and
+// left to the compiler to vectorize.
+
+template <class T>
+u64 range_word(const T* cells, unsigned n, T lo, T span) {
+    u64 bits = 0;
+    for (unsigned j = 0; j < n; ++j) bits |= u64(T(cells[j] - lo) <= span) << j;
+    return bits;
+}
+
+// ids whose hit[id] is set; missing (all-ones) is past the table
+template <class T>
+u64 lookup_word(const T* cells, unsigned n, const std::vector<std::uint8_t>& hit) {
+    const u64 size = hit.size();
+    u64 bits = 0;
+    for (unsigned j = 0; j < n; ++j) {
+        const u64 id = cells[j];
+        bits |= u64(id < size && hit[id]) << j;
+    }
+    return bits;
+}
+
+// NaN (missing) compares false
+u64 float_word(const double* cells, unsigned n, double lo, double hi) {
+    u64 bits = 0;
+    for (unsigned j = 0; j < n; ++j) bits |= u64(cells[j] >= lo && cells[j] <= hi) << j;
+    return bits;
+}
+
+// ANDs (or ORs) word(i, n), the bits of cells i .. i + n - 1, into the
+// selection for each run of the column. A run refresh() appended can start
+// mid-word; its edge words are merged under a mask.
+template <class T, class WordFn>
+void for_runs(const ColumnStore::Column& col, u64* sel, bool combineOr, WordFn&& word) {
+    for (ColumnStore::u32 k = 0; k < col.runCount(); ++k) {
+        const ColumnStore::Column::Run run = col.run(k);
+        const T* cells = static_cast<const T*>(run.cells);
+        for (u64 i = 0; i < run.rows;) {
+            const u64 row = run.firstRow + i;
+            const unsigned shift = static_cast<unsigned>(row % 64);
+            const unsigned n = static_cast<unsigned>(std::min<u64>(64 - shift, run.rows - i));
+            u64& w = sel[row / 64];
+            if (combineOr) {
+                w |= word(cells + i, n) << shift;
+            } else if (w) { // else an earlier predicate already ruled these out
+                const u64 mask = (n == 64 ? ~u64(0) : (u64(1) << n) - 1) << shift;
+                w &= (word(cells + i, n) << shift) | ~mask;
+            }
+            i += n;
+        }
+    }
+}
+
+template <class T>
+void range_runs(const ColumnStore::Column& col, T lo, T span, u64* sel, bool combineOr) {
+    for_runs<T>(col, sel, combineOr, [&](const T* cells, unsigned n) { return range_word(cells, n, lo, span); });
+}
+
+template <class T>
+void and_lookup(const ColumnStore::Column& col, const std::vector<std::uint8_t>& hit, u64* sel) {
+    for_runs<T>(col, sel, false, [&](const T* cells, unsigned n) { return lookup_word(cells, n, hit); });
+}
+
+void float_range(const ColumnStore::Column& col, double lo, double hi, u64* sel, bool combineOr) {
+    for_runs<double>(col, sel, combineOr,
+                     [&](const double* cells, unsigned n) { return float_word(cells, n, lo, hi); });
+}
+
+// ---- predicate values ----
+
+// Bound of an integer-valued column (Int64, Date, Bool) from text; a
+// fractional bound of an Int64 column rounds inward. False if the text
+// isn't a value of the column's type.
+bool int_bound(ColumnType type, std::string_view text, bool upper, std::int64_t& out) {
+    if (text.empty()) return false;
+    ColumnType kind;
+    u64 v;
+    if (!TypedColumn::parse(text, type, kind, v)) return false;
+    if (kind == type) {
+        out = static_cast<std::int64_t>(v);
+        return true;
+    }
+    if (type != ColumnType::Int64 || kind != ColumnType::Float64) return false;
+    double d;
+    std::memcpy(&d, &v, sizeof(d));
+    d = upper ? std::floor(d) : std::ceil(d);
+    if (d >= 9.2e18) out = INT64_MAX;
+    else if (d <= -9.2e18) out = INT64_MIN + 1;
+    else out = static_cast<std::int64_t>(d);
+    return true;
+}
+
+bool float_value(std::string_view text, double& out) {
+    if (text.empty()) return false;
+    ColumnType kind;
+    u64 v;
+    if (!TypedColumn::parse(text, ColumnType::Float64, kind, v)) return false;
+    if (kind == ColumnType::Int64) {
+        out = static_cast<double>(static_cast<std::int64_t>(v));
+        return true;
+    }
+    if (kind != ColumnType::Float64) return false;
+    std::memcpy(&out, &v, sizeof(out));
+    return true;
+}
+
+// [lo, hi] over the cells of an integer-valued column, at its stored width
+void int_range(const ColumnStore::Column& col, std::int64_t lo, std::int64_t hi, u64* sel, bool combineOr) {
+    if (lo > hi) {
+        if (!combineOr) std::fill(sel, sel + (col.rowCount() + 63) / 64, 0);
+        return;
+    }
+    switch (col.width()) {
+        case 1: {
+            if (lo > 0xFE || hi < 0) return int_range(col, 1, 0, sel, combineOr);
+            const auto l = static_cast<std::uint8_t>(std::max<std::int64_t>(lo, 0));
+            const auto s = static_cast<std::uint8_t>(std::min<std::int64_t>(hi, 0xFE) - l);
+            return range_runs(col, l, s, sel, combineOr);
+        }
+        case 2: {
+            if (lo > 0xFFFE || hi < 0) return int_range(col, 1, 0, sel, combineOr);
+            const auto l = static_cast<std::uint16_t>(std::max<std::int64_t>(lo, 0));
+            const auto s = static_cast<std::uint16_t>(std::min<std::int64_t>(hi, 0xFFFE) - l);
+            return range_runs(col, l, s, sel, combineOr);
+        }
+        case 4: {
+            // ids are unsigned, dates signed: both compare as offsets from lo
+            const bool ids = col.type() == ColumnType::String;
+            const std::int64_t min = ids ? 0 : INT32_MIN + 1;
+            const std::int64_t max = ids ? 0xFFFFFFFEll : INT32_MAX;
+            if (lo > max || hi < min) return int_range(col, 1, 0, sel, combineOr);
+            const std::int64_t l = std::max(lo, min), h = std::min(hi, max);
+            const auto ul = static_cast<std::uint32_t>(l);
+            const auto s = static_cast<std::uint32_t>(static_cast<std::uint32_t>(h) - ul);
+            return range_runs(col, ul, s, sel, combineOr);
+        }
+        default: {
+            const u64 ul = static_cast<u64>(std::max<std::int64_t>(lo, INT64_MIN + 1));
+            const u64 s = static_cast<u64>(hi) - ul;
+            return range_runs(col, ul, s, sel, combineOr);
+        }
+    }
+}
+
+} // end anon
+
+// ------------------------------- building --------------------------------
+
+Query& Query::select(std::vector<u32> columns) {
+    for (u32 c : columns) {
+        if (c >= _store.columnCount()) throw std::out_of_range("Column index out of range");
+    }
+    _columns = std::move(columns);
+    _selected = true;
+    return *this;
+}
+
+Query& Query::whereEquals(u32 col, std::string_view value) {
+    if (col >= _store.columnCount()) throw std::out_of_range("Column index out of range");
+    _where.push_back({col, Op::Equals, {std::string(value)}});
+    return *this;
+}
+
+Query& Query::whereIn(u32 col, std::vector<std::string> values) {
+    if (col >= _store.columnCount()) throw std::out_of_range("Column index out of range");
+    _where.push_back({col, Op::In, std::move(values)});
+    return *this;
+}
+
+Query& Query::whereRange(u32 col, std::string_view lo, std::string_view hi) {
+    if (col >= _store.columnCount()) throw std::out_of_range("Column index out of range");
+    _where.push_back({col, Op::Range, {std::string(lo), std::string(hi)}});
+    return *this;
+}
+
+// ------------------------------ evaluation -------------------------------
+
+void Query::apply(const Predicate& p, std::vector<u64>& sel) const {
+    const ColumnStore::Column col = _store.column(p.col);
+    auto none = [&] { std::fill(sel.begin(), sel.end(), 0); };
+
+    if (col.type() == ColumnType::String) {
+        // resolve to the matching dictionary ids: one probe per value, a
+        // binary search per bound of a sorted range
+        if (p.op == Op::Range && col.sortedDictionary()) {
+            const auto [first, last] = col.findRange(p.values[0], p.values[1]);
+            if (first == last) return none();
+            return int_range(col, static_cast<std::int64_t>(first), static_cast<std::int64_t>(last - 1),
+                             sel.data(), false);
+        }
+        std::vector<u64> ids;
+        if (p.op == Op::Range) {
+            // insertion-ordered: any id may fall in the range
+            for (u64 id = 0; id < col.dictionarySize(); ++id) {
+                const std::string_view v = col.value(id);
+                if (p.values[0] <= v && v <= p.values[1]) ids.push_back(id);
+            }
+        } else {
+            for (const auto& v : p.values) {
+                const std::int64_t id = col.find(v);
+                if (id >= 0) ids.push_back(static_cast<u64>(id));
+            }
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        }
+        if (ids.empty()) return none();
+        if (ids.back() - ids.front() + 1 == ids.size()) {
+            // one id range (always so for equality)
+            return int_range(col, static_cast<std::int64_t>(ids.front()), static_cast<std::int64_t>(ids.back()),
+                             sel.data(), false);
+        }
+        std::vector<std::uint8_t> hit(static_cast<std::size_t>(col.dictionarySize()), 0);
+        for (u64 id : ids) hit[id] = 1;
+        switch (col.width()) {
+            case 1:  return and_lookup<std::uint8_t>(col, hit, sel.data());
+            case 2:  return and_lookup<std::uint16_t>(col, hit, sel.data());
+            default: return and_lookup<std::uint32_t>(col, hit, sel.data());
+        }
+    }
+
+    if (col.type() == ColumnType::Float64) {
+        if (p.op == Op::Range) {
+            double lo, hi;
+            if (!float_value(p.values[0], lo) || !float_value(p.values[1], hi)) return none();
+            return float_range(col, lo, hi, sel.data(), false);
+        }
+        std::vector<u64> any(sel.size(), 0);
+        for (const auto& v : p.values) {
+            double d;
+            if (float_value(v, d)) float_range(col, d, d, any.data(), true);
+        }
+        for (std::size_t w = 0; w < sel.size(); ++w) sel[w] &= any[w];
+        return;
+    }
+
+    // Int64, Date, Bool
+    const ColumnType type = col.type();
+    if (p.op == Op::Range) {
+        std::int64_t lo, hi;
+        if (!int_bound(type, p.values[0], false, lo) || !int_bound(type, p.values[1], true, hi)) return none();
+        return int_range(col, lo, hi, sel.data(), false);
+    }
+    std::vector<u64> any(sel.size(), 0);
+    for (const auto& v : p.values) {
+        std::int64_t lo, hi;
+        if (int_bound(type, v, false, lo) && int_bound(type, v, true, hi)) int_range(col, lo, hi, any.data(), true);
+    }
+    for (std::size_t w = 0; w < sel.size(); ++w) sel[w] &= any[w];
+}
+
+std::vector<Query::u64> Query::evaluate() const {
+    const u64 rows = _store.rowCount();
+    std::vector<u64> sel(static_cast<std::size_t>((rows + 63) / 64), ~u64(0));
+    if (rows % 64) sel.back() = (u64(1) << (rows % 64)) - 1;
+    for (const Predicate& p : _where) apply(p, sel);
+    return sel;
+}
+
+std::vector<Query::u64> Query::rowIds() const {
+    const std::vector<u64> sel = evaluate();
+    std::vector<u64> out;
+    for (std::size_t w = 0; w < sel.size(); ++w) {
+        for (u64 bits = sel[w]; bits; bits &= bits - 1) {
+            out.push_back(w * 64 + static_cast<u64>(__builtin_ctzll(bits)));
+        }
+    }
+    return out;
+}
+
+Query::u64 Query::count() const {
+    u64 n = 0;
+    for (u64 word : evaluate()) n += static_cast<u64>(__builtin_popcountll(word));
+    return n;
+}
+
+std::vector<std::vector<std::string>> Query::values() const {
+    std::vector<u32> columns = _columns;
+    if (!_selected) {
+        columns.resize(_store.columnCount());
+        for (u32 c = 0; c < columns.size(); ++c) columns[c] = c;
+    }
+    const std::vector<u64> rows = rowIds();
+    std::vector<std::vector<std::string>> out(columns.size());
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+        const ColumnStore::Column col = _store.column(columns[i]);
+        out[i].reserve(rows.size());
+        for (u64 r : rows) out[i].push_back(col.text(r));
+    }
+    return out;
+}
+
+} // namespace tabular
@@ -0,0 +1,186 @@
+#include "TabularData/RowOffsetIndex.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace tabular {
+
+namespace {
+
+using u32 = std::uint32_t;
+using u64 = std::uint64_t;
+
+constexpr std::size_t kHeaderBytes = 32;
+constexpr std::size_t kPadBytes    = 16;
+
+unsigned bits_for(u64 v) {
+    return v == 0 ? 0u : 64u - static_cast<unsigned>(__builtin_clzll(v));
+}
+
+void put_varint(std::vector<unsigned char>& out, u64 v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<unsigned char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(v));
+}
+
+u64 get_varint(const unsigned char*& p) {
+    u64 v = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        const unsigned char b = *p++;
+        v |= static_cast<u64>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+}
+
+// `bits` bits at bit position `pos`; relies on the zero padding after the data
+u64 get_bits(const unsigned char* p, u64 pos, unsigned bits) {
+    const unsigned char* q = p + (pos >> 3);
+    const unsigned shift = static_cast<unsigned>(pos & 7);
+    u64 w;
+    std::memcpy(&w, q, sizeof(w));
+    u64 v = w >> shift;
+    if (shift + bits > 64) v |= static_cast<u64>(q[8]) << (64 - shift);
+    return bits == 64 ? v : v & ((1ull << bits) - 1);
+}
+
+} // end anon
+
+// ------------------------------- writer ----------------------------------
+
+void RowOffsetIndex::write(const std::string& path, const u64* offsets, u64 count) {
+    const u64 nblocks = (count + kRowOffsetBlockRows - 1) / kRowOffsetBlockRows;
+    std::vector<DirEntry> dir(static_cast<std::size_t>(nblocks));
+    std::vector<unsigned char> data;
+    data.reserve(static_cast<std::size_t>(count) + kPadBytes);
+
+    for (u64 b = 0; b < nblocks; ++b) {
+        const u64 first = b * kRowOffsetBlockRows;
+        const u64 last  = std::min<u64>(first + kRowOffsetBlockRows, count);
+        u64 minDelta = ~0ull, maxDelta = 0;
+        for (u64 i = first + 1; i < last; ++i) {
+            const u64 d = offsets[i] - offsets[i - 1];
+            minDelta = std::min(minDelta, d);
+            maxDelta = std::max(maxDelta, d);
+        }
+        if (last - first < 2) minDelta = maxDelta = 0;
+        const unsigned bits = bits_for(maxDelta - minDelta);
+
+        dir[b] = {offsets[first], static_cast<u64>(data.size())};
+        put_varint(data, minDelta);
+        data.push_back(static_cast<unsigned char>(bits));
+
+        u64 acc = 0;
+        unsigned used = 0;
+        for (u64 i = first + 1; i < last && bits; ++i) {
+            const u64 v = offsets[i] - offsets[i - 1] - minDelta;
+            acc |= v << used;
+            const unsigned room = 64 - used;
+            if (bits >= room) {
+                for (int k = 0; k < 8; ++k) data.push_back(static_cast<unsigned char>(acc >> (8 * k)));
+                acc = room == 64 ? 0 : v >> room;
+                used = bits - room;
+            } else {
+                used += bits;
+            }
+        }
+        for (unsigned k = 0; k * 8 < used; ++k) data.push_back(static_cast<unsigned char>(acc >> (8 * k)));
+    }
+    data.insert(data.end(), kPadBytes, 0);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Failed to open row offsets file for writing: " + path);
+    const u32 head[2] = {kRowOffsetMagic, kRowOffsetIndexVersion};
+    const u32 geom[2] = {kRowOffsetBlockRows, 0};
+    const u64 dataBytes = data.size();
+    out.write(reinterpret_cast<const char*>(head), sizeof(head));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(geom), sizeof(geom));
+    out.write(reinterpret_cast<const char*>(&dataBytes), sizeof(dataBytes));
+    out.write(reinterpret_cast<const char*>(dir.data()), static_cast<std::streamsize>(dir.size() * sizeof(DirEntry)));
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write row offsets: " + path);
+}
+
+// ------------------------------- reader ----------------------------------
+
+RowOffsetIndex::RowOffsetIndex(const std::string& path) {
+    _file = openInputSource(path);
+    const u64 size = _file->size();
+    const char* base = _file->read(0, static_cast<std::size_t>(size), _copy).data();
+
+    u32 magic = 0;
+    if (size >= sizeof(magic)) std::memcpy(&magic, base, sizeof(magic));
+    if (magic != kRowOffsetMagic) {
+        if (size % sizeof(u64) != 0) throw std::runtime_error("Corrupted row offsets file: " + path);
+        _legacy = reinterpret_cast<const u64*>(base);
+        _rowCount = size / sizeof(u64);
+        return;
+    }
+
+    if (size < kHeaderBytes) throw std::runtime_error("Truncated row offsets file: " + path);
+    u32 version = 0;
+    u64 dataBytes = 0;
+    std::memcpy(&version, base + 4, sizeof(version));
+    std::memcpy(&_rowCount, base + 8, sizeof(_rowCount));
+    std::memcpy(&_blockRows, base + 16, sizeof(_blockRows));
+    std::memcpy(&dataBytes, base + 24, sizeof(dataBytes));
+    if (version != kRowOffsetIndexVersion) throw std::runtime_error("Unsupported row offsets version: " + path);
+    if (_blockRows == 0) throw std::runtime_error("Corrupted row offsets file: " + path);
+
+    const u64 nblocks = (_rowCount + _blockRows - 1) / _blockRows;
+    if (kHeaderBytes + nblocks * sizeof(DirEntry) + dataBytes != size || dataBytes < kPadBytes)
+        throw std::runtime_error("Corrupted row offsets file: " + path);
+    _dir  = reinterpret_cast<const DirEntry*>(base + kHeaderBytes);
+    _data = reinterpret_cast<const unsigned char*>(base + kHeaderBytes + nblocks * sizeof(DirEntry));
+}
+
+void RowOffsetIndex::decodeBlock(u64 block, u32 n, u64* out) const {
+    const DirEntry& e = _dir[block];
+    const unsigned char* p = _data + e.dataPos;
+    const u64 minDelta = get_varint(p);
+    const unsigned bits = *p++;
+
+    u64 cur = e.firstOffset;
+    out[0] = cur;
+    u64 pos = 0;
+    for (u32 i = 1; i < n; ++i, pos += bits) {
+        cur += minDelta + (bits ? get_bits(p, pos, bits) : 0);
+        out[i] = cur;
+    }
+}
+
+RowOffsetIndex::u64 RowOffsetIndex::offset(u64 row) const {
+    if (row >= _rowCount) throw std::out_of_range("Row index out of range");
+    if (_legacy) return _legacy[row];
+
+    const DirEntry& e = _dir[row / _blockRows];
+    const u32 k = static_cast<u32>(row % _blockRows);
+    const unsigned char* p = _data + e.dataPos;
+    const u64 minDelta = get_varint(p);
+    const unsigned bits = *p++;
+
+    u64 sum = 0;
+    for (u64 i = 0, pos = 0; i < k && bits; ++i, pos += bits) sum += get_bits(p, pos, bits);
+    return e.firstOffset + k * minDelta + sum;
+}
+
+std::vector<RowOffsetIndex::u64> RowOffsetIndex::decode() const {
+    std::vector<u64> out(static_cast<std::size_t>(_rowCount));
+    if (_legacy) {
+        std::copy(_legacy, _legacy + _rowCount, out.begin());
+        return out;
+    }
+    const u64 nblocks = (_rowCount + _blockRows - 1) / _blockRows;
+    for (u64 b = 0; b < nblocks; ++b) {
+        const u64 first = b * _blockRows;
+        decodeBlock(b, static_cast<u32>(std::min<u64>(_blockRows, _rowCount - first)), out.data() + first);
+    }
+    return out;
+}
+
+} // namespace tabular
@@ -0,0 +1,167 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "TabularData/InputSource.hpp"
+#include "AsyncRead.hpp"
+#include "DialectKernel.hpp"
+
+#ifndef CHUNK_SIZE
+#define CHUNK_SIZE (1u<<20) // 1 MiB
+#endif
+
+namespace tabular {
+
+// Tokenizes rows in ascending offset order over one byte range of the input.
+// Mapped sources are read in place; stream sources keep a sliding window so a
+// run of consecutive rows costs one read per CHUNK_SIZE, not one per row, and
+// the window after the current one is read ahead while this one is parsed.
+class RowTokenizer {
+public:
+    using u64 = std::uint64_t;
+
+    RowTokenizer(const InputSource& src, u64 rangeStart, u64 rangeStop, const Dialect& dialect)
+        : _src(src), _rangeStop(rangeStop), _dialect(dialect), _kind(kindOf(dialect)) {
+        if (rangeStart < rangeStop) _src.adviseSequential(rangeStart, rangeStop - rangeStart);
+    }
+
+    // Emit up to maxFields trimmed fields starting at `start` (inside a row),
+    // stopping at the row terminator or `bound`. Returns the offset to resume
+    // from: just past the delimiter after the last emitted field, or the
+    // start of the next row once the terminator was consumed. Fields are raw:
+    // quotes and escapes are left in.
+    template <class Emit>
+    u64 fields(u64 start, u64 bound, int maxFields, Emit&& emit) {
+        if (maxFields <= 0 || start >= bound) return start;
+        return withDialect(_kind, _dialect,
+                           [&](const auto& d) { return fieldsAs(d, start, bound, maxFields, emit); });
+    }
+
+    // bytes of the row starting at `start`, up to (not including) its
+    // terminator; valid until the next call
+    std::string_view row(u64 start, u64 bound) {
+        const u64 next = fields(start, bound, INT_MAX, [](std::string_view) {});
+        std::string_view v = window(start, next - start);
+        while (!v.empty() && (v.back() == '\n' || v.back() == '\r')) v.remove_suffix(1);
+        return v;
+    }
+
+private:
+    template <class D, class Emit>
+    u64 fieldsAs(const D& d, u64 start, u64 bound, int maxFields, Emit& emit) {
+        const std::string_view v = window(start, bound - start);
+
+        bool inQuotes = false;
+        bool pendingQuote = false;
+        std::size_t tokenStart = 0;
+        int emitted = 0;
+
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            const char c = v[i];
+
+            if (inQuotes) {
+                if (pendingQuote) {
+                    pendingQuote = false;
+                    if (d.isQuote(c)) continue; // "" => literal quote
+                    inQuotes = false;           // fall through: c is unquoted
+                } else {
+                    if (d.isEscape(c)) ++i;     // the next byte is literal
+                    else if (d.isQuote(c)) pendingQuote = true;
+                    continue;
+                }
+            }
+
+            if (d.isEscape(c)) { ++i; continue; }
+
+            if (d.isQuote(c)) { inQuotes = true; continue; }
+
+            if (d.isDelimiter(c)) {
+                emit(trim(v.substr(tokenStart, i - tokenStart)));
+                tokenStart = i + 1;
+                if (++emitted == maxFields) return start + tokenStart;
+                continue;
+            }
+
+            if (c == '\n' || c == '\r') {
+                emit(trim(v.substr(tokenStart, i - tokenStart)));
+                u64 adv = i + 1;
+                if (c == '\r' && i + 1 < v.size() && v[i + 1] == '\n') ++adv;
+                return start + adv;
+            }
+        }
+
+        // last row of the file without a terminator
+        emit(trim(v.substr(tokenStart)));
+        return start + v.size();
+    }
+
+    static std::string_view trim(std::string_view s) {
+        std::size_t a = 0, b = s.size();
+        while (a < b && std::isspace(static_cast<unsigned char>(s[a]))) ++a;
+        while (b > a && std::isspace(static_cast<unsigned char>(s[b - 1]))) --b;
+        return s.substr(a, b - a);
+    }
+
+    std::string_view window(u64 offset, u64 len) {
+        if (_src.isMapped()) return _src.read(offset, static_cast<std::size_t>(len), _buf);
+        if (offset < _winStart || offset + len > _winStart + _win.size()) {
+            if (!takeAhead(offset, len)) {
+                _winStart = offset;
+                // read ahead within the range only: a scattered-row tokenizer
+                // (empty range) reads just the row
+                const u64 ahead = _rangeStop > offset ? std::min<u64>(CHUNK_SIZE, _rangeStop - offset) : 0;
+                _win = _src.read(offset, static_cast<std::size_t>(std::max<u64>(len, ahead)), _buf);
+            }
+            startAhead();
+        }
+        return _win.substr(static_cast<std::size_t>(offset - _winStart),
+                           static_cast<std::size_t>(std::min<u64>(len, _winStart + _win.size() - offset)));
+    }
+
+    // next window: the prefetched bytes, behind the current window's tail
+    // when a row straddles the two
+    bool takeAhead(u64 offset, u64 len) {
+        if (!_ahead.active()) return false;
+        const u64 at = _ahead.offset();
+        const std::size_t n = _ahead.wait();
+        if (offset < _winStart || offset > at + n) return false;
+        const std::size_t tail = offset < at ? static_cast<std::size_t>(at - offset) : 0;
+        if (tail > kCarry) return false;
+        if (offset + len > at + n && at + n < _src.size()) return false; // row longer than the window
+
+        std::memcpy(_aheadBuf.data() + kCarry - tail, _win.data() + (offset - _winStart), tail);
+        _buf.swap(_aheadBuf);
+        _winStart = at - tail;
+        _win = std::string_view(_buf.data() + kCarry - tail, tail + n);
+        return true;
+    }
+
+    void startAhead() {
+        const u64 end = _winStart + _win.size();
+        if (end >= _rangeStop || !_src.prefersReadAhead() || !PendingRead::enabled()) return;
+        const std::size_t len = static_cast<std::size_t>(std::min<u64>(CHUNK_SIZE, _rangeStop - end));
+        // _aheadBuf no longer backs _win: it was swapped out or never used
+        if (_aheadBuf.size() < kCarry + CHUNK_SIZE) _aheadBuf.resize(kCarry + CHUNK_SIZE);
+        _ahead.start(_src, end, len, _aheadBuf.data() + kCarry);
+    }
+
+    // bytes of a straddling row carried into the next window without a re-read
+    static constexpr std::size_t kCarry = 64 << 10;
+
+    const InputSource& _src;
+    u64 _rangeStop;
+    Dialect _dialect;
+    DialectKind _kind;
+    std::vector<char> _buf;
+    std::string_view _win;
+    u64 _winStart = 0;
+    std::vector<char> _aheadBuf;        // kCarry bytes of headroom, then the read
+    PendingRead _ahead;
+};
+
+} // namespace tabular
@@ -0,0 +1,57 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define TABULAR_HAVE_POSIX_CLOCKS 1
+#endif
+
+namespace tabular {
+
+// Wall and CPU time since construction, for Metrics. CPU time is the whole
+// process's or the calling thread's.
+class Stopwatch {
+public:
+    enum class Cpu { Process, Thread };
+
+    explicit Stopwatch(Cpu cpu = Cpu::Process) : _cpu(cpu), _wall(Clock::now()), _cpuStart(cpuNow(cpu)) {}
+
+    double wallSeconds() const { return std::chrono::duration<double>(Clock::now() - _wall).count(); }
+    double cpuSeconds() const { return cpuNow(_cpu) - _cpuStart; }
+
+    static double cpuNow(Cpu cpu) {
+#ifdef TABULAR_HAVE_POSIX_CLOCKS
+        timespec ts{};
+        clock_gettime(cpu == Cpu::Thread ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return double(ts.tv_sec) + double(ts.tv_nsec) * 1e-9;
+#else
+        (void)cpu;
+        return double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+    }
+
+    // process resident-set high-water mark in bytes, 0 where unknown
+    static std::uint64_t peakRssBytes() {
+#ifdef TABULAR_HAVE_POSIX_CLOCKS
+        rusage ru{};
+        if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef __APPLE__
+        return std::uint64_t(ru.ru_maxrss);        // bytes
+#else
+        return std::uint64_t(ru.ru_maxrss) * 1024; // KiB
+#endif
+#else
+        return 0;
+#endif
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    Cpu _cpu;
+    Clock::time_point _wall;
+    double _cpuStart;
+};
+
+} // namespace tabular
@@ -1,4 +1,18 @@
 #include "TabularData/TabularData.hpp"
+#include "TabularData/RowOffsetIndex.hpp"
+#include "TabularData/ThreadPool.hpp"
+#include "ChunkPlanner.hpp"
+#include "ColumnStoreWriter.hpp"
+#include "CsvScanner.hpp"
+#include "DialectKernel.hpp"
+#include "Dictionary.hpp"
+#include "HyperLogLog.hpp"
+#include "IndexState.hpp"
+#include "PackedColumn.hpp"
+#include "PartitionedSource.hpp"
+#include "RowTokenizer.hpp"
+#include "Stopwatch.hpp"
+#include "TypedColumn.hpp"
 
 #include <filesystem>
 #include <fstream>
@@ -7,17 +21,24 @@
 #include <thread>
 #include <sstream>
 #include <iomanip>
-#include <map>
-#include <iostream>
 #include <cstring>   // memcpy
 #include <algorithm> // max
+#include <array>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <iterator>
 
 namespace fs = std::filesystem;
 
 namespace tabular {
 
 #ifndef NUM_THREADS
-#define NUM_THREADS 4
+#define NUM_THREADS 0 // default worker count; 0 = std::thread::hardware_concurrency()
+#endif
+
+#ifndef MORSEL_SIZE
+#define MORSEL_SIZE (4u<<20) // upper bound on the byte range one findRowOffsets task scans
 #endif
 
 #ifndef CHUNK_SIZE
@@ -35,6 +56,14 @@ namespace tabular {
 static constexpr const char* kHeaderIndexFileName = "header_string_lookup_offsets.bin";
     static const std::vector<std::string> kOutputSubdirs = {"json_data"};
 
+struct TabularData::HeaderTable {
+    std::vector<std::pair<u32,u16>> index; // {offset, length} of each name in the CSV
+    bool named = false;                    // names below are filled in
+    Dictionary names;                      // distinct names, arena-backed
+    std::vector<u32> nameOf;               // column -> name id
+    std::vector<u32> firstColumn;          // name id -> first column with that name
+};
+
 // ------------------------- ctor & simple toggles -------------------------
 TabularData::TabularData(std::string csvPath, std::string outputDir)
     : TabularData(std::move(csvPath), std::move(outputDir), true) {}
@@ -51,13 +80,53 @@ TabularData::TabularData(std::string csvPath, std::string outputDir, bool create
         fs::create_directories(fs::path(_outputDir) / name);
     }
     _headersbinFilePath = (fs::path(_outputDir) / kHeaderIndexFileName).string();
+    _csvPaths = {_csvPath};
+}
+
+TabularData::TabularData(std::vector<std::string> csvPaths, std::string outputDir, bool createStandAloneFiles)
+    : TabularData(csvPaths.empty() ? std::string() : csvPaths.front(), std::move(outputDir), createStandAloneFiles) {
+    _csvPaths = std::move(csvPaths);
 }
 
-void TabularData::skipFaultyRows(bool skip) { this->skipRows = skip; }
+TabularData::~TabularData() = default;
+
+void TabularData::skipFaultyRows(bool skip) { setFaultyRowMode(skip ? FaultyRowMode::Skip : FaultyRowMode::Fail); }
+
+void TabularData::setFaultyRowMode(FaultyRowMode mode, std::uint64_t maxFaults) {
+    _faultMode = mode;
+    _maxFaults = maxFaults;
+}
+
+void TabularData::setInputMode(InputMode mode) {
+    _inputMode = mode;
+    _fetch.reset();
+    _input.reset();
+    _partitions.reset();
+}
+
+void TabularData::setDialect(const Dialect& dialect) {
+    dialect.validate();
+    _dialect = dialect;
+    _headers.reset();
+    _fetch.reset();
+    _profile.reset();
+    if (_partitions) { // where each partition's rows start depends on the dialect
+        _input.reset();
+        _partitions.reset();
+    }
+}
+
+const InputSource& TabularData::input() const {
+    if (!_input) {
+        if (_csvPaths.size() > 1) _input = _partitions = openPartitions();
+        else _input = openInputSource(_csvPath, _inputMode, (fs::path(_outputDir) / "input_index.bin").string());
+    }
+    return *_input;
+}
 
 // ------------------------------ header parse -----------------------------
 
-    static inline std::string trim(const std::string& s) {
+static inline std::string_view trim(std::string_view s) {
     size_t start = 0;
     while (start < s.size() && std::isspace(static_cast<unsigned char>(s[start]))) ++start;
 
@@ -69,36 +138,22 @@ void TabularData::skipFaultyRows(bool skip) { this->skipRows = skip; }
 
 void TabularData::createHeaderJSON() {
     this->createStandAloneDataFiles = false; // force false to read from CSV directly initially
+    const HeaderTable& table = headerTable(true);
     std::ofstream jsonFile((fs::path(_outputDir) / "json_data/headers.json").string(), std::ios::binary);
     //new offset index for quick access from JSON file
     std::ofstream JSONIndexFile((fs::path(_outputDir) / "json_data/headers_json_index.bin").string(), std::ios::binary | std::ios::trunc);
     if (!jsonFile) throw std::runtime_error("Failed to open headers.json for writing");
 
-    const u32 colCount = getColumnCount();
+    const u32 colCount = static_cast<u32>(table.index.size());
     //track bytes written to json file to create new header offset index for quick access from JSON file
     jsonFile << "[\n";
     u32 bytesWritten = 2; // account for "[\n"
     for (u32 col = 0; col < colCount; ++col) {
-        auto [start, end] = readPair(col);
-        if (end < start) continue;
-
-        std::ifstream in(_csvPath, std::ios::binary);
-        if (!in) throw std::runtime_error("Failed to open CSV file: " + _csvPath);
-
-        const u32 len = end - start + 1;
-        std::string buffer(len, '\0');
-
-        in.seekg(static_cast<std::streamoff>(start), std::ios::beg);
-        in.read(buffer.data(), static_cast<std::streamsize>(len));
-        if (!in) throw std::runtime_error("Failed to read header slice from CSV");
-
-        in.close();
-        std::string headerStr = unescapeCsvField(buffer);
-        //trim whitespace
-        headerStr = trim(headerStr);
+        const std::string_view headerStr = table.names.key(table.nameOf[col]);
 
-        //write current byte offset to JSON index file
-        JSONIndexFile.write(reinterpret_cast<const char*>(&bytesWritten), sizeof(u32));
+        //write byte offset of the header text (just past the opening quote) to JSON index file
+        const u32 textOffset = bytesWritten + 1;
+        JSONIndexFile.write(reinterpret_cast<const char*>(&textOffset), sizeof(u32));
         u16 headerLen = static_cast<u16>(headerStr.size());
         //write header length to JSON index file
         JSONIndexFile.write(reinterpret_cast<const char*>(&headerLen), sizeof(u16));
@@ -116,134 +171,239 @@ void TabularData::createHeaderJSON() {
     this->createStandAloneDataFiles = true; //set true since JSON exists
 }
 
+namespace {
+
+// First byte of the header row: past the comment rows before it. A comment
+// row ends at its first CR, LF or CRLF; quotes and escapes in it mean nothing.
+std::uint64_t header_start(const InputSource &src, const Dialect &dialect) {
+    if (dialect.comment == '\0') return 0;
+    SpanReader reader(src, 0, src.size());
+    std::string_view span;
+    std::uint64_t spanOffset = 0;
+    bool atRowStart = true, inComment = false, afterCr = false;
+    while (reader.next(span, spanOffset)) {
+        for (std::size_t i = 0; i < span.size(); ++i) {
+            const char c = span[i];
+            if (atRowStart) {
+                if (afterCr && c == '\n') { afterCr = false; continue; } // the LF of a CRLF
+                if (c != dialect.comment) return spanOffset + i;
+                atRowStart = false;
+                inComment = true;
+            }
+            if (inComment && (c == '\n' || c == '\r')) {
+                atRowStart = true;
+                inComment = false;
+                afterCr = c == '\r';
+            }
+        }
+    }
+    return src.size();
+}
+
+} // end anon
+
 void TabularData::parseHeaderRow() {
+    const Stopwatch timer;
     this->colCount = 0;
+    _headers = std::make_unique<HeaderTable>();
+    std::vector<std::pair<u32,u16>> &index = _headers->index;
 
-    std::ifstream in(_csvPath, std::ios::binary);
-    if (!in) throw std::runtime_error("Failed to open CSV file: " + _csvPath);
+    const InputSource& src = input();
+    const u32 headerStart = static_cast<u32>(header_start(src, _dialect));
 
-    std::ofstream binFile(_headersbinFilePath, std::ios::binary | std::ios::trunc);
-    if (!binFile) throw std::runtime_error("Failed to open headers index file: " + _headersbinFilePath);
-
-    std::vector<char> buf(CHUNK_SIZE);
+    SpanReader reader(src, headerStart, src.size());
+    std::string_view span;
+    std::uint64_t spanOffset = 0;
 
     bool inQuotes = false;
     bool atFieldStart = true;
     bool pendingQuote = false;
+    bool escaped = false;     // the previous byte was the escape byte
+    bool quotedField = false; // text after the closing quote is not part of the name
     bool headerDone = false;
 
-    u32 pos = 0;
-    u32 fieldStart = 0;
-    u32 lastContent = 0;
+    u32 pos = headerStart;
+    u32 fieldStart = headerStart;
+    u32 lastContent = headerStart;
 
+    // index entry: {offset of first byte, length}
     auto close_field = [&]() {
-        const u16 length = (lastContent >= fieldStart) ? lastContent : (fieldStart - 1);
-        binFile.write(reinterpret_cast<const char*>(&fieldStart), sizeof(u32));
-        binFile.write(reinterpret_cast<const char*>(&length),     sizeof(u16));
+        const u16 length = (lastContent >= fieldStart && !atFieldStart)
+                         ? static_cast<u16>(lastContent - fieldStart + 1) : 0;
+        index.emplace_back(fieldStart, length);
     };
 
-    while (!headerDone) {
-        in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
-        const std::streamsize got = in.gcount();
-        if (got <= 0) {
-            if (!atFieldStart) close_field();
-            break;
-        }
+    // the byte loop, specialized for the common dialects
+    withDialect(kindOf(_dialect), _dialect, [&](const auto& d) {
+        while (!headerDone) {
+            if (!reader.next(span, spanOffset)) {
+                if (!atFieldStart || colCount > 0) { close_field(); colCount++; }
+                break;
+            }
 
-        for (std::streamsize i = 0; i < got && !headerDone; ++i, ++pos) {
-            const char c = buf[static_cast<size_t>(i)];
+            const auto got = static_cast<std::ptrdiff_t>(span.size());
+            for (std::ptrdiff_t i = 0; i < got && !headerDone; ++i, ++pos) {
+                const char c = span[static_cast<size_t>(i)];
 
-            if (inQuotes) {
-                if (pendingQuote) {
-                    if (c == '"') { lastContent = pos; pendingQuote = false; continue; }
-                    inQuotes = false; pendingQuote = false; --i; --pos; continue;
+                if (escaped) { // literal, whatever it is
+                    escaped = false;
+                    if (inQuotes || !quotedField) lastContent = pos;
+                    continue;
                 }
-                if (c == '"') { pendingQuote = true; }
-                else { lastContent = pos; }
-            } else {
-                if (atFieldStart) {
-                    if (c == '"') { inQuotes = true; atFieldStart = false; fieldStart = pos + 1; pendingQuote = false; continue; }
-                    atFieldStart = false;
-                    fieldStart = pos;
-                    if (c != ',' && c != '\r' && c != '\n') lastContent = pos;
+                if (inQuotes) {
+                    if (pendingQuote) {
+                        if (d.isQuote(c)) { lastContent = pos; pendingQuote = false; continue; }
+                        inQuotes = false; pendingQuote = false; --i; --pos; continue;
+                    }
+                    if (d.isEscape(c)) { escaped = true; lastContent = pos; }
+                    else if (d.isQuote(c)) { pendingQuote = true; }
+                    else { lastContent = pos; }
+                } else {
+                    if (atFieldStart) {
+                        // leading blanks before a (quoted) name
+                        if ((c == ' ' || c == '\t') && !d.isDelimiter(c)) continue;
+                        fieldStart = pos;
+                        quotedField = false;
+                        if (d.isQuote(c)) { inQuotes = true; atFieldStart = false; quotedField = true; fieldStart = pos + 1; pendingQuote = false; continue; }
+                        if (!d.isDelimiter(c) && c != '\r' && c != '\n') { atFieldStart = false; lastContent = pos; }
+                    }
+
+                    if (d.isEscape(c)) { escaped = true; if (!quotedField) lastContent = pos; continue; }
+                    if (d.isDelimiter(c)) { close_field(); atFieldStart = true; colCount++; continue; }
+                    if (c == '\n') { close_field(); headerDone = true; colCount++; continue; }
+                    if (c == '\r') { close_field(); headerDone = true; colCount++; continue; }
+                    if (!quotedField) lastContent = pos;
                 }
-
-                if (c == ',') { close_field(); atFieldStart = true; colCount++; continue; }
-                if (c == '\n') { close_field(); headerDone = true; colCount++; continue; }
-                if (c == '\r') { close_field(); headerDone = true; colCount++; continue; }
-                lastContent = pos;
             }
         }
-    }
+    });
 
-    in.close();
+    std::ofstream binFile(_headersbinFilePath, std::ios::binary | std::ios::trunc);
+    if (!binFile) throw std::runtime_error("Failed to open headers index file: " + _headersbinFilePath);
+    for (const auto &[start, len] : index) {
+        binFile.write(reinterpret_cast<const char*>(&start), sizeof(u32));
+        binFile.write(reinterpret_cast<const char*>(&len),   sizeof(u16));
+    }
     binFile.close();
+    if (!binFile) throw std::runtime_error("Failed to write headers index file: " + _headersbinFilePath);
+
     if (this->createStandAloneDataFiles) { createHeaderJSON(); }
+    updateMetrics([&](Metrics& m) {
+        m.addPhase(Phase::Header, timer.wallSeconds(), timer.cpuSeconds());
+        m.bytesRead += pos - headerStart;
+    });
 }
 
 // ---------------------------- header accessors ---------------------------
 
-std::pair<TabularData::u32, TabularData::u16>
-TabularData::readPair(std::size_t colNum) const {
-    std::string offsetFile = this->createStandAloneDataFiles ?
-        (fs::path(_outputDir) / "json_data/headers_json_index.bin").string() : _headersbinFilePath;
-    std::ifstream binFile(offsetFile, std::ios::binary);
-    if (!binFile) throw std::runtime_error("Missing headers index file. Run parseHeaderRow() first.");
+namespace {
 
-    const std::size_t stride = sizeof(u32) + sizeof(u16);
-    binFile.seekg(static_cast<std::streamoff>(colNum * stride), std::ios::beg);
+std::vector<std::pair<std::uint32_t, std::uint16_t>> read_pair_file(const std::string &path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) throw std::runtime_error("Missing headers index file. Run parseHeaderRow() first.");
+    const std::size_t stride = sizeof(std::uint32_t) + sizeof(std::uint16_t);
+    std::string bytes(static_cast<size_t>(in.tellg()), '\0');
+    in.seekg(0, std::ios::beg);
+    in.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!in) throw std::runtime_error("Failed to read headers index file: " + path);
+
+    std::vector<std::pair<std::uint32_t, std::uint16_t>> pairs(bytes.size() / stride);
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        std::memcpy(&pairs[i].first,  bytes.data() + i * stride, sizeof(std::uint32_t));
+        std::memcpy(&pairs[i].second, bytes.data() + i * stride + sizeof(std::uint32_t), sizeof(std::uint16_t));
+    }
+    return pairs;
+}
 
-    u32 start = 0;
-    u16 end = 0;
-    binFile.read(reinterpret_cast<char*>(&start), sizeof(u32));
-    binFile.read(reinterpret_cast<char*>(&end),   sizeof(u16));
+} // end anon
 
-    if (!binFile) throw std::out_of_range("Column index out of range or corrupted index file");
-    binFile.close();
-    std::cout<<"Read header pair for col "<<colNum<<": start="<<start<<", end="<<end <<std::endl;
-    return {start, end};
+const TabularData::HeaderTable& TabularData::headerTable(bool withNames) const {
+    if (!_headers) {
+        auto table = std::make_unique<HeaderTable>();
+        table->index = read_pair_file(_headersbinFilePath);
+        _headers = std::move(table);
+    }
+    HeaderTable &t = *_headers;
+    if (!withNames || t.named) return t;
+
+    const size_t n = t.index.size();
+    t.nameOf.resize(n);
+    auto add = [&](size_t col, std::string_view name) {
+        const u32 id = t.names.intern(name);
+        if (id == t.firstColumn.size()) t.firstColumn.push_back(static_cast<u32>(col));
+        t.nameOf[col] = id;
+    };
+
+    const fs::path jsonDir = fs::path(_outputDir) / "json_data";
+    if (this->createStandAloneDataFiles && fs::exists(jsonDir / "headers_json_index.bin")) {
+        // headers.json already holds the unescaped, trimmed names
+        const auto pairs = read_pair_file((jsonDir / "headers_json_index.bin").string());
+        if (pairs.size() != n) throw std::runtime_error("headers.json index doesn't match the header row");
+        const std::string jsonPath = (jsonDir / "headers.json").string();
+        std::ifstream in(jsonPath, std::ios::binary);
+        if (!in) throw std::runtime_error("Failed to open headers file: " + jsonPath);
+        const std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        for (size_t col = 0; col < n; ++col) {
+            const auto [start, len] = pairs[col];
+            if (len != 0 && static_cast<size_t>(start) + len > json.size())
+                throw std::runtime_error("Failed to read header slice from headers.json");
+            add(col, len == 0 ? std::string_view() : std::string_view(json).substr(start, len));
+        }
+    } else {
+        // names are views of the CSV until interned; only a name holding ""
+        // or an escape is rewritten, into a buffer every name reuses
+        const InputSource& src = input();
+        std::vector<char> scratch;
+        std::string unescaped;
+        for (size_t col = 0; col < n; ++col) {
+            const auto [start, len] = t.index[col];
+            const std::string_view raw = src.read(start, len, scratch);
+            if (raw.size() != len) throw std::runtime_error("Failed to read header slice from CSV");
+            add(col, trim(unescapeCsvField(raw, _dialect, unescaped)));
+        }
+    }
+    t.named = true;
+    return t;
+}
+
+std::pair<TabularData::u32, TabularData::u16>
+TabularData::readPair(std::size_t colNum) const {
+    const HeaderTable& t = headerTable(false);
+    if (colNum >= t.index.size()) throw std::out_of_range("Column index out of range");
+    return t.index[colNum];
 }
 
-std::string TabularData::unescapeCsvField(std::string_view raw) {
-    std::string out;
-    out.reserve(raw.size());
-    for (size_t i = 0; i < raw.size(); ++i) {
+std::string_view TabularData::unescapeCsvField(std::string_view raw, const Dialect& dialect, std::string& scratch) {
+    const char q = dialect.quote, e = dialect.escape;
+    size_t i = 0;
+    while (i < raw.size() && !(e && raw[i] == e) && !(q && raw[i] == q && i + 1 < raw.size() && raw[i + 1] == q)) ++i;
+    if (i == raw.size()) return raw;
+    scratch.assign(raw.data(), i);
+    for (; i < raw.size(); ++i) {
         char ch = raw[i];
-        if (ch == '"' && (i + 1) < raw.size() && raw[i + 1] == '"') { out.push_back('"'); ++i; }
-        else { out.push_back(ch); }
+        if (e && ch == e && (i + 1) < raw.size()) { scratch.push_back(raw[++i]); }
+        else if (q && ch == q && (i + 1) < raw.size() && raw[i + 1] == q) { scratch.push_back(q); ++i; }
+        else { scratch.push_back(ch); }
     }
-    return out;
+    return scratch;
 }
 
 
 
 std::string TabularData::getHeader(std::size_t colNum) const {
-    auto [start, end] = readPair(colNum);
-    if (end < start) return std::string();
-    std::string dataFileSource = this->createStandAloneDataFiles ?
-    (fs::path(_outputDir) / "json_data/headers_json_index.bin").string() : _csvPath;
-
-    std::ifstream in(dataFileSource, std::ios::binary);
-    if (!in) throw std::runtime_error("Failed to open CSV file: " + dataFileSource);
-
-    const u32 len = end - start + 1;
-    std::string buffer(len, '\0');
-
-    in.seekg(static_cast<std::streamoff>(start), std::ios::beg);
-    in.read(buffer.data(), static_cast<std::streamsize>(len));
-    if (!in) throw std::runtime_error("Failed to read header slice from CSV");
+    const HeaderTable& t = headerTable(true);
+    if (colNum >= t.index.size()) throw std::out_of_range("Column index out of range");
+    return std::string(t.names.key(t.nameOf[colNum]));
+}
 
-    in.close();
-    return trim(unescapeCsvField(buffer));
+std::int64_t TabularData::findColumn(std::string_view name) const {
+    const HeaderTable& t = headerTable(true);
+    const std::int64_t id = t.names.find(name);
+    return id < 0 ? -1 : static_cast<std::int64_t>(t.firstColumn[static_cast<size_t>(id)]);
 }
 
 const TabularData::u32 TabularData::getColumnCount() const {
-    std::ifstream binFile(_headersbinFilePath, std::ios::binary | std::ios::ate);
-    if (!binFile) throw std::runtime_error("Missing headers index file.");
-    const auto fileSize = binFile.tellg();
-    if (fileSize < 0) throw std::runtime_error("Failed to get size of headers index file.");
-    binFile.close();
-    return static_cast<TabularData::u32>(fileSize) / (sizeof(TabularData::u32) + sizeof(TabularData::u16));
+    return static_cast<u32>(headerTable(false).index.size());
 }
 
 const TabularData::u32 TabularData::getRowCount() const { return this->rowCount; }
@@ -254,581 +414,1607 @@ namespace {
 
 using u64 = std::uint64_t;
 
-struct CsvState {
-    bool inQuotes      = false;
-    bool pendingQuote  = false; // saw " while inQuotes; next char decides
-};
-
-inline bool feed_csv(char c, CsvState &st) {
-    if (st.inQuotes) {
-        if (st.pendingQuote) {
-            st.pendingQuote = false;
-            if (c == '"') { return false; } // "" => literal quote, stay in quotes
-            st.inQuotes = false;            // end quotes; reprocess this char unquoted
-            return feed_csv(c, st);
-        }
-        if (c == '"') { st.pendingQuote = true; return false; }
-        return false;
+using ScanState = DialectScanner::State;
+
+// Scan forward from `pos` under state `st`; return the first byte of the next row.
+u64 scan_to_next_row(const InputSource &src, u64 pos, const Dialect &dialect, ScanState st) {
+    SpanReader reader(src, pos, src.size());
+    RowScanner scanner(dialect, st);
+    std::string_view span;
+    u64 spanOffset = 0;
+    u64 found = src.size();
+    while (reader.next(span, spanOffset)) {
+        const int after = reader.peek(spanOffset + span.size());
+        if (!scanner.scan(span, spanOffset, after, [&](u64 nextStart, std::uint32_t, bool) {
+                found = nextStart;
+                return false;
+            })) break;
     }
-    if (c == '"') { st.inQuotes = true; st.pendingQuote = false; return false; }
-    if (c == '\n' || c == '\r') return true; // row terminator when unquoted
-    return false;
+    return found;
 }
 
-inline int maybe_consume_LF_after_CR(std::ifstream &in) {
-    int next = in.peek();
-    if (next == '\n') { in.get(); return 1; }
-    return 0;
+// True when the rows from `pos` (a row start) to EOF all end in a
+// terminator, the last one a '\n' outside quotes: bytes appended later
+// start a new row.
+bool ends_at_row_start(const InputSource &src, u64 pos, const Dialect &dialect) {
+    if (src.size() == 0) return false;
+    std::vector<char> scratch;
+    if (src.read(src.size() - 1, 1, scratch)[0] != '\n') return false;
+    SpanReader reader(src, pos, src.size());
+    RowScanner scanner(dialect);
+    std::string_view span;
+    u64 spanOffset = 0;
+    u64 last = pos;
+    while (reader.next(span, spanOffset)) {
+        const int after = reader.peek(spanOffset + span.size());
+        scanner.scan(span, spanOffset, after, [&](u64 nextStart, std::uint32_t, bool) {
+            last = nextStart;
+            return true;
+        });
+    }
+    return last == src.size();
 }
 
-inline u64 file_size_bytes(const std::string &path) {
-    return static_cast<u64>(fs::file_size(fs::path(path)));
+// Find offset of the first byte AFTER the header row terminator.
+u64 find_first_data_offset(const InputSource &src, const Dialect &dialect) {
+    // header without newline -> EOF
+    return scan_to_next_row(src, header_start(src, dialect), dialect, DialectScanner::RowStart);
 }
 
-// Find offset of the first byte AFTER the header row terminator.
-u64 find_first_data_offset(const std::string &path) {
-    std::ifstream in(path, std::ios::binary);
-    if (!in) throw std::runtime_error("Failed to open CSV: " + path);
-
-    std::vector<char> buf(CHUNK_SIZE);
-    CsvState st;
-    u64 pos = 0;
-
-    while (true) {
-        in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
-        std::streamsize got = in.gcount();
-        if (got <= 0) break;
-
-        for (std::streamsize i = 0; i < got; ++i, ++pos) {
-            char c = buf[static_cast<size_t>(i)];
-            if (feed_csv(c, st)) {
-                u64 nextStart = pos + 1;
-                if (c == '\r') {
-                    if (i + 1 < got && buf[static_cast<size_t>(i + 1)] == '\n') { ++i; ++pos; ++nextStart; }
-                    else { nextStart += maybe_consume_LF_after_CR(in); pos += (nextStart - (pos + 1)); }
-                }
-                in.close();
-                return nextStart;
-            }
-        }
+// {start, end} of up to n rows from `pos` on, blank ones included.
+std::vector<std::pair<u64,u64>> leading_rows(const InputSource &src, u64 pos, size_t n, const Dialect &dialect) {
+    std::vector<std::pair<u64,u64>> rows;
+    SpanReader reader(src, pos, src.size());
+    RowScanner scanner(dialect);
+    std::string_view span;
+    u64 spanOffset = 0;
+    u64 rowStart = pos;
+    while (rows.size() < n && reader.next(span, spanOffset)) {
+        const int after = reader.peek(spanOffset + span.size());
+        scanner.scan(span, spanOffset, after, [&](u64 nextStart, std::uint32_t, bool) {
+            rows.emplace_back(rowStart, nextStart);
+            rowStart = nextStart;
+            return rows.size() < n;
+        });
     }
-    in.close();
-    return pos; // header without newline
-}
-
-// Robust resync from arbitrary offset S to the first byte of the NEXT row.
-u64 resync_to_next_row_start(const std::string &path, u64 S) {
-    std::ifstream in(path, std::ios::binary);
-    if (!in) throw std::runtime_error("Failed to open CSV for resync");
-    u64 fsize = file_size_bytes(path);
-    if (S >= fsize) { in.close(); return fsize; }
-
-    in.seekg(static_cast<std::streamoff>(S), std::ios::beg);
-    u64 pos = S;
-    CsvState st;
-
-    {   // one-shot disambiguation at S
-        int c0i = in.get();
-        if (c0i == EOF) { in.close(); return pos; }
-        char c0 = static_cast<char>(c0i);
-        ++pos;
-
-        if (c0 == '"') {
-            int n1 = in.peek();
-            if (n1 == ',' || n1 == '\n' || n1 == '\r' || n1 == EOF) {
-                if (n1 == ',') { in.get(); ++pos; }
-                else if (n1 == '\n') { in.get(); ++pos; in.close(); return pos; }
-                else if (n1 == '\r') { in.get(); ++pos; pos += maybe_consume_LF_after_CR(in); in.close(); return pos; }
-                else { in.close(); return fsize; }
-            } else if (n1 == '"') {
-                in.get(); ++pos;
-                int n2 = in.peek();
-                if (n2 == ',' || n2 == '\n' || n2 == '\r' || n2 == EOF) {
-                    if (n2 == ',') { in.get(); ++pos; }
-                    else if (n2 == '\n') { in.get(); ++pos; in.close(); return pos; }
-                    else if (n2 == '\r') { in.get(); ++pos; pos += maybe_consume_LF_after_CR(in); in.close(); return pos; }
-                    else { in.close(); return fsize; }
-                } else {
-                    st.inQuotes = true; // "" then data => literal quote inside quoted
-                }
-            } else {
-                st.inQuotes = true; // opening quote
-            }
-        }
+    if (rows.size() < n && rowStart < src.size()) rows.emplace_back(rowStart, src.size());
+    return rows;
+}
+
+// Non-blank rows starting in [pos, pos + bytes) from a row start `pos`,
+// the last one read to its end: {start, end, delimiters}.
+struct SampledRow { u64 start, end; std::uint32_t delimiters; };
+std::vector<SampledRow> sample_rows(const InputSource &src, u64 pos, u64 bytes, const Dialect &dialect) {
+    std::vector<SampledRow> rows;
+    const u64 limit = std::min(src.size(), pos + bytes);
+    SpanReader reader(src, pos, src.size());
+    RowScanner scanner(dialect);
+    std::string_view span;
+    u64 spanOffset = 0;
+    u64 rowStart = pos;
+    while (rowStart < limit && reader.next(span, spanOffset)) {
+        const int after = reader.peek(spanOffset + span.size());
+        scanner.scan(span, spanOffset, after, [&](u64 nextStart, std::uint32_t delims, bool notBlank) {
+            if (notBlank) rows.push_back({rowStart, nextStart, delims});
+            rowStart = nextStart;
+            return rowStart < limit;
+        });
     }
+    // EOF row without newline
+    if (rowStart < limit && scanner.pendingNotBlank()) rows.push_back({rowStart, src.size(), scanner.pendingCommas()});
+    return rows;
+}
 
-    std::vector<char> buf(CHUNK_SIZE);
-    while (true) {
-        in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
-        std::streamsize got = in.gcount();
-        if (got <= 0) { in.close(); return pos; }
+// Parity of the quote bytes in [from, to). StructuralScanner's quote state
+// only toggles on the quote byte, so a range ends in the state it started in
+// iff this is 0.
+bool quote_parity(const InputSource &src, u64 from, u64 to, char quote) {
+    SpanReader reader(src, from, to);
+    std::string_view span;
+    u64 spanOffset = from;
+    std::uint8_t parity = 0;
+    while (reader.next(span, spanOffset)) {
+        // a plain xor reduction vectorizes better than the scanner's classifier
+        for (const char c : span) parity ^= static_cast<std::uint8_t>(c == quote);
+    }
+    return parity & 1;
+}
 
-        for (std::streamsize i = 0; i < got; ++i, ++pos) {
-            char c = buf[static_cast<size_t>(i)];
-            if (feed_csv(c, st)) {
-                u64 nextStart = pos + 1;
-                if (c == '\r') {
-                    if (i + 1 < got && buf[static_cast<size_t>(i + 1)] == '\n') { ++i; ++pos; ++nextStart; }
-                    else { nextStart += maybe_consume_LF_after_CR(in); pos += (nextStart - (pos + 1)); }
-                }
-                in.close();
-                return nextStart;
-            }
-        }
+// DialectScanner's state after [from, to) for every state before it: the
+// generic dialects' counterpart of quote_parity()
+void dialect_transitions(const InputSource &src, u64 from, u64 to, const Dialect &dialect,
+                         ScanState (&end)[DialectScanner::kStates]) {
+    const DialectScanner scanner(dialect);
+    for (int k = 0; k < DialectScanner::kStates; ++k) end[k] = static_cast<ScanState>(k);
+    SpanReader reader(src, from, to);
+    std::string_view span;
+    u64 spanOffset = from;
+    while (reader.next(span, spanOffset)) {
+        ScanState step[DialectScanner::kStates];
+        scanner.transitions(span, step);
+        for (auto &s : end) s = step[s];
     }
 }
 
-// Parse [start, stop) and write row-start offsets to a binary file.
-// Also validates row width and optionally skips faulty rows.
-void parse_slice_to_file(const std::string &path,
-                         u64 start, u64 stop,
-                         const std::string &outPath,
-                         tabular::TabularData::u32 expectedCols,
-                         std::uint32_t *rowsOut,
-                         bool skipFaultyRows)
-{
-    *rowsOut = 0;
+// Rows of a slice whose width didn't match: how many, and per mode the
+// first one (Fail) or every one in order (Record, the slice's share of
+// faulty_rows.bin).
+struct SliceFault {
+    bool          any      = false; // Fail: parsing stopped at `first`
+    FaultyRow     first;
+    u64           count    = 0;
+    std::vector<FaultyRow> recorded;
+};
 
-    std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
-    if (!out) throw std::runtime_error("Failed to open output: " + outPath);
-    if (start >= stop) return;
+// Faulty rows recorded by all slices of a scan, against Record's limit.
+struct FaultBudget {
+    u64 limit = 0;
+    std::atomic<u64> found{0};
+    std::atomic<bool> exceeded{false};
+};
 
-    std::ifstream in(path, std::ios::binary);
-    if (!in) throw std::runtime_error("Failed to open CSV in worker");
-    in.seekg(static_cast<std::streamoff>(start), std::ios::beg);
+// Parse the rows starting in [start, stop) and append their offsets to rowsOut;
+// onRow(rowStart, rowEnd) sees each kept row as it is found. Also validates
+// row width: faulty rows are counted in *fault and skipped (Skip), recorded
+// there too (Record), or the first one is kept and parsing stops (Fail).
+// Parsing also stops once a budget is exceeded, by any slice. Returns where
+// the last parsed row ended: the first row start >= stop, or EOF.
+template <class OnRow>
+u64 parse_slice(const InputSource &src, const Dialect &dialect,
+                u64 start, u64 stop,
+                tabular::TabularData::u32 expectedCols,
+                std::vector<u64> &rowsOut,
+                FaultyRowMode mode,
+                SliceFault *fault,
+                FaultBudget *budget,
+                OnRow &&onRow)
+{
+    if (start >= stop) return start;
 
-    std::vector<char> buf(CHUNK_SIZE);
-    CsvState st;
+    // the last row may run past stop; read on to EOF if needed
+    SpanReader reader(src, start, src.size());
+    RowScanner scanner(dialect);
+    std::string_view span;
+    u64 spanOffset = start;
     u64 pos = start;
 
     u64 currentRowStart = start;
-    std::uint32_t commaCount = 0;
-    bool rowNotBlank = false;
 
-    auto handle_row_end = [&](u64 nextStart) {
+    auto handle_row_end = [&](u64 nextStart, std::uint32_t commaCount, bool rowNotBlank) {
         if (!rowNotBlank) { // blank row -> ignore
             currentRowStart = nextStart;
-            commaCount = 0; rowNotBlank = false; return;
+            return;
         }
 
         std::uint32_t fields = commaCount + 1;
         if (fields != expectedCols) {
-            if (skipFaultyRows) {
-                // skip: do not emit, just reset
-                currentRowStart = nextStart;
-                commaCount = 0; rowNotBlank = false;
+            ++fault->count;
+            if (mode == FaultyRowMode::Fail) {
+                // the slice may be speculative; the caller decides once it's verified
+                if (!fault->any) {
+                    fault->any = true;
+                    fault->first = {currentRowStart, fields};
+                }
                 return;
             }
-            std::ostringstream msg;
-            msg << "Column count mismatch at row starting offset " << currentRowStart
-                << ": expected " << expectedCols << ", found " << fields;
-            std::cerr << msg.str() << std::endl;
-            std::terminate();
+            if (mode == FaultyRowMode::Record) {
+                fault->recorded.push_back({currentRowStart, fields});
+                if (budget && budget->found.fetch_add(1, std::memory_order_relaxed) + 1 > budget->limit) {
+                    budget->exceeded.store(true, std::memory_order_relaxed);
+                }
+            }
+            // do not emit, just reset
+            currentRowStart = nextStart;
+            return;
         }
 
-        out.write(reinterpret_cast<const char*>(&currentRowStart), sizeof(u64));
-        ++(*rowsOut);
+        rowsOut.push_back(currentRowStart);
+        onRow(currentRowStart, nextStart);
 
         currentRowStart = nextStart;
-        commaCount = 0; rowNotBlank = false;
     };
 
-    while (true) {
-        in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
-        std::streamsize got = in.gcount();
-        if (got <= 0) break;
+    while (reader.next(span, spanOffset)) {
+        pos = spanOffset + span.size();
+        const bool more = scanner.scan(span, spanOffset, reader.peek(pos),
+            [&](u64 nextStart, std::uint32_t commaCount, bool rowNotBlank) {
+                handle_row_end(nextStart, commaCount, rowNotBlank);
+                return nextStart < stop && !fault->any
+                    && !(budget && budget->exceeded.load(std::memory_order_relaxed));
+            });
+        if (!more) return currentRowStart;
+    }
+
+    // EOF row without newline
+    if (pos > currentRowStart) handle_row_end(pos, scanner.pendingCommas(), scanner.pendingNotBlank());
+    return pos;
+}
+
+// Field `col` of n rows, the fields of row i starting at starts[i] and
+// ending by bound(i): emit(i, &token), or emit(i, nullptr) for a short row.
+template <class Bound, class Emit>
+void for_each_field(const InputSource &src, const Dialect &dialect, const u64 *starts, size_t n, int col,
+                    Bound &&bound, Emit &&emit) {
+    if (n == 0) return;
+    RowTokenizer tokenizer(src, starts[0], bound(n - 1), dialect);
+    for (size_t i = 0; i < n; ++i) {
+        int k = 0;
+        bool found = false;
+        tokenizer.fields(starts[i], bound(i), col + 1, [&](std::string_view token) {
+            if (k++ < col) return;
+            emit(i, &token);
+            found = true;
+        });
+        if (!found) emit(i, nullptr);
+    }
+}
+
+// Final type of a column from its typed runs run(0..nruns): String unless
+// every run kept a native type, the types mix (Int64 + Float64 -> Float64)
+// and some run saw a value. Runs are converted to a native result; with a
+// String result the caller dictionary-encodes the runs not yet demoted.
+template <class Run>
+ColumnType settle_column_type(size_t nruns, Run &&run) {
+    bool any = false;
+    ColumnType type = ColumnType::String;
+    for (size_t i = 0; i < nruns; ++i) {
+        const TypedColumn &r = run(i);
+        if (r.demoted()) return ColumnType::String;
+        if (r.empty()) continue;
+        type = any ? TypedColumn::unify(type, r.type()) : r.type();
+        any = true;
+        if (type == ColumnType::String) return type;
+    }
+    if (!any) return ColumnType::String; // nothing but missing cells
+    for (size_t i = 0; i < nruns; ++i) {
+        if (!run(i).convertTo(type)) return ColumnType::String;
+    }
+    return type;
+}
 
-        for (std::streamsize i = 0; i < got; ++i, ++pos) {
-            char c = buf[static_cast<size_t>(i)];
+} // end anon
 
-            if (!st.inQuotes) {
-                if (c == ',') { ++commaCount; rowNotBlank = true; }
-                else if (c == '"') { rowNotBlank = true; }
-                else if (c != ' ' && c != '\t' && c != '\r' && c != '\n') { rowNotBlank = true; }
+// ------------------------------- partitions -------------------------------
+
+std::shared_ptr<PartitionedSource> TabularData::openPartitions() const {
+    std::vector<std::shared_ptr<InputSource>> parts;
+    std::vector<u64> skips;
+    bool haveHeader = false;
+    std::string header; // the first partition's header row, terminator excluded
+    std::vector<char> scratch;
+    for (const std::string& path : _csvPaths) {
+        const std::string index = "input_index_" + std::to_string(parts.size()) + ".bin";
+        std::shared_ptr<InputSource> src = openInputSource(path, _inputMode, (fs::path(_outputDir) / index).string());
+        u64 skip = 0;
+        if (src->size() > 0) { // an empty partition has no header to check
+            const u64 start = header_start(*src, _dialect);
+            const u64 data = find_first_data_offset(*src, _dialect);
+            std::string_view row = src->read(start, static_cast<size_t>(data - start), scratch);
+            while (!row.empty() && (row.back() == '\n' || row.back() == '\r')) row.remove_suffix(1);
+            if (!haveHeader) {
+                header.assign(row); // this one's header row is the table's
+                haveHeader = true;
+            } else {
+                if (row != header) throw std::runtime_error("Header row of " + path + " differs from the first partition's");
+                skip = data;
             }
+        }
+        skips.push_back(skip);
+        parts.push_back(std::move(src));
+    }
+    return std::make_shared<PartitionedSource>(std::move(parts), skips);
+}
 
-            if (feed_csv(c, st)) {
-                u64 nextStart = pos + 1;
-                if (c == '\r') {
-                    if (i + 1 < got && buf[static_cast<size_t>(i + 1)] == '\n') { ++i; ++pos; ++nextStart; }
-                    else { nextStart += maybe_consume_LF_after_CR(in); pos += (nextStart - (pos + 1)); }
-                }
-                handle_row_end(nextStart);
-                if (nextStart >= stop) return;
+// -------------------------------- profile --------------------------------
+
+#ifndef PROFILE_BLOCKS
+#define PROFILE_BLOCKS 32 // evenly spaced blocks profile() samples
+#endif
+#ifndef PROFILE_BLOCK_BYTES
+#define PROFILE_BLOCK_BYTES (64u<<10) // rows starting in this many bytes of each
+#endif
+#ifndef PROFILE_SKETCH_BYTES
+#define PROFILE_SKETCH_BYTES (16u<<20) // HyperLogLog registers over all columns
+#endif
+
+const DataProfile& TabularData::profile() {
+    const Stopwatch timer;
+    if (this->colCount < 0) parseHeaderRow();
+    const InputSource& src = input();
+    const size_t ncols = static_cast<size_t>(std::max(0, this->colCount));
+    auto p = std::make_unique<DataProfile>();
+    p->fileBytes = src.size();
+    p->columns.resize(ncols);
+
+    const u64 firstData = src.size() == 0 ? 0 : find_first_data_offset(src, _dialect);
+    const u64 dataBytes = src.size() - firstData;
+    const u64 blocks = PROFILE_BLOCKS;
+    p->exact = dataBytes <= blocks * PROFILE_BLOCK_BYTES;
+
+    unsigned precision = 4;
+    while (precision < 12 && (size_t(2) << precision) * std::max<size_t>(1, ncols) <= PROFILE_SKETCH_BYTES) ++precision;
+    std::vector<HyperLogLog> sketches(ncols, HyperLogLog(precision));
+    std::vector<TypedColumn> typed(ncols);
+    std::vector<u64> cells(ncols, 0), cellBytes(ncols, 0);
+    std::vector<bool> proven(ncols, false); // a cell read from a known row start didn't fit a type
+
+    // A block's first row is found like a morsel's, but without the parity
+    // pre-pass: the quote state at its start is guessed, taking whichever
+    // of "outside" / "inside a quoted field" yields more rows of the
+    // header's width.
+    const bool stateless = _dialect.quote == '\0' && _dialect.escape == '\0';
+    for (u64 b = 0; b < (p->exact ? 1 : blocks); ++b) {
+        const u64 at = firstData + b * dataBytes / blocks;
+        const u64 span = p->exact ? dataBytes : PROFILE_BLOCK_BYTES;
+        std::vector<SampledRow> rows;
+        if (b == 0) {
+            rows = sample_rows(src, firstData, span, _dialect);
+        } else {
+            size_t bestFit = 0;
+            for (ScanState st : {DialectScanner::Field, DialectScanner::Quoted}) {
+                if (st == DialectScanner::Quoted && _dialect.quote == '\0') continue;
+                const u64 start = scan_to_next_row(src, at - 1, _dialect, st);
+                std::vector<SampledRow> guess = sample_rows(src, start, span, _dialect);
+                const size_t fit = static_cast<size_t>(std::count_if(guess.begin(), guess.end(),
+                    [&](const SampledRow& r) { return r.delimiters + 1 == ncols; }));
+                if (rows.empty() || fit > bestFit) { rows = std::move(guess); bestFit = fit; }
             }
         }
+        if (rows.empty()) continue;
+
+        const bool certain = b == 0 || stateless;
+        RowTokenizer tokenizer(src, rows.front().start, rows.back().end, _dialect);
+        for (const SampledRow& row : rows) {
+            ++p->sampledRows;
+            p->sampledBytes += row.end - row.start;
+            size_t c = 0;
+            tokenizer.fields(row.start, row.end, static_cast<int>(ncols), [&](std::string_view token) {
+                sketches[c].add(Dictionary::hash(token));
+                if (!token.empty()) ++cells[c];
+                cellBytes[c] += token.size();
+                if (!typed[c].demoted() && !typed[c].append(token)) {
+                    typed[c].demote();
+                    if (certain) proven[c] = true;
+                }
+                ++c;
+            });
+        }
     }
 
-    // EOF row without newline
-    if (pos > currentRowStart) handle_row_end(pos);
+    p->avgRowBytes = p->sampledRows ? static_cast<double>(p->sampledBytes) / static_cast<double>(p->sampledRows) : 0;
+    p->estimatedRows = p->exact || p->avgRowBytes == 0
+                     ? p->sampledRows : static_cast<u64>(static_cast<double>(dataBytes) / p->avgRowBytes + 0.5);
+    const double scale = p->sampledRows ? static_cast<double>(p->estimatedRows) / static_cast<double>(p->sampledRows) : 0;
+    for (size_t c = 0; c < ncols; ++c) {
+        DataProfile::Column& col = p->columns[c];
+        col.type = typed[c].demoted() || typed[c].empty() ? ColumnType::String : typed[c].type();
+        col.provenString = proven[c];
+        col.avgBytes = p->sampledRows ? static_cast<double>(cellBytes[c]) / static_cast<double>(p->sampledRows) : 0;
+        // the sample sees at most one distinct value per row (or per valued cell, plus the empty one)
+        const double seen = static_cast<double>(std::min(p->sampledRows, cells[c] + 1));
+        const double d = std::min(sketches[c].estimate(), seen);
+        col.sampleDistinct = static_cast<u64>(d + 0.5);
+        // each unsampled row brings a new value about as often as a pair
+        // of sampled rows does: (d / seen)^2
+        const double all = seen * scale;
+        const double ratio = seen > 0 ? d / seen : 0;
+        col.distinct = p->exact ? col.sampleDistinct
+                                : static_cast<u64>(std::min(all, d + (all - seen) * ratio * ratio) + 0.5);
+    }
+    p->seconds = timer.wallSeconds();
+    _profile = std::move(p);
+    return *_profile;
 }
 
-} // end anon
+// ----------------------------- thread count ------------------------------
 
-// --------------------------- findRowOffsets ------------------------------
+void TabularData::setThreadCount(unsigned n) {
+    if (n == 0) n = std::thread::hardware_concurrency();
+    _threadCount = std::max(1u, n);
+}
+
+unsigned TabularData::threadCount() const {
+    if (_threadCount == 0) {
+        unsigned n = NUM_THREADS;
+        if (n == 0) n = std::thread::hardware_concurrency();
+        return std::max(1u, n);
+    }
+    return _threadCount;
+}
+
+void TabularData::setThreadPool(std::shared_ptr<ThreadPool> pool) {
+    _pool = std::move(pool);
+    _poolShared = _pool != nullptr;
+}
+
+ThreadPool& TabularData::threadPool() const {
+    // an owned pool follows setThreadCount(); a shared one is the caller's
+    if (!_pool || (!_poolShared && _pool->size() != threadCount())) {
+        _pool = std::make_shared<ThreadPool>(threadCount());
+    }
+    return *_pool;
+}
+
+// -------------------------------- metrics --------------------------------
+
+Metrics TabularData::metrics() const {
+    std::lock_guard<std::mutex> lock(_metricsMutex);
+    return _metrics;
+}
+
+void TabularData::resetMetrics() {
+    std::lock_guard<std::mutex> lock(_metricsMutex);
+    _metrics = Metrics{};
+}
+
+// ------------------------------ fused scan -------------------------------
+
+#ifndef FUSED_SEGMENT_BUDGET
+#define FUSED_SEGMENT_BUDGET (1u<<20) // cap on morsels x fused columns (PackedColumn objects)
+#endif
 
-void TabularData::findRowOffsets() {
-    const std::string prefix = (fs::path(_outputDir) / "row_offsets").string();
+// State of scanAndTranspose(): columns [0, ncols) are tokenized and encoded
+// while findRowOffsets' workers parse their morsels, so the data rows are
+// read once. Ids index the dictionaries of the worker that parsed the morsel.
+struct TabularData::FusedScan {
+    Dialect dialect;
+    int ncols = 0;
+    bool keepCursors = false;                     // columns past ncols remain
+    std::vector<std::vector<Dictionary>> dicts;   // [worker][col]
+    std::vector<std::vector<PackedColumn>> segs;  // [morsel][col], one cell per kept row
+    std::vector<std::vector<u64>> cursors;        // [morsel] resume offset of each row at column ncols
+    std::vector<unsigned> owner;                  // morsel -> worker
+    std::vector<u64> rowCursor;                   // cursors, stitched in row order
+    bool inferTypes = false;
+    std::vector<std::vector<TypedColumn>> typed;  // [morsel][col], columns still typed; type inference only
+    std::vector<size_t> firstRow;                 // [morsel] index of its first row in the stitched offsets
+
+    struct Sink;
+    void merge(const InputSource& src, const std::vector<u64>& rowOffsets, ThreadPool& pool, unsigned nthreads, bool sortedIds,
+               std::vector<Dictionary>& globalDict, std::vector<ColumnType>& types, uint32_t& outMaxGlobalIdInChunk);
+};
 
-    const u64 fsize = file_size_bytes(_csvPath);
-    if (fsize == 0) {
-        for (int t = 0; t < NUM_THREADS; ++t) {
-            std::ostringstream oss; oss << prefix << ".part-" << t << ".bin";
-            std::ofstream(oss.str(), std::ios::binary | std::ios::trunc).close();
+// encodes one morsel's rows into fused.segs[m] with worker w's dictionaries
+struct TabularData::FusedScan::Sink {
+    FusedScan &fused;
+    const InputSource &src;
+    RowTokenizer tokenizer;
+    std::vector<PackedColumn> &segs;
+    std::vector<Dictionary> &dicts;
+    std::vector<u64> &cursors;
+    const std::vector<u64> &rows;   // the morsel's row starts, the current row last
+    TypedColumn *typed = nullptr;   // [col], with type inference
+
+    Sink(FusedScan &f, const InputSource &src, size_t m, unsigned w, u64 begin, u64 end, const std::vector<u64> &rows)
+        : fused(f), src(src), tokenizer(src, begin, end, f.dialect), segs(f.segs[m]), dicts(f.dicts[w]), cursors(f.cursors[m]),
+          rows(rows) {
+        f.owner[m] = w;
+        segs.assign(static_cast<size_t>(f.ncols), PackedColumn());
+        cursors.clear();
+        if (f.inferTypes) {
+            f.typed[m].assign(static_cast<size_t>(f.ncols), TypedColumn());
+            typed = f.typed[m].data();
         }
-        return;
     }
 
-    const u64 firstData = find_first_data_offset(_csvPath);
-    if (firstData >= fsize) {
-        for (int t = 0; t < NUM_THREADS; ++t) {
-            std::ostringstream oss; oss << prefix << ".part-" << t << ".bin";
-            std::ofstream(oss.str(), std::ios::binary | std::ios::trunc).close();
+    void operator()(u64 rowStart, u64 rowEnd) {
+        int c = 0;
+        const u64 resume = tokenizer.fields(rowStart, rowEnd, fused.ncols, [&](std::string_view token) {
+            if (typed && !typed[c].demoted()) {
+                if (typed[c].append(token)) { ++c; return; }
+                demote(c);
+            }
+            segs[c].append(dicts[c].intern(token));
+            ++c;
+        });
+        for (; c < fused.ncols; ++c) { // short row
+            if (typed && !typed[c].demoted()) typed[c].appendMissing();
+            else segs[c].appendMissing();
         }
+        if (fused.keepCursors) cursors.push_back(resume);
+    }
+
+    // column c isn't typed after all: dictionary-encode the rows before this one
+    void demote(int c) {
+        typed[c].demote();
+        for_each_field(src, fused.dialect, rows.data(), rows.size() - 1, c, [&](size_t i) { return rows[i + 1]; },
+                       [&](size_t, const std::string_view *token) {
+                           if (token) segs[c].append(dicts[c].intern(*token));
+                           else segs[c].appendMissing();
+                       });
+    }
+};
+
+void TabularData::scanAndTranspose() {
+    parseHeaderRow();
+    FusedScan fused;
+    scanRows(&fused);
+    transposeFrom(&fused);
+}
+
+// --------------------------- findRowOffsets ------------------------------
+
+void TabularData::findRowOffsets() { scanRows(nullptr); }
+
+void TabularData::scanRows(FusedScan *fused, u64 from) {
+    flushRowOffsets(); // a previous background write still reads _rowOffsets
+    const Stopwatch scanTimer;
+    if (fused && from > 0) throw std::logic_error("Fused scan of appended rows");
+    const fs::path merged = fs::path(_outputDir) / "row_offsets.bin";
+    const InputSource& src = input();
+    const u64 fsize = src.size();
+    if (from == 0) {
+        IndexState::remove(_outputDir); // the columns no longer match these offsets
+        this->rowCount = 0;
+        _rowOffsets.clear();
+    }
+    const size_t base = _rowOffsets.size(); // rows kept from before `from`
+
+    if (_faultMode != FaultyRowMode::Record) FaultyRowReport::remove(_outputDir); // would go stale
+
+    const u64 firstData = (from > 0) ? from : (fsize == 0) ? 0 : find_first_data_offset(src, _dialect);
+    if (firstData >= fsize) {
+        if (_writeRowOffsets) write_row_offsets_async(merged.string());
+        if (_faultMode == FaultyRowMode::Record) saveFaultyRows({}, from);
         return;
     }
 
-    const u64 dataBytes = fsize - firstData;
-    const u64 base = dataBytes / NUM_THREADS;
-    const u64 rem  = dataBytes % NUM_THREADS;
+    // Many small morsels pulled from a shared counter, so a slow or dense
+    // range holds up one task instead of a fixed 1/N of the file. Morsel m
+    // owns the rows starting in [lo, hi): it parses until a row starts at or
+    // past hi, and its successor finds that same row by scanning from hi - 1.
+    // That scan needs the quote state at hi - 1, which no local guess can
+    // tell inside long quoted fields. So a first parallel pass takes each
+    // morsel's quote parity, a serial prefix xor turns the parities into the
+    // exact state at every boundary, and the second pass parses from there.
+    const unsigned nthreads = threadCount();
+    ThreadPool& pool = threadPool();
+    const u64 dataBytes   = fsize - firstData;
+    u64 morselBytes = std::clamp<u64>(dataBytes / (u64(nthreads) * 8), 64u << 10, MORSEL_SIZE);
+    if (fused) {
+        // every morsel holds a segment per fused column: fewer, larger morsels
+        fused->ncols = std::max(0, std::min(this->colCount, COLUMNS_PER_CHUNK));
+        if (_memoryBudget > 0 && this->colCount > 0) {
+            // row count isn't known yet: extrapolate it from the leading rows
+            const auto head = leading_rows(src, firstData, ChunkPlanner::sampleRows(this->colCount), _dialect);
+            const u64 headBytes = head.empty() ? 1 : std::max<u64>(1, head.back().second - firstData);
+            const u64 estRows = std::max<u64>(1, dataBytes * head.size() / headBytes);
+            ChunkPlanner planner(src, _dialect, _memoryBudget, 0, this->colCount, estRows, static_cast<int>(nthreads), head);
+            fused->ncols = planner.next(0);
+        }
+        fused->keepCursors = this->colCount > fused->ncols;
+        const u64 target = std::clamp<u64>(FUSED_SEGMENT_BUDGET / std::max(1, fused->ncols),
+                                           nthreads, u64(nthreads) * 8);
+        morselBytes = std::max<u64>(morselBytes, (dataBytes + target - 1) / target);
+    }
+    const size_t nmorsels = static_cast<size_t>((dataBytes + morselBytes - 1) / morselBytes);
+    const unsigned nworkers = std::min<unsigned>(nthreads, static_cast<unsigned>(nmorsels));
+    if (fused) {
+        fused->dialect = _dialect;
+        fused->dicts.resize(nworkers);
+        for (auto &d : fused->dicts) d.resize(static_cast<size_t>(fused->ncols));
+        fused->segs.resize(nmorsels);
+        fused->cursors.resize(nmorsels);
+        fused->owner.resize(nmorsels);
+        fused->inferTypes = _inferTypes;
+        if (_inferTypes) fused->typed.resize(nmorsels);
+    }
 
-    std::vector<u64> S(NUM_THREADS);
-    {
-        u64 cur = firstData;
-        for (int t = 0; t < NUM_THREADS; ++t) {
-            S[t] = cur;
-            cur += base + (t < static_cast<int>(rem) ? 1 : 0);
+    std::vector<std::vector<u64>> morselRows(nmorsels);
+    std::vector<u64> begins(nmorsels), ends(nmorsels), reached(nmorsels);
+    std::vector<SliceFault> faults(nmorsels);
+    FaultBudget budget;
+    budget.limit = _maxFaults;
+    FaultBudget* const limit = _faultMode == FaultyRowMode::Record && _maxFaults > 0 ? &budget : nullptr;
+    std::vector<Metrics::Slice> slices(nmorsels);
+    std::vector<Metrics::PhaseStats> resyncTime(nworkers), parseTime(nworkers); // [worker], thread time
+    // with a profile, each morsel's offsets take one allocation
+    const double avgRowBytes = _profile && _profile->avgRowBytes > 0 ? _profile->avgRowBytes : 0;
+    auto parse_morsel = [&](size_t m, unsigned worker) {
+        if (avgRowBytes > 0 && ends[m] > begins[m]) {
+            morselRows[m].reserve(static_cast<size_t>(static_cast<double>(ends[m] - begins[m]) / avgRowBytes * 1.1) + 16);
+        }
+        if (!fused) {
+            reached[m] = parse_slice(src, _dialect, begins[m], ends[m], this->colCount, morselRows[m],
+                                     _faultMode, &faults[m], limit, [](u64, u64) {});
+            return;
         }
+        FusedScan::Sink sink(*fused, src, m, worker, begins[m], ends[m], morselRows[m]);
+        reached[m] = parse_slice(src, _dialect, begins[m], ends[m], this->colCount, morselRows[m],
+                                 _faultMode, &faults[m], limit, sink);
+    };
+
+    // where the boundary scan of morsel m starts, and the scanner state
+    // there; a single worker parses the morsels in order and just continues
+    // instead. Without quotes (or escapes) there is no state to carry. With
+    // an escape or comment byte the state isn't a parity, so the first pass
+    // maps every possible start state of a morsel to its end state instead,
+    // and the serial pass composes those maps.
+    auto scan_from = [&](size_t m) { return m == 0 ? firstData : firstData + m * morselBytes - 1; };
+    std::vector<ScanState> state(nmorsels, DialectScanner::RowStart);
+    std::atomic<size_t> nextMorsel{0};
+    if (nworkers > 1 && (_dialect.quote != '\0' || _dialect.generic())) {
+        if (_dialect.generic()) {
+            std::vector<std::array<ScanState, DialectScanner::kStates>> maps(nmorsels);
+            pool.run(nworkers, [&](unsigned t) {
+                const Stopwatch resync(Stopwatch::Cpu::Thread);
+                for (size_t m; (m = nextMorsel.fetch_add(1)) + 1 < nmorsels;) {
+                    ScanState end[DialectScanner::kStates];
+                    dialect_transitions(src, scan_from(m), scan_from(m + 1), _dialect, end);
+                    std::copy(std::begin(end), std::end(end), maps[m].begin());
+                }
+                resyncTime[t].wallSeconds += resync.wallSeconds();
+                resyncTime[t].cpuSeconds += resync.cpuSeconds();
+            });
+            for (size_t m = 1; m < nmorsels; ++m) state[m] = maps[m - 1][state[m - 1]];
+        } else {
+            std::vector<std::uint8_t> parity(nmorsels, 0);
+            pool.run(nworkers, [&](unsigned t) {
+                const Stopwatch resync(Stopwatch::Cpu::Thread);
+                for (size_t m; (m = nextMorsel.fetch_add(1)) + 1 < nmorsels;) {
+                    parity[m] = quote_parity(src, scan_from(m), scan_from(m + 1), _dialect.quote);
+                }
+                resyncTime[t].wallSeconds += resync.wallSeconds();
+                resyncTime[t].cpuSeconds += resync.cpuSeconds();
+            });
+            for (size_t m = 1; m < nmorsels; ++m) {
+                state[m] = (state[m - 1] == DialectScanner::Quoted) != (parity[m - 1] != 0)
+                         ? DialectScanner::Quoted : DialectScanner::Field;
+            }
+        }
+        nextMorsel = 0;
     }
 
-    std::vector<u64> handoff(NUM_THREADS + 1);
-    handoff[0] = firstData;
-    handoff[NUM_THREADS] = fsize;
+    pool.run(nworkers, [&](unsigned t) {
+        for (size_t m; (m = nextMorsel.fetch_add(1)) < nmorsels;) {
+            const u64 hi = firstData + (m + 1) * morselBytes;
+            const Stopwatch resync(Stopwatch::Cpu::Thread);
+            if (m == 0) begins[m] = firstData;
+            else if (nworkers == 1) begins[m] = reached[m - 1];
+            else begins[m] = scan_to_next_row(src, scan_from(m), _dialect, state[m]);
+            ends[m]   = (m + 1 == nmorsels) ? fsize : hi;
+            const double resyncWall = resync.wallSeconds();
+            resyncTime[t].wallSeconds += resyncWall;
+            resyncTime[t].cpuSeconds += resync.cpuSeconds();
+            ++resyncTime[t].calls;
+            const Stopwatch parse(Stopwatch::Cpu::Thread);
+            parse_morsel(m, t);
+            slices[m].worker = t;
+            slices[m].seconds = resyncWall + parse.wallSeconds();
+            parseTime[t].wallSeconds += parse.wallSeconds();
+            parseTime[t].cpuSeconds += parse.cpuSeconds();
+            ++parseTime[t].calls;
+        }
+    });
+
+    // Boundaries are exact, so every morsel starts where its predecessor's
+    // rows end. Kept as a check: re-parse any that doesn't from the true
+    // boundary (in order, so each fix is final). Not when the slices were
+    // cut short by Record's limit: the scan fails anyway.
+    for (size_t m = 1; m < nmorsels && !budget.exceeded.load(); ++m) {
+        if (begins[m] == reached[m - 1]) continue;
+        if (faults[m - 1].any) break; // everything after the first fault is moot
+        morselRows[m].clear();
+        faults[m] = SliceFault{};
+        begins[m] = reached[m - 1];
+        const Stopwatch parse(Stopwatch::Cpu::Thread);
+        parse_morsel(m, fused ? fused->owner[m] : 0);
+        slices[m].seconds += parse.wallSeconds();
+        slices[m].reparsed = true;
+        parseTime[slices[m].worker].wallSeconds += parse.wallSeconds();
+        parseTime[slices[m].worker].cpuSeconds += parse.cpuSeconds();
+    }
 
-    std::vector<std::thread> disc;
-    disc.reserve(NUM_THREADS - 1);
-    for (int t = 1; t < NUM_THREADS; ++t) {
-        disc.emplace_back([&, t]{
-            handoff[t] = resync_to_next_row_start(_csvPath, S[t]);
-        });
+    u64 faultyRows = 0;
+    for (const auto &f : faults) faultyRows += f.count;
+    updateMetrics([&](Metrics& m) { m.faultyRows = faultyRows; });
+    const u32 expected = static_cast<u32>(this->colCount);
+    for (const auto &f : faults) {
+        if (!f.any) continue;
+        std::ostringstream msg;
+        msg << "Column count mismatch at row starting offset " << f.first.offset
+            << ": expected " << expected << ", found " << f.first.found;
+        throw FaultyRowsError(msg.str(), f.first, expected, 1);
     }
-    for (auto &th : disc) th.join();
-
-    std::vector<std::thread> workers;
-    uint32_t threadRowCounts[NUM_THREADS] = {0};
-    workers.reserve(NUM_THREADS);
-    for (int t = 0; t < NUM_THREADS; ++t) {
-        std::ostringstream oss; oss << prefix << ".part-" << t << ".bin";
-        const std::string outPath = oss.str();
-        workers.emplace_back([&, t, outPath]{
-            parse_slice_to_file(_csvPath, handoff[t], handoff[t + 1],
-                                outPath, this->colCount,
-                                &threadRowCounts[t], this->skipRows);
-        });
+    if (_faultMode == FaultyRowMode::Record) {
+        // the slices' lists, in slice order: ascending offsets
+        std::vector<FaultyRow> recorded;
+        recorded.reserve(static_cast<size_t>(faultyRows));
+        for (auto &f : faults) {
+            recorded.insert(recorded.end(), f.recorded.begin(), f.recorded.end());
+            std::vector<FaultyRow>().swap(f.recorded);
+        }
+        const FaultyRow first = recorded.empty() ? FaultyRow{} : recorded.front();
+        saveFaultyRows(std::move(recorded), from);
+        if (_maxFaults > 0 && faultyRows > _maxFaults) {
+            std::ostringstream msg;
+            msg << "More than " << _maxFaults << " rows without " << expected << " fields, the first at offset "
+                << first.offset << "; found " << faultyRows << " before stopping";
+            throw FaultyRowsError(msg.str(), first, expected, faultyRows);
+        }
     }
-    for (auto &th : workers) th.join();
 
-    this->rowCount = 0;
-    for (int t = 0; t < NUM_THREADS; ++t) this->rowCount += threadRowCounts[t];
+    for (size_t m = 0; m < nmorsels; ++m) {
+        slices[m].begin = begins[m];
+        slices[m].end = reached[m];
+        slices[m].rows = morselRows[m].size();
+    }
 
-    // Merge + delete parts
-    {
-        const fs::path pfx = fs::path(_outputDir) / "row_offsets";
-        const fs::path merged = fs::path(_outputDir) / "row_offsets.bin";
+    // stitch the per-morsel vectors together at their prefix counts
+    const Stopwatch stitch;
+    std::vector<size_t> prefix(nmorsels + 1, 0);
+    for (size_t m = 0; m < nmorsels; ++m) prefix[m + 1] = prefix[m] + morselRows[m].size();
+    _rowOffsets.resize(base + prefix[nmorsels]);
+    if (fused && fused->keepCursors) fused->rowCursor.resize(prefix[nmorsels]);
+    nextMorsel = 0;
+    pool.run(nworkers, [&](unsigned) {
+        for (size_t m; (m = nextMorsel.fetch_add(1)) < nmorsels;) {
+            std::copy(morselRows[m].begin(), morselRows[m].end(), _rowOffsets.begin() + base + prefix[m]);
+            std::vector<u64>().swap(morselRows[m]);
+            if (fused && fused->keepCursors) {
+                std::copy(fused->cursors[m].begin(), fused->cursors[m].end(), fused->rowCursor.begin() + prefix[m]);
+                std::vector<u64>().swap(fused->cursors[m]);
+            }
+        }
+    });
+    this->rowCount = static_cast<u32>(_rowOffsets.size());
+    if (fused) fused->firstRow = std::move(prefix);
+
+    if (_writeRowOffsets) write_row_offsets_async(merged.string());
+
+    updateMetrics([&](Metrics& m) {
+        double busiest = 0, total = 0;
+        m.workerSeconds.assign(nworkers, 0);
+        for (unsigned t = 0; t < nworkers; ++t) {
+            m.addPhase(Phase::Resync, resyncTime[t]);
+            m.addPhase(Phase::SliceParse, parseTime[t]);
+            m.workerSeconds[t] = resyncTime[t].wallSeconds + parseTime[t].wallSeconds;
+            busiest = std::max(busiest, m.workerSeconds[t]);
+            total += m.workerSeconds[t];
+        }
+        m.addPhase(Phase::Merge, stitch.wallSeconds(), stitch.cpuSeconds());
+        m.scanImbalance = total > 0 ? busiest * nworkers / total : 1;
+        m.slices = std::move(slices);
+        m.bytesRead += fsize - firstData;
+        m.rows = this->rowCount;
+        m.scanSeconds = scanTimer.wallSeconds();
+        m.peakRssBytes = Stopwatch::peakRssBytes();
+    });
+}
 
-        std::ofstream out(merged, std::ios::binary | std::ios::trunc);
-        if (!out) throw std::runtime_error("Failed to open merged output: " + merged.string());
+void TabularData::saveFaultyRows(std::vector<FaultyRow> rows, u64 from) {
+    FaultyRowReport report;
+    if (from > 0 && FaultyRowReport::load(_outputDir, report)) {
+        // keep the entries of the rows indexed before
+        report.rows.erase(std::lower_bound(report.rows.begin(), report.rows.end(), from,
+                                           [](const FaultyRow& r, u64 at) { return r.offset < at; }),
+                          report.rows.end());
+    } else {
+        report.rows.clear();
+    }
+    report.expected = static_cast<u32>(std::max(0, this->colCount));
+    report.rows.insert(report.rows.end(), rows.begin(), rows.end());
+    report.save(_outputDir);
+}
 
-        for (int t = 0; t < NUM_THREADS; ++t) {
-            std::ostringstream oss; oss << pfx.string() << ".part-" << t << ".bin";
-            std::ifstream in(oss.str(), std::ios::binary);
-            if (!in) throw std::runtime_error("Missing part file: " + oss.str());
-            out << in.rdbuf();
-        }
-        out.close();
+void TabularData::write_row_offsets_async(const std::string &path) {
+    // the index isn't touched again until the next findRowOffsets/loadRowOffsets,
+    // both of which flush first
+    const u64 *data = _rowOffsets.data();
+    const size_t n = _rowOffsets.size();
+    _rowOffsetsWrite = std::async(std::launch::async, [path, data, n] {
+        RowOffsetIndex::write(path, data, n);
+    });
+}
+
+void TabularData::flushRowOffsets() {
+    if (_rowOffsetsWrite.valid()) _rowOffsetsWrite.get();
+}
+
+void TabularData::loadRowOffsets() {
+    flushRowOffsets();
+    const fs::path path = fs::path(_outputDir) / "row_offsets.bin";
+    if (!fs::exists(path)) throw std::runtime_error("Failed to open row offsets file: " + path.string());
+    _rowOffsets = RowOffsetIndex(path.string()).decode();
+    this->rowCount = static_cast<u32>(_rowOffsets.size());
+}
+
+// ------------------------------ row access -------------------------------
+
+struct TabularData::RowFetch {
+    RowTokenizer scattered;             // rows one at a time: reads just the row
+    std::vector<size_t> order;          // getRows: batch positions in offset order
+    std::vector<char> copies;           // getRows on an unmapped input: the rows' bytes
+    std::vector<std::pair<size_t,size_t>> spans; // {offset in copies, length}
+
+    RowFetch(const InputSource& src, const Dialect& dialect) : scattered(src, 0, 0, dialect) {}
+};
+
+TabularData::RowFetch& TabularData::rowFetch() const {
+    if (!_fetch) _fetch = std::make_unique<RowFetch>(input(), _dialect);
+    return *_fetch;
+}
 
-        std::error_code ec;
-        for (int t = 0; t < NUM_THREADS; ++t) {
-            std::ostringstream oss; oss << pfx.string() << ".part-" << t << ".bin";
-            fs::remove(oss.str(), ec);
-            ec.clear();
+std::string_view TabularData::getRow(std::uint64_t row) const {
+    if (row >= _rowOffsets.size()) throw std::out_of_range("Row index out of range");
+    const u64 bound = (row + 1 < _rowOffsets.size()) ? _rowOffsets[row + 1] : input().size();
+    return rowFetch().scattered.row(_rowOffsets[row], bound);
+}
+
+std::string_view TabularData::getCell(std::uint64_t row, std::size_t col) const {
+    if (row >= _rowOffsets.size()) throw std::out_of_range("Row index out of range");
+    if (colCount >= 0 && col >= static_cast<size_t>(colCount)) throw std::out_of_range("Column index out of range");
+    const u64 bound = (row + 1 < _rowOffsets.size()) ? _rowOffsets[row + 1] : input().size();
+    std::string_view cell;
+    size_t k = 0;
+    rowFetch().scattered.fields(_rowOffsets[row], bound, static_cast<int>(col) + 1, [&](std::string_view token) {
+        if (k++ == col) cell = token;
+    });
+    return cell;
+}
+
+void TabularData::getRows(const std::uint64_t* rows, std::size_t n, std::vector<std::string_view>& out) const {
+    const InputSource& src = input();
+    RowFetch& f = rowFetch();
+    out.resize(n);
+    f.order.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (rows[i] >= _rowOffsets.size()) throw std::out_of_range("Row index out of range");
+        f.order[i] = i;
+    }
+    std::sort(f.order.begin(), f.order.end(), [&](size_t a, size_t b) { return rows[a] < rows[b]; });
+    if (n == 0) return;
+
+    auto bound_of = [&](u64 row) { return (row + 1 < _rowOffsets.size()) ? _rowOffsets[row + 1] : src.size(); };
+    const u64 first = _rowOffsets[rows[f.order.front()]];
+    const u64 last = bound_of(rows[f.order.back()]);
+    if (src.isMapped()) {
+        // fault the pages in ahead of the walk
+        for (size_t i : f.order) {
+            const u64 at = _rowOffsets[rows[i]];
+            src.adviseWillNeed(at, std::min<u64>(bound_of(rows[i]) - at, 64u << 10));
         }
     }
+    // rows closer together than a window: one tokenizer reading the span in
+    // CHUNK_SIZE windows; sparse ones are read one by one
+    const bool dense = (last - first) / n < CHUNK_SIZE;
+    RowTokenizer spanTokenizer(src, first, dense ? last : first, _dialect);
+    RowTokenizer& tokenizer = dense ? spanTokenizer : f.scattered;
+
+    if (src.isMapped()) {
+        for (size_t i : f.order) out[i] = tokenizer.row(_rowOffsets[rows[i]], bound_of(rows[i]));
+        return;
+    }
+    // unmapped: views die with the window, so keep copies
+    f.copies.clear();
+    f.spans.resize(n);
+    for (size_t i : f.order) {
+        const std::string_view v = tokenizer.row(_rowOffsets[rows[i]], bound_of(rows[i]));
+        f.spans[i] = {f.copies.size(), v.size()};
+        f.copies.insert(f.copies.end(), v.begin(), v.end());
+    }
+    for (size_t i = 0; i < n; ++i) out[i] = std::string_view(f.copies.data() + f.spans[i].first, f.spans[i].second);
+}
+
+TabularData::RowLocation TabularData::rowLocation(std::uint64_t row) const {
+    if (row >= _rowOffsets.size()) throw std::out_of_range("Row index out of range");
+    input();
+    if (!_partitions) return {0, _rowOffsets[row]};
+    const auto [file, offset] = _partitions->locate(_rowOffsets[row]);
+    return {file, offset};
 }
 
 // ======================== column chunk mapping ==========================
 
 struct ColumnChunk {
-    std::string   filePath;
-    uint64_t*     rowOffsets = nullptr;  // invariant: start-of-row offsets
+    const InputSource* source = nullptr;
+    Dialect       dialect;
+    const uint64_t* rowOffsets = nullptr; // invariant: start-of-row offsets (TabularData's index)
     uint64_t*     rowCursor  = nullptr;  // mutable per-row cursor (advances across chunks)
     int           rowCount   = 0;
     int           start      = 0;
     int           end        = 0;        // [start,end)
-    int         **data       = nullptr;  // [ncols][rowCount]
-    std::map<std::string,int> **localMaps = nullptr; // [NUM_THREADS][ncols]
+    int           nthreads   = 1;
+    int           nmorsels   = 1;        // row ranges, pulled by the lanes from a shared counter
+    ThreadPool*   pool       = nullptr;  // runs the nthreads lanes
+    PackedColumn **segments  = nullptr;  // [nmorsels][ncols], rows of morsel m's range
+    Dictionary  **localMaps  = nullptr;  // [nmorsels][ncols]
+    bool          sortedIds  = false;    // global ids in byte order of the values
+    TypedColumn **typed      = nullptr;  // [nmorsels][ncols], columns still typed; type inference only
+    const uint64_t* chunkStart = nullptr; // rowCursor as the chunk began; type inference only
+    const DataProfile* profile = nullptr; // TabularData::profile(), columns by file index; sizing only
+
+    // filled by processColumnChunk, for Metrics
+    std::vector<Metrics::PhaseStats> mapTime; // [lane] tokenizing its morsels, thread time
+    std::vector<uint64_t> mapBytes;           // [lane] bytes tokenized
+    Metrics::PhaseStats mergeTime;            // settling types, merging dictionaries, relabelling
 };
 
-// read up to maxTokensNeeded tokens from a row; advance *currentRowByteOffset
-static std::vector<std::string>
-getTokens(uint64_t* currentRowByteOffset, const std::string& filePath, int maxTokensNeeded) {
-    std::vector<std::string> tokens;
-    if (maxTokensNeeded <= 0) return tokens;
+#ifndef TRANSPOSE_MORSEL_ROWS
+#define TRANSPOSE_MORSEL_ROWS 16384 // rows a transpose morsel has at least, unless a lane would go without
+#endif
+#ifndef TRANSPOSE_MORSELS_PER_THREAD
+#define TRANSPOSE_MORSELS_PER_THREAD 4 // at most this many morsels per lane (each has its own dictionaries)
+#endif
 
-    std::ifstream in(filePath, std::ios::binary);
-    if (!in) throw std::runtime_error("Failed to open CSV file: " + filePath);
+// morsels the rows of a chunk are split into: one per lane at least, so a
+// lane whose rows are slower (long quoted cells, wide text) is overtaken by
+// the others instead of holding up the chunk
+static int transposeMorsels(int rowCount, int nthreads) {
+    if (nthreads <= 1) return 1;
+    const int most = std::min(rowCount, nthreads * TRANSPOSE_MORSELS_PER_THREAD);
+    return std::max(1, std::min(most, std::max(nthreads, rowCount / TRANSPOSE_MORSEL_ROWS)));
+}
 
-    const uint64_t startOff = *currentRowByteOffset;
-    in.seekg(static_cast<std::streamoff>(startOff), std::ios::beg);
-    if (!in) throw std::runtime_error("Failed to seek in CSV file");
+// rows [first, second) of morsel m
+static std::pair<int,int> morselRowRange(const ColumnChunk& chunk, int m) {
+    const auto at = [&](int i) { return static_cast<int>(int64_t(i) * chunk.rowCount / chunk.nmorsels); };
+    return {at(m), at(m + 1)};
+}
 
-    std::vector<char> buffer(CHUNK_SIZE);
-    in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
-    const int bytesRead = static_cast<int>(in.gcount());
-    if (bytesRead <= 0) return tokens;
+// the lanes of chunk.pool, each taking the next morsel until none is left
+template <typename F>
+static void forEachMorsel(const ColumnChunk& chunk, F&& f) {
+    std::atomic<int> next{0};
+    chunk.pool->run(static_cast<unsigned>(std::min(chunk.nthreads, chunk.nmorsels)), [&](unsigned lane) {
+        for (int m; (m = next.fetch_add(1)) < chunk.nmorsels;) f(m, lane);
+    });
+}
 
-    bool inQuotes = false;
-    bool pendingQuote = false;
-    int tokenStart = 0;
-
-    auto push_token = [&](int s, int e) {
-        if (e < s) e = s;
-        std::string tok(buffer.data() + s, e - s);
-        // cheap trim
-        size_t a = 0, b = tok.size();
-        while (a < b && std::isspace((unsigned char)tok[a])) ++a;
-        while (b > a && std::isspace((unsigned char)tok[b-1])) --b;
-        tokens.emplace_back(tok.substr(a, b - a));
-    };
+// a row's bytes end before the next row's start (skipped rows may sit in between)
+static uint64_t rowBound(const ColumnChunk& chunk, int row) {
+    return (row + 1 < chunk.rowCount) ? chunk.rowOffsets[row + 1] : chunk.source->size();
+}
 
-    for (int i = 0; i < bytesRead; ++i) {
-        char c = buffer[i];
+// Dictionary-encode column `col` of rows [first, last) of morsel m's range,
+// re-reading them from the chunk's start cursors
+static void encodeAsStrings(ColumnChunk& chunk, int m, int col, int first, int last) {
+    const int startingRow = morselRowRange(chunk, m).first;
+    PackedColumn& seg = chunk.segments[m][col];
+    Dictionary& map = chunk.localMaps[m][col];
+    for_each_field(*chunk.source, chunk.dialect, chunk.chunkStart + first, static_cast<size_t>(last - first), col,
+                   [&](size_t i) { return rowBound(chunk, first + static_cast<int>(i)); },
+                   [&](size_t i, const std::string_view* token) {
+                       const size_t r = static_cast<size_t>(first - startingRow) + i;
+                       if (token) seg.set(r, map.intern(*token));
+                       else seg.setMissing(r);
+                   });
+}
 
-        if (inQuotes) {
-            if (pendingQuote) {
-                pendingQuote = false;
-                if (c != '"') { inQuotes = false; --i; } // reprocess as unquoted
-                continue;
-            }
-            if (c == '"') { pendingQuote = true; continue; }
-            continue;
-        }
+#ifndef TRANSPOSE_TILE_BYTES
+#define TRANSPOSE_TILE_BYTES (256u<<10) // per-morsel tile of ids buffered before they reach the segments
+#endif
+#ifndef TRANSPOSE_TILE_ROWS
+#define TRANSPOSE_TILE_ROWS 64 // at most this many rows per tile
+#endif
+
+// Each morsel streams its contiguous row range once per column chunk, resuming
+// every row at rowCursor and handing field spans straight to the dictionaries.
+// The ids go into a row-major tile (one arena for up to TRANSPOSE_TILE_ROWS
+// rows of the chunk's columns), and a full tile is flushed column-wise, so a
+// row's cells land in one contiguous tile row instead of ncols separately
+// allocated segments, and each segment takes a run of consecutive rows.
+static void processColumnChunkMap(ColumnChunk& chunk, int morsel, unsigned lane) {
+    const int ncols = chunk.end - chunk.start;
 
-        if (c == '"') { inQuotes = true; pendingQuote = false; continue; }
+    const auto [startingRow, endingRow] = morselRowRange(chunk, morsel);
+    if (startingRow >= endingRow) return;
 
-        if (c == ',') {
-            push_token(tokenStart, i);
-            tokenStart = i + 1;
-            if ((int)tokens.size() == maxTokensNeeded) {
-                *currentRowByteOffset = startOff + tokenStart; // after comma
-                return tokens;
+    const InputSource& src = *chunk.source;
+    RowTokenizer tokenizer(src, chunk.rowCursor[startingRow], rowBound(chunk, endingRow - 1), chunk.dialect);
+    auto* maps = chunk.localMaps[morsel];
+    auto* segs = chunk.segments[morsel];
+    auto* typed = chunk.typed ? chunk.typed[morsel] : nullptr;
+    const size_t rows = static_cast<size_t>(endingRow - startingRow);
+    for (int c = 0; c < ncols; ++c) {
+        if (!chunk.profile) { segs[c].reset(rows); continue; }
+        // size the map and the ids for the values the profile expects, and
+        // don't try types on a column it saw holding text
+        const DataProfile::Column& p = chunk.profile->columns[static_cast<size_t>(chunk.start + c)];
+        if (typed && p.provenString && typed[c].empty() && !typed[c].demoted()) typed[c].demote();
+        const bool strings = !typed || typed[c].demoted() || p.type == ColumnType::String;
+        const size_t expect = strings ? static_cast<size_t>(std::min<uint64_t>(p.distinct, rows)) : 0;
+        maps[c].reserve(expect);
+        segs[c].reset(rows, PackedColumn::widthFor(expect));
+    }
+    const Stopwatch timer(Stopwatch::Cpu::Thread);
+    uint64_t bytes = 0;
+
+    // a typed cell stays kUnset: its column's segment is filled on demotion
+    constexpr uint32_t kUnset = ~0u, kMissingId = ~0u - 1;
+    const size_t tileRows = std::clamp<size_t>(TRANSPOSE_TILE_BYTES / (sizeof(uint32_t) * std::max(1, ncols)),
+                                               1, TRANSPOSE_TILE_ROWS);
+    std::vector<uint32_t> tile(tileRows * static_cast<size_t>(ncols), kUnset);
+    size_t tileFirst = 0; // segment row of tile row 0
+    size_t tileUsed = 0;
+    auto flush_tile = [&]() {
+        // 16 columns (a cache line of ids) at a time down the tile's rows
+        for (int c0 = 0; c0 < ncols; c0 += 16) {
+            const int c1 = std::min(ncols, c0 + 16);
+            for (size_t i = 0; i < tileUsed; ++i) {
+                uint32_t* ids = tile.data() + i * static_cast<size_t>(ncols);
+                for (int c = c0; c < c1; ++c) {
+                    if (ids[c] == kUnset) continue;
+                    if (ids[c] == kMissingId) segs[c].setMissing(tileFirst + i);
+                    else segs[c].set(tileFirst + i, ids[c]);
+                    ids[c] = kUnset;
+                }
             }
-            continue;
         }
+        tileFirst += tileUsed;
+        tileUsed = 0;
+    };
 
-        if (c == '\n' || c == '\r') {
-            push_token(tokenStart, i);
-            uint64_t adv = i + 1;
-            if (c == '\r' && i + 1 < bytesRead && buffer[i + 1] == '\n') ++adv;
-            *currentRowByteOffset = startOff + adv; // next row
-            return tokens;
-        }
-    }
+    for (int row = startingRow; row < endingRow; ++row) {
+        if (tileUsed == tileRows) flush_tile();
+        uint32_t* ids = tile.data() + tileUsed++ * static_cast<size_t>(ncols);
+        int colIndex = 0;
+        const uint64_t cursor = chunk.rowCursor[row];
+        chunk.rowCursor[row] = tokenizer.fields(cursor, rowBound(chunk, row), ncols,
+            [&](std::string_view token) {
+                if (typed && !typed[colIndex].demoted()) {
+                    if (typed[colIndex].append(token)) { ++colIndex; return; }
+                    // not typed after all: dictionary-encode the rows before this one
+                    typed[colIndex].demote();
+                    encodeAsStrings(chunk, morsel, colIndex, startingRow, row);
+                }
 
-    if (!tokens.empty()) {
-        *currentRowByteOffset = startOff + tokenStart;
-    } else {
-        *currentRowByteOffset = startOff + static_cast<uint64_t>(bytesRead);
+                // morsel-local per-column dict
+                ids[colIndex] = maps[colIndex].intern(token);
+                ++colIndex;
+            });
+        bytes += chunk.rowCursor[row] - cursor;
+        // short row: mark the missing cells
+        for (; colIndex < ncols; ++colIndex) {
+            if (typed && !typed[colIndex].demoted()) typed[colIndex].appendMissing();
+            else ids[colIndex] = kMissingId;
+        }
     }
-    return tokens;
+    flush_tile();
+    Metrics::PhaseStats& time = chunk.mapTime[lane];
+    time.wallSeconds += timer.wallSeconds();
+    time.cpuSeconds += timer.cpuSeconds();
+    ++time.calls;
+    chunk.mapBytes[lane] += bytes;
 }
 
-static void processColumnChunkMap(ColumnChunk& chunk, int threadIndex) {
-    const int startingCol = chunk.start;
-    const int endingCol   = chunk.end;
-    const int ncols       = endingCol - startingCol;
+// Re-intern a dictionary's keys in byte order; returns old id -> new id.
+static std::vector<uint32_t> sortDictionary(Dictionary& g) {
+    std::vector<uint32_t> order(g.size());
+    for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return g.key(a) < g.key(b); });
+    Dictionary sorted;
+    sorted.reserve(g.size());
+    std::vector<uint32_t> rank(g.size());
+    for (uint32_t id : order) rank[id] = sorted.intern(g.key(id), g.hashAt(id));
+    g = std::move(sorted);
+    return rank;
+}
 
-    const int rowChunkSize = chunk.rowCount / NUM_THREADS;
-    const int startingRow  = threadIndex * rowChunkSize;
-    const int endingRow    = (threadIndex == NUM_THREADS - 1) ? chunk.rowCount
-                                                              : (threadIndex + 1) * rowChunkSize;
+static void processColumnChunk(ColumnChunk& chunk, uint32_t& outMaxGlobalIdInChunk,
+                               std::vector<Dictionary>& globalDict, std::vector<ColumnType>& types) {
+    const int nthreads = chunk.nthreads;
+    const int nmorsels = chunk.nmorsels;
+    chunk.mapTime.assign(static_cast<size_t>(std::min(nthreads, nmorsels)), Metrics::PhaseStats{});
+    chunk.mapBytes.assign(chunk.mapTime.size(), 0);
+    forEachMorsel(chunk, [&](int m, unsigned lane) { processColumnChunkMap(chunk, m, lane); });
 
-    for (int row = startingRow; row < endingRow; ++row) {
-        int currentCol = startingCol;
+    const Stopwatch merge;
+    const int ncols = chunk.end - chunk.start;
 
-        while (currentCol < endingCol) {
-            auto tokens = getTokens(&chunk.rowCursor[row], chunk.filePath, endingCol - currentCol);
-            if (tokens.empty()) continue; // moved forward; try again
+    // 0) With type inference, settle each column's type across the morsels'
+    //    runs; runs of a column that ends up String are dictionary-encoded.
+    types.assign(static_cast<size_t>(ncols), ColumnType::String);
+    if (chunk.typed) {
+        std::vector<std::vector<int>> redo(nmorsels);
+        for (int c = 0; c < ncols; ++c) {
+            types[c] = settle_column_type(static_cast<size_t>(nmorsels),
+                                          [&](size_t m) -> TypedColumn& { return chunk.typed[m][c]; });
+            if (types[c] != ColumnType::String) continue;
+            for (int m = 0; m < nmorsels; ++m) {
+                if (!chunk.typed[m][c].demoted()) redo[m].push_back(c);
+            }
+        }
+        forEachMorsel(chunk, [&](int m, unsigned) {
+            const auto [first, last] = morselRowRange(chunk, m);
+            for (int c : redo[m]) {
+                chunk.typed[m][c].demote();
+                if (first < last) encodeAsStrings(chunk, m, c, first, last);
+            }
+        });
+    }
 
-            for (const auto& token : tokens) {
-                if (token == "3") {
-                    std::cout << "Found token '3' in row " << row << ", column " << currentCol << std::endl;
-                }
-                const int colIndex = currentCol - startingCol;
-                if (colIndex < 0 || colIndex >= ncols) break;
-
-                // thread-local per-column dict
-                auto& mp = chunk.localMaps[threadIndex][colIndex];
-
-                int localId;
-                auto it = mp.find(token);
-                if (it != mp.end()) localId = it->second;
-                else {
-                    localId = static_cast<int>(mp.size());
-                    mp.emplace(token, localId);
+    // 1) Build global dicts per column and, in the same walk, the per-morsel
+    //    local -> global LUTs. Columns are independent, so the threads take
+    //    them from a shared counter. Stored hashes are reused; no key is rehashed.
+    globalDict.resize(ncols); // may arrive holding the existing values of the columns (refresh)
+    std::vector<std::vector<std::vector<uint32_t>>> remap(nmorsels, std::vector<std::vector<uint32_t>>(ncols));
+    std::atomic<int> nextCol{0};
+    chunk.pool->run(static_cast<unsigned>(nthreads), [&](unsigned) {
+        for (int c; (c = nextCol.fetch_add(1)) < ncols;) {
+            auto& g = globalDict[c];
+            if (chunk.profile && g.size() == 0 && types[c] == ColumnType::String) {
+                g.reserve(static_cast<size_t>(std::min<uint64_t>(chunk.profile->columns[static_cast<size_t>(chunk.start + c)].distinct,
+                                                                 static_cast<uint64_t>(chunk.rowCount))));
+            }
+            for (int m = 0; m < nmorsels; ++m) {
+                const Dictionary& local = chunk.localMaps[m][c];
+                std::vector<uint32_t> lut(local.size());
+                for (uint32_t id = 0; id < local.size(); ++id) {
+                    lut[id] = g.intern(local.key(id), local.hashAt(id));
                 }
-                chunk.data[colIndex][row] = localId;
-                ++currentCol;
-                if (currentCol >= endingCol) break;
+                remap[m][c] = std::move(lut);
+            }
+            if (!chunk.sortedIds) continue;
+            const std::vector<uint32_t> rank = sortDictionary(g);
+            for (int m = 0; m < nmorsels; ++m) {
+                for (auto& id : remap[m][c]) id = rank[id];
             }
         }
-    }
-}
+    });
 
-static void processColumnChunk(ColumnChunk& chunk, uint32_t& outMaxGlobalIdInChunk) {
-    std::thread threads[NUM_THREADS];
-    for (int t = 0; t < NUM_THREADS; ++t)
-        threads[t] = std::thread(processColumnChunkMap, std::ref(chunk), t);
-    for (auto& th : threads) th.join();
+    // 2) Relabel to global ids at the column's final width, morsel by
+    //    morsel from the shared counter again; every segment of a column
+    //    ends up with the same width
+    forEachMorsel(chunk, [&](int m, unsigned) {
+        for (int c = 0; c < ncols; ++c) {
+            if (types[c] != ColumnType::String) continue;
+            chunk.segments[m][c].remap(remap[m][c], PackedColumn::widthFor(globalDict[c].size()));
+        }
+    });
 
-    const int ncols = chunk.end - chunk.start;
+    // 3) chunk max global id: every dictionary entry is used by some cell
+    uint32_t maxId = 0;
+    for (const auto& g : globalDict) {
+        if (g.size() > 0) maxId = std::max(maxId, static_cast<uint32_t>(g.size() - 1));
+    }
+    outMaxGlobalIdInChunk = maxId;
+    chunk.mergeTime = {merge.wallSeconds(), merge.cpuSeconds(), 1};
+}
 
-    // 1) Build global dicts per column
-    std::vector<std::map<std::string,int>> globalDict(ncols);
-    for (int c = 0; c < ncols; ++c) {
-        auto& g = globalDict[c];
-        for (int t = 0; t < NUM_THREADS; ++t) {
-            for (const auto& kv : chunk.localMaps[t][c]) {
-                if (g.find(kv.first) == g.end())
-                    g.emplace(kv.first, static_cast<int>(g.size()));
+// Global dictionaries for the fused columns, in first-occurrence order like
+// processColumnChunk's; walking the cells skips keys only a discarded
+// (re-parsed) morsel interned. Segments end up as global ids.
+void TabularData::FusedScan::merge(const InputSource& src, const std::vector<u64>& rowOffsets, ThreadPool& pool, unsigned nthreads,
+                                   bool sortedIds, std::vector<Dictionary>& globalDict, std::vector<ColumnType>& types,
+                                   uint32_t& outMaxGlobalIdInChunk) {
+    const size_t ncols = static_cast<size_t>(this->ncols);
+    globalDict.clear();
+    globalDict.resize(ncols);
+    types.assign(ncols, ColumnType::String);
+
+    std::atomic<size_t> nextCol{0};
+    pool.run(std::max(1u, std::min<unsigned>(nthreads, static_cast<unsigned>(ncols))), [&](unsigned) {
+        for (size_t c; (c = nextCol.fetch_add(1)) < ncols;) {
+            if (inferTypes) {
+                types[c] = settle_column_type(segs.size(), [&](size_t m) -> TypedColumn& { return typed[m][c]; });
+                if (types[c] != ColumnType::String) continue;
+                // a String column: encode the morsels that still held it typed
+                for (size_t m = 0; m < segs.size(); ++m) {
+                    if (typed[m][c].demoted()) continue;
+                    typed[m][c].demote();
+                    PackedColumn& seg = segs[m][c];
+                    Dictionary& local = dicts[owner[m]][c];
+                    for_each_field(src, dialect, rowOffsets.data() + firstRow[m], firstRow[m + 1] - firstRow[m], static_cast<int>(c),
+                                   [&](size_t i) {
+                                       const size_t row = firstRow[m] + i + 1;
+                                       return row < rowOffsets.size() ? rowOffsets[row] : src.size();
+                                   },
+                                   [&](size_t, const std::string_view* token) {
+                                       if (token) seg.append(local.intern(*token));
+                                       else seg.appendMissing();
+                                   });
+                }
             }
+            Dictionary& g = globalDict[c];
+            std::vector<std::vector<uint32_t>> lut(dicts.size());
+            for (size_t w = 0; w < lut.size(); ++w) lut[w].assign(dicts[w][c].size(), UINT32_MAX);
+
+            for (size_t m = 0; m < segs.size(); ++m) {
+                const PackedColumn& seg = segs[m][c];
+                const Dictionary& local = dicts[owner[m]][c];
+                auto& map = lut[owner[m]];
+                for (size_t r = 0; r < seg.size(); ++r) {
+                    const std::int64_t id = seg.get(r);
+                    if (id >= 0 && map[id] == UINT32_MAX) map[id] = g.intern(local.key(id), local.hashAt(id));
+                }
+            }
+            if (sortedIds) {
+                const std::vector<uint32_t> rank = sortDictionary(g);
+                for (auto& map : lut) {
+                    for (auto& id : map) if (id != UINT32_MAX) id = rank[id];
+                }
+            }
+            const uint32_t width = PackedColumn::widthFor(g.size());
+            for (size_t m = 0; m < segs.size(); ++m) segs[m][c].remap(lut[owner[m]], width);
         }
+    });
+
+    uint32_t maxId = 0;
+    for (const auto& g : globalDict) {
+        if (g.size() > 0) maxId = std::max(maxId, static_cast<uint32_t>(g.size() - 1));
     }
+    outMaxGlobalIdInChunk = maxId;
+}
 
-    // 2) Per-thread remap LUT: local -> global
-    std::vector<std::vector<std::vector<int>>> remap(NUM_THREADS);
-    for (int t = 0; t < NUM_THREADS; ++t) {
-        remap[t].resize(ncols);
+// heap bytes a processed chunk holds: segments, local and global dictionaries,
+// plus the remap tables processColumnChunk already released
+static size_t chunkMemoryBytes(const ColumnChunk& chunk, const std::vector<Dictionary>& globalDict) {
+    size_t bytes = 0;
+    const int ncols = chunk.end - chunk.start;
+    for (int m = 0; m < chunk.nmorsels; ++m) {
         for (int c = 0; c < ncols; ++c) {
-            const auto& local = chunk.localMaps[t][c];
-            auto&       g     = globalDict[c];
-            std::vector<int> lut(local.size(), -1);
-            for (const auto& kv : local) {
-                lut[kv.second] = g.at(kv.first);
-            }
-            remap[t][c] = std::move(lut);
+            bytes += chunk.segments[m][c].bytes() + chunk.localMaps[m][c].memoryBytes()
+                   + chunk.localMaps[m][c].size() * sizeof(uint32_t);
+            if (chunk.typed) bytes += chunk.typed[m][c].bytes();
         }
     }
+    for (const auto& g : globalDict) bytes += g.memoryBytes();
+    return bytes;
+}
 
-    // 3) Relabel to global ids
-    uint32_t maxId = 0;
-    const int rowChunkSize = chunk.rowCount / NUM_THREADS;
-    for (int t = 0; t < NUM_THREADS; ++t) {
-        const int srow = t * rowChunkSize;
-        const int erow = (t == NUM_THREADS - 1) ? chunk.rowCount : (t + 1) * rowChunkSize;
-        for (int c = 0; c < ncols; ++c) {
-            int* colData = chunk.data[c];
-            const auto& lut = remap[t][c];
-            for (int r = srow; r < erow; ++r) {
-                int localId = colData[r];
-                if (localId >= 0 && localId < (int)lut.size()) colData[r] = lut[localId];
-                else colData[r] = -1;
-                if (colData[r] > maxId) {
-                    maxId = colData[r];
-                    std::cout << "New maxId found: " << maxId << std::endl;
-                }
-            }
+// Adds a written chunk to m: its entry (with the dictionaries of its String
+// columns and the memory it held) and, unless fused, its tokenize / merge time
+static void recordChunk(Metrics& m, const ColumnChunk* chunk, size_t memoryBytes, uint32_t firstCol, uint32_t ncols,
+                        const std::vector<Dictionary>& globalDict, const std::vector<ColumnType>& types,
+                        const Stopwatch& timer, const Stopwatch& write) {
+    Metrics::Chunk c;
+    c.firstCol = firstCol;
+    c.ncols = ncols;
+    c.memoryBytes = memoryBytes;
+    for (size_t i = 0; i < globalDict.size(); ++i) {
+        if (types[i] != ColumnType::String) continue;
+        c.dictionaryEntries += globalDict[i].size();
+        c.dictionaryBytes += globalDict[i].memoryBytes();
+        m.largestDictionary = std::max<uint64_t>(m.largestDictionary, globalDict[i].size());
+    }
+    if (chunk) {
+        double busiest = 0, total = 0;
+        for (size_t t = 0; t < chunk->mapTime.size(); ++t) {
+            m.addPhase(Phase::TransposeChunk, chunk->mapTime[t]);
+            busiest = std::max(busiest, chunk->mapTime[t].wallSeconds);
+            total += chunk->mapTime[t].wallSeconds;
+            c.bytes += chunk->mapBytes[t];
         }
+        if (total > 0) c.imbalance = busiest * double(chunk->mapTime.size()) / total;
+        m.addPhase(Phase::DictionaryMerge, chunk->mergeTime);
     }
+    m.addPhase(Phase::Write, write.wallSeconds(), write.cpuSeconds());
+    c.seconds = timer.wallSeconds();
+    m.bytesRead += c.bytes;
+    m.dictionaryEntries += c.dictionaryEntries;
+    m.dictionaryBytes += c.dictionaryBytes;
+    m.peakChunkBytes = std::max<uint64_t>(m.peakChunkBytes, c.memoryBytes);
+    m.chunks.push_back(c);
+}
 
-    // 4) compute chunk max global id
-    // uint32_t maxId = 0;
-    // bool any = false;
-
-    // for (int c = 0; c < ncols; ++c) {
-    //     int* colData = chunk.data[c];
-    //     for (int r = 0; r < chunk.rowCount; ++r) {
-    //         int v = colData[r];
-    //         if (v >= 0) {           // ignore our sentinel -1
-    //             if (!any || (uint32_t)v > maxId) {
-    //                 maxId = (uint32_t)v;
-    //                 any = true;
-    //             }
-    //         }
-    //     }
-    // }
+// --------------------------- mapIntTranspose ----------------------------
 
-    outMaxGlobalIdInChunk = maxId;
+// column_chunk_meta.bin: {ncols, maxGlobalIdInChunk} per chunk, appended as
+// each chunk is written
+static void appendChunkMeta(const fs::path& metaPath, int ncols, uint32_t maxGlobalIdInChunk) {
+    std::ofstream meta(metaPath, std::ios::binary | std::ios::app);
+    if (!meta) throw std::runtime_error("Failed to open column_chunk_meta.bin for append");
+    uint32_t ncols_u32 = static_cast<uint32_t>(ncols);
+    meta.write(reinterpret_cast<const char*>(&ncols_u32), sizeof(uint32_t));
+    meta.write(reinterpret_cast<const char*>(&maxGlobalIdInChunk), sizeof(uint32_t));
+    meta.flush();
 }
 
-// --------------------------- mapIntTranspose ----------------------------
+void TabularData::mapIntTranspose() { transposeFrom(nullptr); }
 
-void TabularData::mapIntTranspose() {
+void TabularData::transposeFrom(FusedScan *fused) {
+    const Stopwatch transposeTimer;
+    updateMetrics([](Metrics& m) {
+        m.chunks.clear();
+        m.dictionaryEntries = m.dictionaryBytes = m.largestDictionary = m.peakChunkBytes = 0;
+    });
     // read row offsets
     ColumnChunk chunk;
-    chunk.filePath = _csvPath;
+    chunk.source = &input();
+    chunk.dialect = _dialect;
     chunk.rowCount = static_cast<int>(this->rowCount);
-    chunk.rowOffsets = new uint64_t[this->rowCount];
-    chunk.rowCursor  = new uint64_t[this->rowCount];
-
-    {
-        std::ifstream offs((fs::path(_outputDir) / "row_offsets.bin").string(), std::ios::binary);
-        if (!offs) throw std::runtime_error("Failed to open row offsets file");
-        offs.read(reinterpret_cast<char*>(chunk.rowOffsets), this->rowCount * sizeof(uint64_t));
-        offs.close();
-    }
-    // initialize rowCursor to the beginning of each row
-    std::memcpy(chunk.rowCursor, chunk.rowOffsets, this->rowCount * sizeof(uint64_t));
+    // at least one row per thread
+    chunk.nthreads = static_cast<int>(std::max(1u, std::min(threadCount(), std::max(1u, this->rowCount))));
+    chunk.nmorsels = transposeMorsels(chunk.rowCount, chunk.nthreads);
+    chunk.pool = &threadPool();
+    if (_profile && _profile->columns.size() == static_cast<size_t>(colCount)) chunk.profile = _profile.get();
+    if (_rowOffsets.size() != this->rowCount) throw std::runtime_error("Row offsets not available. Run findRowOffsets() first.");
+    chunk.rowOffsets = _rowOffsets.data();
+    chunk.sortedIds  = _sortedDictionaries;
+
+    // initialize rowCursor to the beginning of each row, or past the fused columns
+    const int firstCol = fused ? fused->ncols : 0;
+    const uint64_t* cursorInit = (fused && fused->keepCursors) ? fused->rowCursor.data() : chunk.rowOffsets;
+    std::vector<uint64_t> rowCursor(cursorInit, cursorInit + this->rowCount);
+    chunk.rowCursor = rowCursor.data();
+
+    IndexState::remove(_outputDir);
 
     // prepare meta file path
     const fs::path metaPath = fs::path(_outputDir) / "column_chunk_meta.bin";
     // truncate once at the beginning (fresh run)
     { std::ofstream(metaPath, std::ios::binary | std::ios::trunc).close(); }
 
-    for (int col = 0; col < static_cast<int>(colCount); col += COLUMNS_PER_CHUNK) {
-        std::cout << "Processing column chunk starting at column: " << col << std::endl;
-        chunk.start = col;
-        chunk.end   = std::min(col + COLUMNS_PER_CHUNK, static_cast<int>(colCount));
-        const int ncols = chunk.end - chunk.start;
+    // encoded columns + dictionaries, see ColumnStore.hpp for the layout
+    ColumnStoreWriter store((fs::path(_outputDir) / "columns").string(), this->rowCount, colCount);
 
-        // allocate matrix [ncols][rowCount]
-        chunk.data = new int*[ncols];
-        for (int c = 0; c < ncols; ++c) {
-            chunk.data[c] = new int[this->rowCount];
-            // Optional initialize:
-            // std::fill(chunk.data[c], chunk.data[c] + this->rowCount, -1);
+    if (fused && fused->ncols > 0) {
+        // the first chunk was encoded during the scan
+        const Stopwatch timer;
+        uint32_t maxGlobalIdInChunk = 0;
+        std::vector<Dictionary> globalDict;
+        std::vector<ColumnType> types;
+        fused->merge(*chunk.source, _rowOffsets, threadPool(), threadCount(), _sortedDictionaries, globalDict, types,
+                     maxGlobalIdInChunk);
+        const double mergeWall = timer.wallSeconds(), mergeCpu = timer.cpuSeconds();
+        size_t memoryBytes = 0;
+        for (const auto& g : globalDict) memoryBytes += g.memoryBytes();
+        for (const auto& run : fused->segs) for (const auto& seg : run) memoryBytes += seg.bytes();
+        for (const auto& run : fused->typed) for (const auto& col : run) memoryBytes += col.bytes();
+        for (const auto& worker : fused->dicts) for (const auto& d : worker) memoryBytes += d.memoryBytes();
+
+        const Stopwatch write;
+        std::vector<PackedColumn*> segments;
+        for (auto& seg : fused->segs) segments.push_back(seg.data());
+        std::vector<TypedColumn*> typed;
+        for (auto& run : fused->typed) typed.push_back(run.data());
+        store.writeChunk(0, static_cast<uint32_t>(fused->ncols), segments.data(),
+                         static_cast<int>(segments.size()), globalDict,
+                         fused->inferTypes ? typed.data() : nullptr, &types);
+        appendChunkMeta(metaPath, fused->ncols, maxGlobalIdInChunk);
+        updateMetrics([&](Metrics& m) {
+            m.addPhase(Phase::DictionaryMerge, mergeWall, mergeCpu);
+            recordChunk(m, nullptr, memoryBytes, 0, static_cast<uint32_t>(fused->ncols), globalDict, types,
+                        timer, write);
+        });
+        fused->segs.clear();
+        fused->dicts.clear();
+        fused->typed.clear();
+        fused->rowCursor.clear();
+    }
+
+    // with a memory budget, chunks are sized from sampled rows and each
+    // chunk's measured footprint; otherwise COLUMNS_PER_CHUNK apiece
+    std::unique_ptr<ChunkPlanner> planner;
+    if (_memoryBudget > 0 && firstCol < static_cast<int>(colCount)) {
+        const size_t n = std::min<size_t>(ChunkPlanner::sampleRows(colCount - firstCol), this->rowCount);
+        std::vector<std::pair<uint64_t,uint64_t>> samples;
+        for (size_t i = 0; i < n; ++i) {
+            const size_t row = i * this->rowCount / n;
+            const uint64_t bound = (row + 1 < this->rowCount) ? chunk.rowOffsets[row + 1] : chunk.source->size();
+            samples.emplace_back(chunk.rowCursor[row], bound);
         }
+        planner = std::make_unique<ChunkPlanner>(*chunk.source, _dialect, _memoryBudget, firstCol, static_cast<int>(colCount),
+                                                 this->rowCount, chunk.nmorsels, samples);
+    }
 
-        // per-thread / per-column maps
-        chunk.localMaps = new std::map<std::string,int>*[NUM_THREADS];
-        for (int t = 0; t < NUM_THREADS; ++t) {
-            chunk.localMaps[t] = new std::map<std::string,int>[ncols];
+    for (int col = firstCol, ncols = 0; col < static_cast<int>(colCount); col += ncols) {
+        ncols = planner ? planner->next(col) : std::min(COLUMNS_PER_CHUNK, static_cast<int>(colCount) - col);
+        const Stopwatch timer;
+        chunk.start = col;
+        chunk.end   = col + ncols;
+
+        // per-morsel / per-column id segments and maps
+        std::vector<std::vector<PackedColumn>> segs(chunk.nmorsels, std::vector<PackedColumn>(ncols));
+        std::vector<std::vector<Dictionary>> localMaps(chunk.nmorsels);
+        for (auto& m : localMaps) m.resize(ncols);
+        std::vector<std::vector<TypedColumn>> typed(_inferTypes ? chunk.nmorsels : 0, std::vector<TypedColumn>(ncols));
+
+        std::vector<PackedColumn*> segments;
+        std::vector<Dictionary*> maps;
+        std::vector<TypedColumn*> runs;
+        for (auto& s : segs) segments.push_back(s.data());
+        for (auto& m : localMaps) maps.push_back(m.data());
+        for (auto& r : typed) runs.push_back(r.data());
+        chunk.segments  = segments.data();
+        chunk.localMaps = maps.data();
+        std::vector<uint64_t> chunkStart;
+        chunk.typed = nullptr;
+        if (_inferTypes) {
+            chunk.typed = runs.data();
+            // columns that turn out not to be typed are re-read from here
+            chunkStart = rowCursor;
+            chunk.chunkStart = chunkStart.data();
         }
 
         // run threads + merge/relabel
         uint32_t maxGlobalIdInChunk = 0;
-        processColumnChunk(chunk, maxGlobalIdInChunk);
+        std::vector<Dictionary> globalDict;
+        std::vector<ColumnType> types;
+        processColumnChunk(chunk, maxGlobalIdInChunk, globalDict, types);
+        const Stopwatch write;
+        store.writeChunk(static_cast<uint32_t>(chunk.start), static_cast<uint32_t>(ncols),
+                         chunk.segments, chunk.nmorsels, globalDict, chunk.typed, &types);
+        appendChunkMeta(metaPath, ncols, maxGlobalIdInChunk);
+        const size_t memoryBytes = chunkMemoryBytes(chunk, globalDict);
+        if (planner) planner->observe(memoryBytes);
+        updateMetrics([&](Metrics& m) {
+            recordChunk(m, &chunk, memoryBytes, static_cast<uint32_t>(col), static_cast<uint32_t>(ncols),
+                        globalDict, types, timer, write);
+        });
+    }
 
-        // append meta immediately: {ncols, maxGlobalIdInChunk}
-        {
-            std::ofstream meta(metaPath, std::ios::binary | std::ios::app);
-            if (!meta) throw std::runtime_error("Failed to open column_chunk_meta.bin for append");
-            uint32_t ncols_u32 = static_cast<uint32_t>(ncols);
-            meta.write(reinterpret_cast<const char*>(&ncols_u32), sizeof(uint32_t));
-            meta.write(reinterpret_cast<const char*>(&maxGlobalIdInChunk), sizeof(uint32_t));
-            meta.flush();
-        }
+    store.finish();
+    saveIndexState();
+    updateMetrics([&](Metrics& m) {
+        m.transposeSeconds = transposeTimer.wallSeconds();
+        m.peakRssBytes = Stopwatch::peakRssBytes();
+    });
+}
+
+void TabularData::saveIndexState() {
+    flushRowOffsets(); // the state vouches for row_offsets.bin too
+    u32 flags = (_inferTypes ? IndexState::kInferTypes : 0) | (_sortedDictionaries ? IndexState::kSortedIds : 0);
+    if (ends_at_row_start(input(), _rowOffsets.empty() ? 0 : _rowOffsets.back(), _dialect)) flags |= IndexState::kEndsAtRow;
+    IndexState::capture(input(), this->rowCount, static_cast<u32>(colCount), flags, _dialect).save(_outputDir);
+}
+
+// --------------------------- incremental refresh ---------------------------
+
+bool TabularData::refresh() {
+    flushRowOffsets();
+    _fetch.reset();
+    _input.reset(); // a mapping or size taken before the file grew
+    _partitions.reset();
+    _profile.reset();
+    IndexState state;
+    const u32 flags = (_inferTypes ? IndexState::kInferTypes : 0) | (_sortedDictionaries ? IndexState::kSortedIds : 0);
+    const bool usable = IndexState::load(_outputDir, state)
+                     && (state.flags & ~IndexState::kEndsAtRow) == flags
+                     && state.dialect == _dialect.pack()
+                     && (state.fileBytes == input().size() || (state.flags & IndexState::kEndsAtRow))
+                     && state.prefixOf(input())
+                     && fs::exists(fs::path(_outputDir) / "row_offsets.bin");
+    if (!usable) {
+        scanAndTranspose();
+        return false;
+    }
 
-        // free per-chunk buffers
-        for (int c = 0; c < ncols; ++c) delete[] chunk.data[c];
-        delete[] chunk.data;      chunk.data = nullptr;
+    parseHeaderRow();
+    loadRowOffsets();
+    if (static_cast<u32>(colCount) != state.colCount || _rowOffsets.size() != state.rowCount) {
+        scanAndTranspose();
+        return false;
+    }
+    if (state.fileBytes == input().size()) return true; // nothing appended
 
-        for (int t = 0; t < NUM_THREADS; ++t) delete[] chunk.localMaps[t];
-        delete[] chunk.localMaps; chunk.localMaps = nullptr;
+    const size_t firstNewRow = _rowOffsets.size();
+    scanRows(nullptr, state.fileBytes);
+    IndexState::remove(_outputDir); // until the columns are extended too
+    if (_rowOffsets.size() > firstNewRow && !transposeAppended(firstNewRow)) {
+        scanAndTranspose();
+        return false;
     }
+    saveIndexState();
+    return true;
+}
+
+bool TabularData::transposeAppended(size_t firstNewRow) {
+    // the new rows are appended to the chunk files and committed by the
+    // manifest once every chunk is extended, so a typed column that can't
+    // hold the new values (or an error) leaves the existing store as it was
+    const ColumnStore existing(_outputDir);
+    if (existing.rowCount() != firstNewRow || existing.columnCount() != static_cast<u32>(colCount)) return false;
+
+    const int newRows = static_cast<int>(this->rowCount - firstNewRow);
+    ColumnChunk chunk;
+    chunk.source = &input();
+    chunk.dialect = _dialect;
+    chunk.rowCount = newRows;
+    chunk.nthreads = static_cast<int>(std::max(1u, std::min(threadCount(), static_cast<unsigned>(newRows))));
+    chunk.nmorsels = transposeMorsels(newRows, chunk.nthreads);
+    chunk.pool = &threadPool();
+    chunk.rowOffsets = _rowOffsets.data() + firstNewRow;
+    std::vector<uint64_t> rowCursor(chunk.rowOffsets, chunk.rowOffsets + newRows);
+    chunk.rowCursor = rowCursor.data();
+    chunk.sortedIds = false; // the extended dictionaries are sorted below, old ids included
+
+    const fs::path outDir(_outputDir);
+    const fs::path metaPath = outDir / "column_chunk_meta.bin.new";
+    { std::ofstream(metaPath, std::ios::binary | std::ios::trunc).close(); }
+    ColumnStoreWriter store((outDir / "columns").string(), existing, this->rowCount);
+    using Extension = ColumnStoreWriter::Extension;
+
+    const Stopwatch transposeTimer;
+    updateMetrics([](Metrics& m) {
+        m.chunks.clear();
+        m.dictionaryEntries = m.dictionaryBytes = m.largestDictionary = m.peakChunkBytes = 0;
+    });
+    for (u32 k = 0; k < existing.chunkCount(); ++k) {
+        const auto [firstCol, ncolsU] = existing.chunkColumns(k);
+        const Stopwatch timer;
+        const int ncols = static_cast<int>(ncolsU);
+        chunk.start = static_cast<int>(firstCol);
+        chunk.end   = chunk.start + ncols;
+
+        // segment 0 holds the existing rows of a column that's rewritten,
+        // 1.. the morsels' new ones
+        std::vector<std::vector<PackedColumn>> segs(chunk.nmorsels + 1, std::vector<PackedColumn>(ncols));
+        std::vector<std::vector<Dictionary>> localMaps(chunk.nmorsels);
+        for (auto& m : localMaps) m.resize(ncols);
+        std::vector<std::vector<TypedColumn>> typed(chunk.nmorsels + 1, std::vector<TypedColumn>(ncols));
+        std::vector<Dictionary> globalDict(ncols);
+        std::vector<ColumnType> oldTypes(ncols);
+        for (int c = 0; c < ncols; ++c) {
+            const ColumnStore::Column col = existing.column(firstCol + static_cast<u32>(c));
+            oldTypes[c] = col.type();
+            if (oldTypes[c] == ColumnType::String) ColumnStoreWriter::loadDictionary(col, globalDict[c]);
+        }
+
+        std::vector<PackedColumn*> segments;
+        std::vector<Dictionary*> maps;
+        std::vector<TypedColumn*> runs;
+        for (auto& s : segs) segments.push_back(s.data());
+        for (auto& m : localMaps) maps.push_back(m.data());
+        for (auto& r : typed) runs.push_back(r.data());
+        chunk.segments  = segments.data() + 1;
+        chunk.localMaps = maps.data();
+        std::vector<uint64_t> chunkStart;
+        chunk.typed = nullptr;
+        if (_inferTypes) {
+            // new values continue a column as its existing type
+            for (int t = 1; t <= chunk.nmorsels; ++t) {
+                for (int c = 0; c < ncols; ++c) {
+                    if (oldTypes[c] == ColumnType::String) typed[t][c].demote();
+                    else typed[t][c].convertTo(oldTypes[c]);
+                }
+            }
+            chunk.typed = runs.data() + 1;
+            chunkStart = rowCursor;
+            chunk.chunkStart = chunkStart.data();
+        }
 
-    delete[] chunk.rowOffsets; chunk.rowOffsets = nullptr;
-    delete[] chunk.rowCursor;  chunk.rowCursor  = nullptr;
+        uint32_t maxGlobalIdInChunk = 0;
+        std::vector<ColumnType> types;
+        processColumnChunk(chunk, maxGlobalIdInChunk, globalDict, types);
+        // a column is only rewritten when its ids change: wider, or
+        // reordered because a new value sorts before an existing one
+        std::vector<Extension> extensions(ncols, Extension::Append);
+        for (int c = 0; c < ncols; ++c) {
+            if (types[c] != oldTypes[c]) {
+                std::error_code ec;
+                fs::remove(metaPath, ec);
+                return false;
+            }
+            if (types[c] != ColumnType::String) continue;
+            const ColumnStore::Column col = existing.column(firstCol + static_cast<u32>(c));
+            const uint64_t oldCount = col.dictionarySize();
+            const uint32_t width = PackedColumn::widthFor(globalDict[c].size());
+            if (_sortedDictionaries && globalDict[c].size() > oldCount) {
+                const std::vector<uint32_t> rank = sortDictionary(globalDict[c]);
+                for (size_t t = 1; t < segs.size(); ++t) segs[t][c].remap(rank, width);
+                uint64_t kept = 0;
+                while (kept < oldCount && rank[kept] == kept) ++kept;
+                if (kept < oldCount) {
+                    extensions[c] = Extension::Rewrite;
+                    ColumnStoreWriter::loadIds(col, segs[0][c]);
+                    segs[0][c].remap(rank, width);
+                    continue;
+                }
+            }
+            if (width != col.width()) {
+                extensions[c] = Extension::RewriteIds;
+                ColumnStoreWriter::loadIds(col, segs[0][c]);
+                segs[0][c].widen(width);
+            }
+        }
+        const Stopwatch write;
+        store.appendChunk(segments.data(), static_cast<int>(segments.size()), globalDict, extensions,
+                          _inferTypes ? runs.data() : nullptr, &types);
+        appendChunkMeta(metaPath, ncols, maxGlobalIdInChunk);
+        const size_t memoryBytes = chunkMemoryBytes(chunk, globalDict);
+        updateMetrics([&](Metrics& m) {
+            recordChunk(m, &chunk, memoryBytes, firstCol, ncolsU, globalDict, types, timer, write);
+        });
+    }
+    store.finish();
+    fs::rename(metaPath, outDir / "column_chunk_meta.bin");
+    updateMetrics([&](Metrics& m) {
+        m.transposeSeconds = transposeTimer.wallSeconds();
+        m.peakRssBytes = Stopwatch::peakRssBytes();
+    });
+    return true;
 }
 
 } // namespace tabular
@@ -0,0 +1,167 @@
+#include "TabularData/ThreadPool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#define TABULAR_HAVE_AFFINITY 1
+#endif
+
+namespace fs = std::filesystem;
+
+namespace tabular {
+
+namespace {
+
+#ifdef TABULAR_HAVE_AFFINITY
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::istringstream in(list);
+    for (std::string range; std::getline(in, range, ',');) {
+        if (range.empty() || !std::isdigit(static_cast<unsigned char>(range[0]))) continue;
+        const std::size_t dash = range.find('-');
+        const int lo = std::stoi(range.substr(0, dash));
+        const int hi = dash == std::string::npos ? lo : std::stoi(range.substr(dash + 1));
+        for (int c = lo; c <= hi; ++c) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+// The CPUs this process may run on, one from each NUMA node in turn.
+std::vector<int> numa_cpu_order() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return {};
+
+    std::vector<std::vector<int>> nodes;
+    std::error_code ec;
+    std::vector<fs::path> dirs;
+    for (const auto& entry : fs::directory_iterator("/sys/devices/system/node", ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0 && std::isdigit(static_cast<unsigned char>(name[4]))) {
+            dirs.push_back(entry.path());
+        }
+    }
+    std::sort(dirs.begin(), dirs.end());
+    for (const fs::path& dir : dirs) {
+        std::ifstream in(dir / "cpulist");
+        std::string list;
+        std::getline(in, list);
+        std::vector<int> cpus;
+        for (int c : parse_cpu_list(list)) {
+            if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        }
+        if (!cpus.empty()) nodes.push_back(std::move(cpus));
+    }
+    if (nodes.empty()) { // no NUMA topology exposed: one node
+        nodes.emplace_back();
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &allowed)) nodes.back().push_back(c);
+        }
+    }
+
+    std::vector<int> order;
+    for (std::size_t i = 0; order.size() < CPU_SETSIZE; ++i) {
+        bool any = false;
+        for (const auto& node : nodes) {
+            if (i < node.size()) { order.push_back(node[i]); any = true; }
+        }
+        if (!any) break;
+    }
+    return order;
+}
+
+void pin_thread(std::thread& t, int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(t.native_handle(), sizeof(set), &set); // best effort
+}
+#endif
+
+} // end anon
+
+struct ThreadPool::Batch {
+    const std::function<void(unsigned)>* fn = nullptr;
+    unsigned lanes = 0;
+    unsigned next = 0; // under _mu, like left
+    unsigned left = 0;
+    std::vector<std::exception_ptr> errors; // [lane]
+    std::condition_variable done;
+};
+
+ThreadPool::ThreadPool(unsigned threads, bool pinned) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    threads = std::max(1u, threads);
+    _workers.reserve(threads - 1);
+    for (unsigned i = 0; i + 1 < threads; ++i) _workers.emplace_back([this] { loop(); });
+#ifdef TABULAR_HAVE_AFFINITY
+    if (pinned) {
+        const std::vector<int> cpus = numa_cpu_order();
+        for (std::size_t i = 0; i < _workers.size() && !cpus.empty(); ++i) pin_thread(_workers[i], cpus[i % cpus.size()]);
+    }
+#else
+    (void)pinned;
+#endif
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mu);
+        _stop = true;
+    }
+    _cv.notify_all();
+    for (auto& t : _workers) t.join();
+}
+
+void ThreadPool::loop() {
+    std::unique_lock<std::mutex> lock(_mu);
+    for (;;) {
+        _cv.wait(lock, [this] { return _stop || !_batches.empty(); });
+        if (_batches.empty()) return;
+        const std::shared_ptr<Batch> b = _batches.front(); // alive until its lane is done
+        runLane(*b, lock);
+    }
+}
+
+bool ThreadPool::runLane(Batch& b, std::unique_lock<std::mutex>& lock) {
+    if (b.next == b.lanes) return false;
+    const unsigned lane = b.next++;
+    if (b.next == b.lanes) {
+        _batches.erase(std::find_if(_batches.begin(), _batches.end(),
+                                    [&](const std::shared_ptr<Batch>& p) { return p.get() == &b; }));
+    }
+    lock.unlock();
+    try { (*b.fn)(lane); } catch (...) { b.errors[lane] = std::current_exception(); }
+    lock.lock();
+    if (--b.left == 0) b.done.notify_all();
+    return true;
+}
+
+void ThreadPool::run(unsigned lanes, const std::function<void(unsigned)>& fn) {
+    if (lanes == 0) return;
+    if (lanes == 1) { fn(0); return; }
+
+    const auto b = std::make_shared<Batch>();
+    b->fn = &fn;
+    b->lanes = b->left = lanes;
+    b->errors.resize(lanes);
+
+    std::unique_lock<std::mutex> lock(_mu);
+    _batches.push_back(b);
+    if (lanes - 1 >= _workers.size()) _cv.notify_all();
+    else for (unsigned i = 0; i + 1 < lanes; ++i) _cv.notify_one();
+    while (runLane(*b, lock)) {}
+    b->done.wait(lock, [&] { return b->left == 0; });
+    lock.unlock();
+    for (auto& e : b->errors) if (e) std::rethrow_exception(e);
+}
+
+} // namespace tabular
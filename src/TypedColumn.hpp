@@ -0,0 +1,195 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "TabularData/ColumnStore.hpp"
+
+namespace tabular {
+
+// Parsed cells of one column over a run of rows, kept while every token so
+// far was a value of one native type, or the empty string (missing). Cells
+// are 64-bit in memory (bools and dates widened, missing as the type's
+// marker) and narrowed when written. append() returns false on the first
+// token that doesn't fit; the caller then dictionary-encodes the run.
+class TypedColumn {
+public:
+    using u64 = std::uint64_t;
+
+    static constexpr std::int64_t kMissingInt = std::numeric_limits<std::int64_t>::min();
+    static constexpr u64 kMissingFloatBits = 0x7FF8000000000000ull; // quiet NaN; parsed values are finite
+
+    // true until a non-empty token arrives
+    bool empty() const { return !_typed; }
+    bool demoted() const { return _demoted; }
+    // type of the values so far; meaningful once !empty()
+    ColumnType type() const { return _type; }
+    std::size_t size() const { return _cells.size(); }
+    std::size_t bytes() const { return _cells.capacity() * sizeof(u64); }
+    u64 bits(std::size_t row) const { return _cells[row]; }
+
+    bool append(std::string_view token) {
+        if (token.empty()) { appendMissing(); return true; }
+        ColumnType kind;
+        u64 v;
+        if (!parse(token, _typed ? _type : ColumnType::Int64, kind, v)) return false;
+        if (!_typed) {
+            _typed = true;
+            _type = kind;
+            fillMissing();
+        } else if (kind != _type) {
+            if (_type == ColumnType::Int64 && kind == ColumnType::Float64) {
+                if (!convertTo(ColumnType::Float64)) return false;
+            } else if (_type == ColumnType::Float64 && kind == ColumnType::Int64) {
+                if (!exactAsDouble(static_cast<std::int64_t>(v))) return false;
+                v = doubleBits(static_cast<double>(static_cast<std::int64_t>(v)));
+            } else {
+                return false;
+            }
+        }
+        _cells.push_back(v);
+        return true;
+    }
+
+    void appendMissing() { _cells.push_back(_typed ? missingBits(_type) : 0); }
+
+    // settle the run on the column's final type: an all-missing run takes
+    // it, Int64 cells become doubles; false if that isn't exact
+    bool convertTo(ColumnType t) {
+        if (!_typed) {
+            _typed = true;
+            _type = t;
+            fillMissing();
+            return true;
+        }
+        if (_type == t) return true;
+        return _type == ColumnType::Int64 && t == ColumnType::Float64 && promoteToFloat();
+    }
+
+    // give up on a native type; the cells are dropped
+    void demote() {
+        _demoted = true;
+        std::vector<u64>().swap(_cells);
+    }
+
+    // common type of two runs of one column, String when they don't mix
+    static ColumnType unify(ColumnType a, ColumnType b) {
+        if (a == b) return a;
+        const bool numeric = (a == ColumnType::Int64 || a == ColumnType::Float64)
+                          && (b == ColumnType::Int64 || b == ColumnType::Float64);
+        return numeric ? ColumnType::Float64 : ColumnType::String;
+    }
+
+    // Kind and 64-bit value of a non-empty token; false for anything that
+    // isn't an int64, finite double, bool or YYYY-MM-DD date. `hint` is the
+    // kind tried first. nan/inf/hex spellings, and numbers with a leading
+    // zero, are left to the dictionary.
+    static bool parse(std::string_view t, ColumnType hint, ColumnType& kind, u64& v) {
+        const char* b = t.data();
+        const char* e = b + t.size();
+        const unsigned char c0 = static_cast<unsigned char>(t[0]);
+        const bool numberLike = (c0 >= '0' && c0 <= '9') || c0 == '.'
+                             || (c0 == '-' && t.size() > 1 && (t[1] == '.' || (t[1] >= '0' && t[1] <= '9')));
+        if (numberLike) {
+            // "02134", "007": zip codes and ids, whose zeros a number would drop
+            const std::size_t lead = c0 == '-' ? 1 : 0;
+            const bool leadingZero = t.size() > lead + 1 && t[lead] == '0' && t[lead + 1] >= '0' && t[lead + 1] <= '9';
+            if (hint != ColumnType::Float64) {
+                std::int64_t i;
+                const auto r = std::from_chars(b, e, i);
+                if (!leadingZero && r.ec == std::errc() && r.ptr == e && i != kMissingInt) {
+                    kind = ColumnType::Int64;
+                    v = static_cast<u64>(i);
+                    return true;
+                }
+                if (t.size() == 10 && t[4] == '-' && t[7] == '-') {
+                    std::int64_t days;
+                    if (!parseDate(t, days)) return false;
+                    kind = ColumnType::Date;
+                    v = static_cast<u64>(days);
+                    return true;
+                }
+            }
+            double d;
+            const auto r = std::from_chars(b, e, d);
+            if (!leadingZero && r.ec == std::errc() && r.ptr == e && std::isfinite(d)) {
+                kind = ColumnType::Float64;
+                v = doubleBits(d);
+                return true;
+            }
+            if (hint == ColumnType::Float64) return parse(t, ColumnType::Int64, kind, v);
+            return false;
+        }
+        if (t == "true" || t == "TRUE" || t == "True")    { kind = ColumnType::Bool; v = 1; return true; }
+        if (t == "false" || t == "FALSE" || t == "False") { kind = ColumnType::Bool; v = 0; return true; }
+        return false;
+    }
+
+    // days since 1970-01-01 of a valid YYYY-MM-DD
+    static bool parseDate(std::string_view t, std::int64_t& days) {
+        int y = 0, m = 0, d = 0;
+        const char* p = t.data();
+        if (std::from_chars(p, p + 4, y).ptr != p + 4
+            || std::from_chars(p + 5, p + 7, m).ptr != p + 7
+            || std::from_chars(p + 8, p + 10, d).ptr != p + 10) return false;
+        static const int kMonthDays[12] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        if (m < 1 || m > 12 || d < 1 || d > kMonthDays[m - 1]) return false;
+        const bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+        if (m == 2 && d == 29 && !leap) return false;
+        // civil date -> days (H. Hinnant's days_from_civil)
+        y -= m <= 2;
+        const int era = y / 400;
+        const unsigned yoe = static_cast<unsigned>(y - era * 400);
+        const unsigned doy = (153u * static_cast<unsigned>(m + (m > 2 ? -3 : 9)) + 2) / 5 + static_cast<unsigned>(d) - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        days = static_cast<std::int64_t>(era) * 146097 + static_cast<std::int64_t>(doe) - 719468;
+        return true;
+    }
+
+    static u64 missingBits(ColumnType t) {
+        return t == ColumnType::Float64 ? kMissingFloatBits : static_cast<u64>(kMissingInt);
+    }
+
+    static u64 doubleBits(double d) {
+        u64 v;
+        std::memcpy(&v, &d, sizeof(v));
+        return v;
+    }
+
+private:
+    // Int64 cells as doubles; false if one isn't exactly representable
+    bool promoteToFloat() {
+        for (u64 c : _cells) {
+            const auto v = static_cast<std::int64_t>(c);
+            if (v != kMissingInt && !exactAsDouble(v)) return false;
+        }
+        for (u64& c : _cells) {
+            const auto v = static_cast<std::int64_t>(c);
+            c = (v == kMissingInt) ? kMissingFloatBits : doubleBits(static_cast<double>(v));
+        }
+        _type = ColumnType::Float64;
+        _typed = true;
+        return true;
+    }
+
+    static bool exactAsDouble(std::int64_t v) {
+        constexpr std::int64_t kLimit = std::int64_t(1) << 53;
+        return v >= -kLimit && v <= kLimit;
+    }
+
+    // cells appended before the first value were missing of an unknown type
+    void fillMissing() {
+        for (u64& c : _cells) c = missingBits(_type);
+    }
+
+    std::vector<u64> _cells;
+    ColumnType _type = ColumnType::String;
+    bool _typed = false;
+    bool _demoted = false;
+};
+
+} // namespace tabular
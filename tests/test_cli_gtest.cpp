@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include "TabularData/TabularData.hpp"
+#include "TabularData/ColumnStore.hpp"
+#include "TabularData/FaultyRows.hpp"
+#include "TabularData/Query.hpp"
+#include "test_util.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+
+namespace fs = std::filesystem;
+using tabular::ColumnStore;
+using tabular::Query;
+using tabular::TabularData;
+using tabular_test::test_dir;
+
+namespace {
+
+fs::path write_table() {
+    const fs::path csv = test_dir() / "table.csv";
+    std::ofstream out(csv, std::ios::binary);
+    out << "id,city,amount,note\n";
+    std::mt19937 rng(5);
+    for (int r = 0; r < 5000; ++r) {
+        out << r << ",c" << rng() % 12 << "," << rng() % 1000 << ",";
+        out << (r % 9 ? "n" + std::to_string(rng() % 50) : std::string("\"a,\nb\"")) << "\n";
+    }
+    return csv;
+}
+
+struct CliRun {
+    int status = -1;
+    std::string out, err;
+};
+
+// run the driver with `args`, capturing stdout and stderr (through a file
+// of the running test)
+CliRun tabular_cli(const std::string& args) {
+    const fs::path err = test_dir() / "stderr.txt";
+    const std::string cmd = std::string(TABULAR_CLI) + " " + args + " 2>" + err.string();
+    CliRun run;
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (!pipe) return run;
+    char buf[4096];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), pipe)) > 0;) run.out.append(buf, n);
+    const int status = pclose(pipe);
+    run.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    std::ifstream in(err);
+    std::ostringstream text;
+    text << in.rdbuf();
+    run.err = text.str();
+    return run;
+}
+
+} // end anon
+
+TEST(CliTest, TransposeQueryAndFetchRows) {
+    const fs::path csv = write_table();
+    const fs::path out = test_dir() / "out";
+
+    const CliRun transpose = tabular_cli("transpose -t 2 --infer-types -o " + out.string() + " " + csv.string());
+    ASSERT_EQ(transpose.status, 0) << transpose.err;
+    EXPECT_EQ(transpose.out, "5000 rows, 4 columns\n");
+    for (const char* phase : {"slice_parse", "dictionary_merge", "scan", "command", "GB/s", "Mrows/s"}) {
+        EXPECT_NE(transpose.err.find(phase), std::string::npos) << phase << " missing from\n" << transpose.err;
+    }
+
+    const ColumnStore store(out.string());
+    ASSERT_EQ(store.rowCount(), 5000u);
+    Query q(store);
+    q.whereEquals(1, "c3").whereRange(2, "100", "600");
+    const auto matches = q.rowIds();
+    const CliRun count = tabular_cli("query -q -o " + out.string() + " --where 1=c3 --where 2=100..600 --count");
+    ASSERT_EQ(count.status, 0) << count.err;
+    EXPECT_EQ(count.out, std::to_string(matches.size()) + "\n");
+
+    // header names need the CSV; rows print as "<row>,<cells>"
+    const CliRun rows = tabular_cli("query -q -o " + out.string() + " --where city=c3 --where amount=100..600"
+                                 " --select amount,id --limit 2 " + csv.string());
+    ASSERT_EQ(rows.status, 0) << rows.err;
+    ASSERT_GE(matches.size(), 2u);
+    std::string expected;
+    for (int i = 0; i < 2; ++i) {
+        expected += std::to_string(matches[i]) + "," + store.column(2).text(matches[i]) + ","
+                  + store.column(0).text(matches[i]) + "\n";
+    }
+    EXPECT_EQ(rows.out, expected);
+
+    TabularData td(csv.string(), out.string());
+    td.loadRowOffsets();
+    const CliRun fetch = tabular_cli("fetch-row -q --rows 0,8-9 -o " + out.string() + " " + csv.string());
+    ASSERT_EQ(fetch.status, 0) << fetch.err;
+    EXPECT_EQ(fetch.out, std::string(td.getRow(0)) + "\n" + std::string(td.getRow(8)) + "\n"
+                       + std::string(td.getRow(9)) + "\n");
+
+    // ranges are checked before they are expanded
+    for (const char* rows : {"5-3", "4999-5000", "0-18446744073709551615"}) {
+        const CliRun bad = tabular_cli("fetch-row -q --rows " + std::string(rows) + " -o " + out.string() + " " + csv.string());
+        EXPECT_EQ(bad.status, 2) << rows;
+        EXPECT_TRUE(bad.out.empty()) << rows;
+    }
+}
+
+TEST(CliTest, IndexAndStat) {
+    const fs::path csv = write_table();
+    const fs::path out = test_dir() / "index";
+
+    const CliRun index = tabular_cli("index -t 3 -o " + out.string() + " " + csv.string());
+    ASSERT_EQ(index.status, 0) << index.err;
+    EXPECT_EQ(index.out, "5000 rows, 4 columns\n");
+    EXPECT_TRUE(fs::exists(out / "row_offsets.bin"));
+    EXPECT_FALSE(fs::exists(out / "columns"));
+
+    const CliRun stat = tabular_cli("stat -q -o " + out.string() + " " + csv.string());
+    ASSERT_EQ(stat.status, 0) << stat.err;
+    EXPECT_NE(stat.out.find("rows         5000 (5000 sampled"), std::string::npos) << stat.out;
+    for (const char* line : {"  0  id", "  1  city", "int64", "string"}) {
+        EXPECT_NE(stat.out.find(line), std::string::npos) << line << " missing from\n" << stat.out;
+    }
+}
+
+TEST(CliTest, FaultyRows) {
+    const fs::path csv = test_dir() / "faulty.csv";
+    {
+        std::ofstream out(csv, std::ios::binary);
+        out << "a,b,c\n";
+        for (int r = 0; r < 100; ++r) out << r << (r % 10 == 3 ? ",x\n" : ",x,y\n");
+    }
+    const fs::path out = test_dir() / "faulty";
+    const CliRun strict = tabular_cli("index --strict -o " + out.string() + " " + csv.string());
+    EXPECT_EQ(strict.status, 3);
+    EXPECT_NE(strict.err.find("expected 3, found 2"), std::string::npos) << strict.err;
+
+    const CliRun capped = tabular_cli("index --record-faults --max-faults 4 -o " + out.string() + " " + csv.string());
+    EXPECT_EQ(capped.status, 3);
+    const CliRun uncapped = tabular_cli("index --max-faults 4 -o " + out.string() + " " + csv.string());
+    EXPECT_EQ(uncapped.status, 2);
+    EXPECT_NE(uncapped.err.find("--max-faults needs --record-faults"), std::string::npos) << uncapped.err;
+
+    const CliRun recorded = tabular_cli("index --record-faults -o " + out.string() + " " + csv.string());
+    ASSERT_EQ(recorded.status, 0) << recorded.err;
+    EXPECT_EQ(recorded.out, "90 rows, 3 columns\n");
+    EXPECT_NE(recorded.err.find("10 faulty rows"), std::string::npos) << recorded.err;
+    tabular::FaultyRowReport report;
+    ASSERT_TRUE(tabular::FaultyRowReport::load(out.string(), report));
+    EXPECT_EQ(report.rows.size(), 10u);
+}
+
+TEST(CliTest, BadArgumentsFail) {
+    const CliRun unknown = tabular_cli("frobnicate x.csv");
+    EXPECT_EQ(unknown.status, 2);
+    EXPECT_NE(unknown.err.find("unknown command: frobnicate"), std::string::npos);
+    EXPECT_NE(unknown.err.find("usage: tabular"), std::string::npos);
+
+    EXPECT_EQ(tabular_cli("transpose --threads many x.csv").status, 2);
+    EXPECT_EQ(tabular_cli("transpose --delimiter '\"' x.csv").status, 1); // std::invalid_argument from the dialect
+    EXPECT_EQ(tabular_cli("index").status, 2);                              // no <csv>
+
+    const CliRun missing = tabular_cli("index -o " + (test_dir() / "missing").string() + " "
+                                    + (test_dir() / "no_such.csv").string());
+    EXPECT_EQ(missing.status, 1);
+    EXPECT_NE(missing.err.find("tabular: "), std::string::npos);
+}
@@ -0,0 +1,525 @@
+#include <gtest/gtest.h>
+#include "TabularData/TabularData.hpp"
+#include "TabularData/ColumnStore.hpp"
+#include "test_util.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+using tabular::ColumnStore;
+using tabular::InputMode;
+using tabular::TabularData;
+using tabular_test::test_dir;
+
+TEST(ColumnStoreTest, HomesRoundTrip) {
+    fs::path csv = fs::path("tests/sample_csv/homes.csv");
+    fs::path outdir = test_dir() / "out";
+
+    TabularData td(csv.string(), outdir.string());
+    td.parseHeaderRow();
+    td.findRowOffsets();
+    td.mapIntTranspose();
+
+    ColumnStore store(outdir.string());
+    ASSERT_EQ(store.rowCount(), 50u);
+    ASSERT_EQ(store.columnCount(), 9u);
+
+    EXPECT_EQ(store.column(0).cell(0), "142");
+    EXPECT_EQ(store.column(7).cell(0), "0.28");
+    EXPECT_EQ(store.column(8).cell(49), "3059");
+
+    const std::uint64_t distinct[9] = {42, 32, 20, 8, 4, 4, 34, 37, 49};
+    for (std::uint32_t c = 0; c < 9; ++c) {
+        EXPECT_EQ(store.column(c).dictionarySize(), distinct[c]) << "column " << c;
+        EXPECT_EQ(store.column(c).width(), 1u) << "column " << c; // < 255 distinct values
+    }
+
+    auto beds = store.column(4);
+    const std::int64_t three = beds.find("3");
+    ASSERT_GE(three, 0);
+    EXPECT_EQ(beds.value(static_cast<std::uint64_t>(three)), "3");
+    EXPECT_EQ(beds.find("no such value"), -1);
+}
+
+TEST(ColumnStoreTest, FusedScanMatchesTwoPass) {
+    fs::path csv = fs::path("tests/sample_csv/homes.csv");
+    fs::path twoPass = test_dir() / "two_pass";
+    fs::path fused = test_dir() / "fused";
+
+    TabularData a(csv.string(), twoPass.string());
+    a.parseHeaderRow();
+    a.findRowOffsets();
+    a.mapIntTranspose();
+
+    TabularData b(csv.string(), fused.string());
+    b.scanAndTranspose();
+    EXPECT_EQ(b.getRowCount(), a.getRowCount());
+    EXPECT_EQ(b.rowOffsets(), a.rowOffsets());
+
+    ColumnStore x(twoPass.string()), y(fused.string());
+    ASSERT_EQ(y.rowCount(), x.rowCount());
+    ASSERT_EQ(y.columnCount(), x.columnCount());
+    for (std::uint32_t c = 0; c < x.columnCount(); ++c) {
+        ASSERT_EQ(y.column(c).dictionarySize(), x.column(c).dictionarySize()) << "column " << c;
+        for (std::uint64_t r = 0; r < x.rowCount(); ++r) {
+            EXPECT_EQ(y.column(c).id(r), x.column(c).id(r)) << "column " << c << " row " << r;
+        }
+    }
+}
+
+TEST(ColumnStoreTest, SortedDictionaries) {
+    fs::path csv = fs::path("tests/sample_csv/homes.csv");
+    fs::path plain = test_dir() / "unsorted";
+    fs::path outdir = test_dir() / "sorted";
+    {
+        TabularData td(csv.string(), plain.string());
+        td.scanAndTranspose();
+    }
+
+    for (bool fusedScan : {false, true}) {
+        TabularData td(csv.string(), outdir.string());
+        td.setSortedDictionaries(true);
+        if (fusedScan) {
+            td.scanAndTranspose();
+        } else {
+            td.parseHeaderRow();
+            td.findRowOffsets();
+            td.mapIntTranspose();
+        }
+
+        ColumnStore sorted(outdir.string());
+        ColumnStore store(plain.string());
+        for (std::uint32_t c = 0; c < sorted.columnCount(); ++c) {
+            auto col = sorted.column(c);
+            for (std::uint64_t id = 1; id < col.dictionarySize(); ++id) {
+                EXPECT_LT(col.value(id - 1), col.value(id)) << "column " << c;
+            }
+            for (std::uint64_t r = 0; r < sorted.rowCount(); ++r) {
+                EXPECT_EQ(col.cell(r), store.column(c).cell(r)) << "column " << c << " row " << r;
+            }
+        }
+    }
+}
+
+TEST(ColumnStoreTest, MemoryBudgetSplitsChunks) {
+    fs::path csv = fs::path("tests/sample_csv/homes.csv");
+    fs::path plain = test_dir() / "unbudgeted";
+    fs::path outdir = test_dir() / "budget";
+    {
+        TabularData td(csv.string(), plain.string());
+        td.scanAndTranspose();
+    }
+
+    TabularData td(csv.string(), outdir.string());
+    td.setMemoryBudget(1); // smaller than any column: one column per chunk
+    td.parseHeaderRow();
+    td.findRowOffsets();
+    td.mapIntTranspose();
+    EXPECT_EQ(fs::file_size(outdir / "column_chunk_meta.bin"), 9u * 2 * sizeof(std::uint32_t));
+
+    ColumnStore budgeted(outdir.string()), store(plain.string());
+    ASSERT_EQ(budgeted.columnCount(), store.columnCount());
+    for (std::uint32_t c = 0; c < store.columnCount(); ++c) {
+        for (std::uint64_t r = 0; r < store.rowCount(); ++r) {
+            EXPECT_EQ(budgeted.column(c).cell(r), store.column(c).cell(r)) << "column " << c << " row " << r;
+        }
+    }
+}
+
+TEST(ColumnStoreTest, StreamReadAheadMatchesMmap) {
+    // several CHUNK_SIZE spans, with quoted newlines to straddle windows
+    fs::path csv = test_dir() / "read_ahead.csv";
+    {
+        std::ofstream out(csv, std::ios::binary);
+        out << "id,name,note\n";
+        for (int r = 0; r < 120000; ++r) {
+            out << r << ",name" << r % 977 << ",";
+            if (r % 13 == 0) out << "\"multi\nline " << r % 31 << "\"";
+            else out << "note" << r % 53;
+            out << "\n";
+        }
+    }
+
+    fs::path mapped = test_dir() / "mmap";
+    fs::path streamed = test_dir() / "stream";
+    TabularData a(csv.string(), mapped.string());
+    a.setInputMode(InputMode::Mmap);
+    a.setThreadCount(2);
+    a.scanAndTranspose();
+
+    TabularData b(csv.string(), streamed.string());
+    b.setInputMode(InputMode::Stream);
+    b.setThreadCount(2);
+    b.scanAndTranspose();
+    EXPECT_EQ(b.getRowCount(), 120000u);
+    EXPECT_EQ(b.rowOffsets(), a.rowOffsets());
+
+    ColumnStore x(mapped.string()), y(streamed.string());
+    ASSERT_EQ(y.columnCount(), x.columnCount());
+    for (std::uint32_t c = 0; c < x.columnCount(); ++c) {
+        for (std::uint64_t r = 0; r < x.rowCount(); r += 7) {
+            EXPECT_EQ(y.column(c).cell(r), x.column(c).cell(r)) << "column " << c << " row " << r;
+        }
+    }
+}
+
+TEST(ColumnStoreTest, TypeInference) {
+    fs::path csv = test_dir() / "types.csv";
+    {
+        std::ofstream out(csv, std::ios::binary);
+        out << "n,x,flag,day,mixed,late\n";
+        for (int r = 0; r < 3000; ++r) {
+            out << r - 1000 << ",";
+            if (r % 5 == 0) out << r;        // ints among the doubles
+            else if (r % 17 != 0) out << r << ".25";
+            out << "," << (r % 2 ? "true" : "false")
+                << ",2024-02-" << (r % 28 + 1) / 10 << (r % 28 + 1) % 10
+                << "," << (r == 2500 ? "n/a" : std::to_string(r))
+                << "," << (r < 2000 ? "" : "7") << "\n";
+        }
+    }
+    fs::path plain = test_dir() / "plain";
+    {
+        TabularData td(csv.string(), plain.string());
+        td.scanAndTranspose();
+    }
+    ColumnStore store(plain.string());
+
+    fs::path outdir = test_dir() / "inferred";
+    for (bool fusedScan : {false, true}) {
+        TabularData td(csv.string(), outdir.string());
+        td.setTypeInference(true);
+        td.setThreadCount(2);
+        if (fusedScan) {
+            td.scanAndTranspose();
+        } else {
+            td.parseHeaderRow();
+            td.findRowOffsets();
+            td.mapIntTranspose();
+        }
+
+        ColumnStore typed(outdir.string());
+        ASSERT_EQ(typed.rowCount(), 3000u);
+        EXPECT_EQ(typed.column(0).type(), tabular::ColumnType::Int64);
+        EXPECT_EQ(typed.column(1).type(), tabular::ColumnType::Float64);
+        EXPECT_EQ(typed.column(2).type(), tabular::ColumnType::Bool);
+        EXPECT_EQ(typed.column(3).type(), tabular::ColumnType::Date);
+        EXPECT_EQ(typed.column(4).type(), tabular::ColumnType::String);
+        EXPECT_EQ(typed.column(5).type(), tabular::ColumnType::Int64);
+
+        EXPECT_EQ(typed.column(0).int64(0), -1000);
+        EXPECT_EQ(typed.column(1).float64(1), 1.25);
+        EXPECT_EQ(typed.column(1).float64(5), 5.0);
+        EXPECT_TRUE(typed.column(1).isMissing(17));
+        EXPECT_TRUE(typed.column(5).isMissing(0));
+        EXPECT_EQ(typed.column(5).int64(2999), 7);
+        EXPECT_THROW(typed.column(0).id(0), std::logic_error);
+        for (std::uint32_t c = 0; c < typed.columnCount(); ++c) {
+            for (std::uint64_t r = 0; r < typed.rowCount(); ++r) {
+                EXPECT_EQ(typed.column(c).text(r), store.column(c).cell(r)) << "column " << c << " row " << r;
+            }
+        }
+        // String columns are encoded exactly as without inference
+        EXPECT_EQ(typed.column(4).dictionarySize(), store.column(4).dictionarySize());
+        for (std::uint64_t r = 0; r < typed.rowCount(); ++r) {
+            EXPECT_EQ(typed.column(4).id(r), store.column(4).id(r)) << "row " << r;
+        }
+    }
+
+    fs::path homes = test_dir() / "homes";
+    TabularData td("tests/sample_csv/homes.csv", homes.string());
+    td.setTypeInference(true);
+    td.scanAndTranspose();
+    ColumnStore h(homes.string());
+    EXPECT_EQ(h.column(0).type(), tabular::ColumnType::Int64);
+    EXPECT_EQ(h.column(0).int64(0), 142);
+    EXPECT_EQ(h.column(7).type(), tabular::ColumnType::Float64);
+    EXPECT_EQ(h.column(7).float64(0), 0.28);
+}
+
+TEST(ColumnStoreTest, LeadingZerosStayText) {
+    // zip codes and ids: their zeros must survive, so the columns stay String
+    const fs::path csv = test_dir() / "zeros.csv";
+    {
+        std::ofstream out(csv, std::ios::binary);
+        out << "zip,code,small,ratio\n";
+        for (int r = 0; r < 500; ++r) {
+            char zip[8];
+            std::snprintf(zip, sizeof zip, "%05d", r * 37 % 30000);
+            out << zip << "," << (r == 300 ? "-007" : std::to_string(r)) << "," << r % 3 << ","
+                << (r % 2 ? "0.5" : "-0.25") << "\n";
+        }
+    }
+    const fs::path plain = test_dir() / "plain";
+    {
+        TabularData td(csv.string(), plain.string());
+        td.scanAndTranspose();
+    }
+    const fs::path outdir = test_dir() / "inferred";
+    TabularData td(csv.string(), outdir.string());
+    td.setTypeInference(true);
+    td.scanAndTranspose();
+
+    const ColumnStore store(plain.string()), typed(outdir.string());
+    EXPECT_EQ(typed.column(0).type(), tabular::ColumnType::String);
+    EXPECT_EQ(typed.column(1).type(), tabular::ColumnType::String);
+    EXPECT_EQ(typed.column(2).type(), tabular::ColumnType::Int64); // a lone "0" is a number
+    EXPECT_EQ(typed.column(3).type(), tabular::ColumnType::Float64);
+    for (std::uint32_t c = 0; c < typed.columnCount(); ++c) {
+        for (std::uint64_t r = 0; r < typed.rowCount(); ++r) {
+            ASSERT_EQ(typed.column(c).text(r), store.column(c).cell(r)) << "column " << c << " row " << r;
+        }
+    }
+}
+
+TEST(ColumnStoreTest, WideChunkTilesKeepEveryCell) {
+    // 300 columns: the transpose buffers 64-row tiles; each typed column
+    // turns out String at a row of its own, some inside a tile, some on
+    // its first row
+    fs::path csv = test_dir() / "wide.csv";
+    const int ncols = 300, nrows = 1500;
+    auto cell = [](int r, int c) {
+        const int demoteAt = (c * 37) % 1700; // past nrows: stays Int64
+        return c % 3 == 0 ? "s" + std::to_string((r * 7 + c) % 41)
+             : r == demoteAt ? std::string("x") + std::to_string(c)
+             : std::to_string(r * c % 1000);
+    };
+    {
+        std::ofstream out(csv, std::ios::binary);
+        for (int c = 0; c < ncols; ++c) out << (c ? "," : "") << "c" << c;
+        out << "\n";
+        for (int r = 0; r < nrows; ++r) {
+            for (int c = 0; c < ncols; ++c) out << (c ? "," : "") << cell(r, c);
+            out << "\n";
+        }
+    }
+    fs::path outdir = test_dir() / "wide";
+    TabularData td(csv.string(), outdir.string());
+    td.setTypeInference(true);
+    td.setThreadCount(3);
+    td.parseHeaderRow();
+    td.findRowOffsets();
+    td.mapIntTranspose();
+
+    ColumnStore store(outdir.string());
+    ASSERT_EQ(store.rowCount(), static_cast<std::uint64_t>(nrows));
+    ASSERT_EQ(store.columnCount(), static_cast<std::uint32_t>(ncols));
+    for (int c = 0; c < ncols; ++c) {
+        const bool stringy = c % 3 == 0 || (c * 37) % 1700 < nrows;
+        EXPECT_EQ(store.column(c).type(), stringy ? tabular::ColumnType::String : tabular::ColumnType::Int64) << "column " << c;
+        for (int r = 0; r < nrows; ++r) {
+            ASSERT_EQ(store.column(c).text(r), cell(r, c)) << "column " << c << " row " << r;
+        }
+    }
+}
+
+namespace {
+
+// same rows, types, widths and dictionary ids
+void expect_same_store(const ColumnStore& x, const ColumnStore& y) {
+    ASSERT_EQ(y.rowCount(), x.rowCount());
+    for (std::uint32_t c = 0; c < x.columnCount(); ++c) {
+        ASSERT_EQ(y.column(c).type(), x.column(c).type()) << "column " << c;
+        ASSERT_EQ(y.column(c).width(), x.column(c).width()) << "column " << c;
+        ASSERT_EQ(y.column(c).dictionarySize(), x.column(c).dictionarySize()) << "column " << c;
+        EXPECT_EQ(y.column(c).sortedDictionary(), x.column(c).sortedDictionary()) << "column " << c;
+        for (std::uint64_t r = 0; r < x.rowCount(); ++r) {
+            EXPECT_EQ(y.column(c).text(r), x.column(c).text(r)) << "column " << c << " row " << r;
+            if (x.column(c).type() == tabular::ColumnType::String) {
+                EXPECT_EQ(y.column(c).id(r), x.column(c).id(r)) << "column " << c << " row " << r;
+            }
+        }
+    }
+}
+
+std::string read_file(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// the chunk files of a store, by name
+std::vector<std::pair<std::string, std::string>> chunk_files(const fs::path& outdir) {
+    std::vector<std::pair<std::string, std::string>> files;
+    for (const auto& e : fs::directory_iterator(outdir / "columns")) {
+        if (e.path().extension() == ".tdc") files.emplace_back(e.path().filename().string(), read_file(e.path()));
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+} // end anon
+
+TEST(ColumnStoreTest, RefreshAppendedRows) {
+    fs::path csv = test_dir() / "refresh.csv";
+    fs::path outdir = test_dir() / "refresh";
+    fs::path full = test_dir() / "full";
+    auto append_rows = [&](int first, int last) {
+        std::ofstream out(csv, std::ios::binary | std::ios::app);
+        for (int r = first; r < last; ++r) out << r << ",name" << r << ",\"q," << r % 7 << "\"\n";
+    };
+    { std::ofstream(csv, std::ios::binary | std::ios::trunc) << "id,name,note\n"; }
+    append_rows(0, 200);
+
+    auto expect_rebuilt_equal = [&](bool fused) {
+        TabularData b(csv.string(), full.string());
+        b.setTypeInference(true);
+        if (fused) {
+            b.scanAndTranspose();
+        } else {
+            b.parseHeaderRow();
+            b.findRowOffsets();
+            b.mapIntTranspose();
+        }
+        expect_same_store(ColumnStore(full.string()), ColumnStore(outdir.string()));
+        TabularData reread(csv.string(), full.string());
+        reread.loadRowOffsets();
+        TabularData current(csv.string(), outdir.string());
+        current.loadRowOffsets();
+        EXPECT_EQ(current.rowOffsets(), reread.rowOffsets());
+    };
+
+    TabularData td(csv.string(), outdir.string());
+    td.setTypeInference(true);
+    td.setThreadCount(2);
+    EXPECT_FALSE(td.refresh()); // nothing indexed yet: full scan
+    EXPECT_EQ(td.getRowCount(), 200u);
+
+    auto before = chunk_files(outdir);
+    append_rows(200, 600); // "name" outgrows 1-byte ids
+    EXPECT_TRUE(td.refresh());
+    EXPECT_EQ(td.getRowCount(), 600u);
+    auto after = chunk_files(outdir);
+    ASSERT_EQ(after.size(), before.size());
+    for (std::size_t k = 0; k < after.size(); ++k) {
+        // appended to, not rewritten
+        EXPECT_EQ(after[k].first, before[k].first);
+        EXPECT_GT(after[k].second.size(), before[k].second.size());
+        EXPECT_EQ(after[k].second.compare(0, before[k].second.size(), before[k].second), 0) << after[k].first;
+    }
+    EXPECT_FALSE(fs::exists(outdir / "column_chunk_meta.bin.new"));
+    {
+        ColumnStore store(outdir.string());
+        EXPECT_EQ(store.column(0).runCount(), 2u); // Int64 values, appended
+        EXPECT_EQ(store.column(1).runCount(), 1u); // rewritten at 2-byte ids
+        EXPECT_EQ(store.column(2).runCount(), 2u); // "q,0" .. "q,6" again
+    }
+    expect_rebuilt_equal(true);
+
+    EXPECT_TRUE(td.refresh()); // nothing appended
+    EXPECT_EQ(td.getRowCount(), 600u);
+
+    { std::ofstream(csv, std::ios::binary | std::ios::app) << "n/a,late,\"x\"\n"; }
+    EXPECT_FALSE(td.refresh()); // "id" is no longer an integer column
+    EXPECT_EQ(ColumnStore(outdir.string()).column(0).type(), tabular::ColumnType::String);
+    expect_rebuilt_equal(false);
+
+    { std::ofstream(csv, std::ios::binary | std::ios::trunc) << "id,name,note\n"; }
+    append_rows(1000, 1100);
+    EXPECT_FALSE(td.refresh()); // rewritten, not appended to
+    EXPECT_EQ(td.getRowCount(), 100u);
+    expect_rebuilt_equal(true);
+}
+
+TEST(ColumnStoreTest, RefreshSortedDictionariesAndCompaction) {
+    fs::path csv = test_dir() / "refresh.csv";
+    fs::path outdir = test_dir() / "refresh";
+    fs::path full = test_dir() / "full";
+    auto append_rows = [&](const char* prefix, int first, int last) {
+        std::ofstream out(csv, std::ios::binary | std::ios::app);
+        for (int r = first; r < last; ++r) out << prefix << 1000 + r << ",t" << r % 3 << "\n";
+    };
+    auto expect_rebuilt_equal = [&] {
+        TabularData b(csv.string(), full.string());
+        b.setSortedDictionaries(true);
+        b.scanAndTranspose();
+        expect_same_store(ColumnStore(full.string()), ColumnStore(outdir.string()));
+    };
+    { std::ofstream(csv, std::ios::binary | std::ios::trunc) << "key,tag\n"; }
+    append_rows("k", 0, 100);
+
+    TabularData td(csv.string(), outdir.string());
+    td.setSortedDictionaries(true);
+    EXPECT_FALSE(td.refresh());
+
+    append_rows("k", 100, 130); // every new key sorts last
+    EXPECT_TRUE(td.refresh());
+    {
+        ColumnStore store(outdir.string());
+        EXPECT_EQ(store.column(0).runCount(), 2u);
+        EXPECT_TRUE(store.column(0).sortedDictionary());
+    }
+    expect_rebuilt_equal();
+
+    append_rows("a", 0, 10); // ... these first: every id moves
+    EXPECT_TRUE(td.refresh());
+    EXPECT_EQ(ColumnStore(outdir.string()).column(0).runCount(), 1u);
+    expect_rebuilt_equal();
+
+    // a run and a footer per refresh, until the dead bytes outweigh the
+    // live ones and the chunk is compacted
+    for (int r = 130; r < 170; ++r) {
+        append_rows("k", r, r + 1);
+        EXPECT_TRUE(td.refresh());
+    }
+    {
+        ColumnStore store(outdir.string());
+        EXPECT_LT(store.column(1).runCount(), 40u);
+        EXPECT_EQ(store.column(0).find("k1169"), static_cast<std::int64_t>(store.column(0).dictionarySize() - 1));
+    }
+    for (const auto& e : fs::directory_iterator(outdir / "columns")) {
+        EXPECT_NE(e.path().extension(), ".new") << e.path();
+    }
+    expect_rebuilt_equal();
+}
+
+TEST(ColumnStoreTest, MetricsCoverEveryPhase) {
+    fs::path csv = fs::path("tests/sample_csv/homes.csv");
+    fs::path outdir = test_dir() / "metrics";
+
+    TabularData td(csv.string(), outdir.string());
+    td.setMemoryBudget(1); // one column per chunk
+    td.setThreadCount(2);
+    td.parseHeaderRow();
+    td.findRowOffsets();
+    td.mapIntTranspose();
+
+    using tabular::Phase;
+    const tabular::Metrics m = td.metrics();
+    for (Phase p : {Phase::Header, Phase::Resync, Phase::SliceParse, Phase::Merge, Phase::TransposeChunk,
+                    Phase::DictionaryMerge, Phase::Write}) {
+        EXPECT_GT(m.phase(p).calls, 0u) << tabular::phaseName(p);
+    }
+    EXPECT_EQ(m.phase(Phase::Header).calls, 1u);
+    EXPECT_EQ(m.rows, 50u);
+    EXPECT_GT(m.bytesRead, fs::file_size(csv)); // every row once per pass, plus the header
+    EXPECT_GT(m.rowsPerSecond(), 0.0);
+
+    std::uint64_t sliceRows = 0;
+    for (const auto& s : m.slices) sliceRows += s.rows;
+    EXPECT_EQ(sliceRows, 50u);
+    EXPECT_EQ(m.slices.back().end, fs::file_size(csv));
+
+    ASSERT_EQ(m.chunks.size(), 9u);
+    const std::uint64_t distinct[9] = {42, 32, 20, 8, 4, 4, 34, 37, 49};
+    for (std::uint32_t c = 0; c < 9; ++c) {
+        EXPECT_EQ(m.chunks[c].firstCol, c);
+        EXPECT_EQ(m.chunks[c].dictionaryEntries, distinct[c]) << "column " << c;
+        EXPECT_GE(m.chunks[c].imbalance, 1.0);
+    }
+    EXPECT_EQ(m.largestDictionary, 49u);
+    EXPECT_GT(m.peakChunkBytes, 0u);
+
+    const std::string json = m.toJson();
+    EXPECT_NE(json.find("\"dictionary_merge\": {"), std::string::npos);
+    EXPECT_NE(json.find("\"rows\": 50,"), std::string::npos);
+
+    td.resetMetrics();
+    EXPECT_EQ(td.metrics().phase(Phase::Header).calls, 0u);
+    EXPECT_TRUE(td.metrics().chunks.empty());
+}
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include "TabularData/TabularData.hpp"
+#include "TabularData/ColumnStore.hpp"
+#include "test_util.hpp"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace fs = std::filesystem;
+using tabular::ColumnStore;
+using tabular::TabularData;
+using tabular_test::test_dir;
+
+namespace {
+
+const char* const kHeader = "day,city,\"amount, eur\",note";
+
+// data rows of partition p, quoted the way its writer happened to: line
+// breaks in quoted notes, every city quoted, or notes with doubled quotes
+// and the delimiter. CRLF rows, and a last row left without a terminator
+// in every third partition.
+std::string partition_rows(int p, int rows) {
+    std::ostringstream out;
+    std::mt19937 rng(static_cast<unsigned>(p) + 1);
+    const int style = p % 3;
+    for (int r = 0; r < rows; ++r) {
+        out << "2024-01-" << (p % 28 + 1) / 10 << (p % 28 + 1) % 10 << ",";
+        if (style == 1) out << "\"city" << rng() % 30 << "\"";
+        else out << "city" << rng() % 30;
+        out << "," << rng() % 500 << ",";
+        if (r % 9 != 0) out << "n" << rng() % 50;
+        else if (style == 2) out << "\"said \"\"no, " << r % 5 << "\"\"\"";
+        else out << "\"two\nlines\"";
+        if (r + 1 < rows || p % 3 != 0) out << (r % 4 ? "\n" : "\r\n");
+    }
+    return out.str();
+}
+
+// nparts partitions of the same table, plus (when asked) the one CSV they
+// add up to
+std::vector<std::string> write_partitions(const std::string& prefix, int nparts, std::string* whole) {
+    std::vector<std::string> paths;
+    if (whole) *whole = std::string(kHeader) + "\n";
+    for (int p = 0; p < nparts; ++p) {
+        const fs::path path = test_dir() / (prefix + "_" + std::to_string(100 + p) + ".csv");
+        std::ofstream out(path, std::ios::binary);
+        if (p == 2) { paths.push_back(path.string()); continue; } // an empty file
+        const std::string rows = partition_rows(p, 2000 + 370 * p);
+        out << kHeader << (p % 2 ? "\r\n" : "\n") << rows;
+        if (whole) {
+            *whole += rows;
+            if (!rows.empty() && rows.back() != '\n') *whole += '\n';
+        }
+        paths.push_back(path.string());
+    }
+    return paths;
+}
+
+} // end anon
+
+TEST(DatasetTest, PartitionsMatchTheirConcatenation) {
+    std::string whole;
+    const std::vector<std::string> parts = write_partitions("day", 6, &whole);
+    const fs::path wholePath = test_dir() / "whole.csv";
+    std::ofstream(wholePath, std::ios::binary) << whole;
+
+    const fs::path wholeOut = test_dir() / "whole_out";
+    TabularData single(wholePath.string(), wholeOut.string());
+    single.setTypeInference(true);
+    single.scanAndTranspose();
+    const ColumnStore expected(wholeOut.string());
+
+    for (const auto& [threads, mode] : {std::make_pair(1u, tabular::InputMode::Auto),
+                                        std::make_pair(4u, tabular::InputMode::Auto),
+                                        std::make_pair(4u, tabular::InputMode::Stream)}) {
+        const fs::path out = test_dir() / ("parts_out_" + std::to_string(threads));
+        TabularData td(parts, out.string());
+        td.setInputMode(mode);
+        td.setTypeInference(true);
+        td.setThreadCount(threads);
+        td.scanAndTranspose();
+        EXPECT_EQ(td.getColumnCount(), 4u);
+        EXPECT_EQ(td.getHeader(2), "amount, eur");
+        ASSERT_EQ(td.getRowCount(), single.getRowCount());
+        if (threads > 1) {
+            EXPECT_GT(td.metrics().slices.size(), 2u); // morsels cross partitions
+        }
+
+        const ColumnStore store(out.string());
+        ASSERT_EQ(store.rowCount(), expected.rowCount());
+        for (std::uint32_t c = 0; c < 4; ++c) {
+            // one dictionary per column over every partition
+            EXPECT_EQ(store.column(c).type(), expected.column(c).type());
+            EXPECT_EQ(store.column(c).dictionarySize(), expected.column(c).dictionarySize());
+            for (std::uint64_t r = 0; r < store.rowCount(); ++r) {
+                ASSERT_EQ(store.column(c).text(r), expected.column(c).text(r)) << "row " << r << " col " << c;
+            }
+        }
+
+        // every row maps back to its own partition's bytes
+        for (std::uint64_t r = 0; r < td.getRowCount(); r += 7) {
+            const TabularData::RowLocation at = td.rowLocation(r);
+            ASSERT_LT(at.file, parts.size());
+            std::ifstream in(parts[at.file], std::ios::binary);
+            in.seekg(static_cast<std::streamoff>(at.offset));
+            const std::string row(td.getRow(r));
+            std::string bytes(row.size(), '\0');
+            in.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            ASSERT_EQ(bytes, row) << "row " << r;
+        }
+        EXPECT_EQ(td.rowLocation(0).file, 0u);
+        EXPECT_EQ(td.rowLocation(td.getRowCount() - 1).file, parts.size() - 1);
+    }
+}
+
+TEST(DatasetTest, GlobAndMismatchedHeaders) {
+    const std::vector<std::string> parts = write_partitions("glob", 4, nullptr);
+    EXPECT_EQ(tabular::globFiles((test_dir() / "glob_1*.csv").string()), parts);
+    EXPECT_EQ(tabular::globFiles((test_dir() / "glob_10?.csv").string()), parts);
+    EXPECT_TRUE(tabular::globFiles((test_dir() / "nothing_*.csv").string()).empty());
+
+    const fs::path odd = test_dir() / "glob_odd.csv";
+    std::ofstream(odd, std::ios::binary) << "day,city,amount,note\n1,2,3,4\n";
+    std::vector<std::string> mixed = parts;
+    mixed.push_back(odd.string());
+    TabularData td(mixed, (test_dir() / "mixed_out").string());
+    EXPECT_THROW(td.parseHeaderRow(), std::runtime_error);
+}
+
+TEST(DatasetTest, RefreshAddsNewPartitions) {
+    std::vector<std::string> parts = write_partitions("grow", 6, nullptr); // the fifth ends in a line break
+    const std::string last = parts.back();
+    parts.pop_back();
+    const fs::path out = test_dir() / "grow_out";
+    {
+        TabularData td(parts, out.string());
+        td.scanAndTranspose();
+    }
+    parts.push_back(last); // the next day's partition arrives
+    TabularData td(parts, out.string());
+    EXPECT_TRUE(td.refresh());
+    const ColumnStore grown(out.string());
+
+    const fs::path fullOut = test_dir() / "grow_full";
+    TabularData full(parts, fullOut.string());
+    full.scanAndTranspose();
+    const ColumnStore expected(fullOut.string());
+    ASSERT_EQ(grown.rowCount(), expected.rowCount());
+    for (std::uint32_t c = 0; c < 4; ++c) {
+        for (std::uint64_t r = 0; r < expected.rowCount(); ++r) {
+            ASSERT_EQ(grown.column(c).text(r), expected.column(c).text(r)) << "row " << r << " col " << c;
+        }
+    }
+}
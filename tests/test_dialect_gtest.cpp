@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include "TabularData/TabularData.hpp"
+#include "TabularData/ColumnStore.hpp"
+#include "test_util.hpp"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+using tabular::ColumnStore;
+using tabular::Dialect;
+using tabular::TabularData;
+using tabular_test::test_dir;
+
+namespace {
+
+// the same table in any delimiter: quoted cells and a header name hold the
+// delimiter, quoted notes hold quotes and line breaks; a few rows are blank
+fs::path write_table(const std::string& name, char delim) {
+    const fs::path csv = test_dir() / name;
+    std::ofstream out(csv, std::ios::binary);
+    out << "id" << delim << "\"na" << delim << "me\"" << delim << " city " << delim << "note\n";
+    std::mt19937 rng(11);
+    for (int r = 0; r < 3000; ++r) {
+        out << r << delim << "\"n" << delim << r % 7 << "\"" << delim << "c" << rng() % 40 << delim;
+        if (r % 5 == 0) out << "\"say \"\"hi\"\"\nthen " << delim << "go\"";
+        else out << "plain" << r % 11;
+        out << (r % 4 ? "\n" : "\r\n");
+        if (r % 97 == 0) out << "\n";
+    }
+    return csv;
+}
+
+ColumnStore build(const fs::path& csv, const Dialect& dialect, const std::string& outName) {
+    const fs::path outdir = test_dir() / outName;
+    TabularData td(csv.string(), outdir.string(), false);
+    td.setDialect(dialect);
+    td.scanAndTranspose();
+    return ColumnStore(outdir.string());
+}
+
+} // end anon
+
+TEST(DialectTest, TsvAndPipeMatchCsv) {
+    const ColumnStore csv = build(write_table("t.csv", ','), Dialect::csv(), "csv");
+    ASSERT_EQ(csv.rowCount(), 3000u);
+    ASSERT_EQ(csv.columnCount(), 4u);
+    for (const auto& [delim, dialect] : {std::make_pair('\t', Dialect::tsv()), std::make_pair('|', Dialect::pipe()),
+                                         std::make_pair(';', Dialect{';', '"', '\0', '\0'})}) {
+        const fs::path file = write_table(std::string("t_") + (delim == '\t' ? "tab" : delim == '|' ? "pipe" : "semi"), delim);
+        const ColumnStore other = build(file, dialect, std::string("out_") + file.filename().string());
+        ASSERT_EQ(other.rowCount(), csv.rowCount());
+        ASSERT_EQ(other.columnCount(), csv.columnCount());
+        for (std::uint32_t c = 0; c < 4; ++c) {
+            for (std::uint64_t r = 0; r < csv.rowCount(); ++r) {
+                std::string want = csv.column(c).text(r);
+                for (auto& ch : want) if (ch == ',') ch = delim;
+                ASSERT_EQ(other.column(c).text(r), want) << "delimiter " << delim << " row " << r << " col " << c;
+            }
+        }
+
+        TabularData td(file.string(), (test_dir() / "headers").string(), false);
+        td.setDialect(dialect);
+        td.parseHeaderRow();
+        EXPECT_EQ(td.getColumnCount(), 4u);
+        EXPECT_EQ(td.getHeader(0), "id");
+        EXPECT_EQ(td.getHeader(1), std::string("na") + delim + "me");
+        EXPECT_EQ(td.getHeader(2), "city");
+    }
+}
+
+TEST(DialectTest, EscapesAndComments) {
+    const fs::path csv = test_dir() / "escaped.csv";
+    {
+        std::ofstream out(csv, std::ios::binary);
+        out << "# exported by a tool, \"with quotes\n"
+            << "#\r\n"
+            << "k,na\\,me,\"q\\\"\"\n"
+            << "1,a\\,b,\"x\\\"y\"\n"
+            << "# a comment, with, commas\n"
+            << "2,c\\\nd,\"p,\\\n\"\n"
+            << "\n"
+            << "3,#not a comment,z\n";
+    }
+    TabularData td(csv.string(), (test_dir() / "escaped").string(), false);
+    td.setDialect({',', '"', '\\', '#'});
+    td.parseHeaderRow();
+    ASSERT_EQ(td.getColumnCount(), 3u);
+    EXPECT_EQ(td.getHeader(0), "k");
+    EXPECT_EQ(td.getHeader(1), "na,me");
+    EXPECT_EQ(td.getHeader(2), "q\"");
+
+    td.findRowOffsets();
+    ASSERT_EQ(td.getRowCount(), 3u);
+    EXPECT_EQ(td.getCell(0, 1), "a\\,b");
+    EXPECT_EQ(td.getCell(0, 2), "\"x\\\"y\"");
+    EXPECT_EQ(td.getCell(1, 1), "c\\\nd");
+    EXPECT_EQ(td.getCell(1, 2), "\"p,\\\n\"");
+    EXPECT_EQ(td.getCell(2, 1), "#not a comment");
+}
+
+TEST(DialectTest, GenericBoundariesMatchAcrossThreads) {
+    // escaped quotes and line breaks, quoted line breaks and comment rows
+    // spanning many morsels: each morsel's start state comes from composing
+    // the state maps of the morsels before it
+    const fs::path csv = test_dir() / "generic.csv";
+    {
+        std::ofstream out(csv, std::ios::binary);
+        std::mt19937 rng(5);
+        out << "a;b;c\n";
+        for (int r = 0; r < 4000; ++r) {
+            if (r % 50 == 0) out << "#\"unbalanced; comment\\\n";
+            out << r << ";'";
+            const int len = rng() % 4 ? rng() % 30 : rng() % 4000;
+            for (int i = 0; i < len; ++i) {
+                const unsigned k = rng() % 16;
+                out << (k == 0 ? "\n" : k == 1 ? "\\'" : k == 2 ? ";" : k == 3 ? "\r\n" : k == 4 ? "#" : "x");
+            }
+            out << "';" << (rng() % 2 ? "\\\n" : "z") << (r % 3 ? "\n" : "\r\n");
+        }
+    }
+    const Dialect dialect{';', '\'', '\\', '#'};
+    std::vector<std::uint64_t> expected;
+    for (unsigned threads : {1u, 2u, 4u, 7u}) {
+        TabularData td(csv.string(), (test_dir() / "generic").string(), false);
+        td.setDialect(dialect);
+        td.setThreadCount(threads);
+        td.parseHeaderRow();
+        td.findRowOffsets();
+        if (threads == 1) expected = td.rowOffsets();
+        EXPECT_EQ(td.getRowCount(), 4000u);
+        EXPECT_EQ(td.rowOffsets(), expected) << threads << " threads";
+        const tabular::Metrics m = td.metrics();
+        if (threads > 1) {
+            EXPECT_GT(m.slices.size(), 8u);
+        }
+        for (const auto& slice : m.slices) EXPECT_FALSE(slice.reparsed) << threads << " threads";
+    }
+}
+
+TEST(DialectTest, ValidationAndIndexState) {
+    TabularData td((fs::path("tests") / "sample_csv" / "homes.csv").string(),
+                   (test_dir() / "state").string());
+    EXPECT_THROW(td.setDialect({',', ',', '\0', '\0'}), std::invalid_argument);
+    EXPECT_THROW(td.setDialect({'\n', '"', '\0', '\0'}), std::invalid_argument);
+    EXPECT_THROW(td.setDialect({'\0', '"', '\0', '\0'}), std::invalid_argument);
+    EXPECT_THROW(td.setDialect({',', '"', '"', '\0'}), std::invalid_argument);
+    EXPECT_THROW(td.setDialect({',', '"', '\\', '\r'}), std::invalid_argument);
+    EXPECT_NO_THROW(td.setDialect({',', '\0', '\\', '#'}));
+    EXPECT_EQ(td.dialect(), (Dialect{',', '\0', '\\', '#'}));
+
+    // an index built under one dialect isn't extended under another
+    td.setDialect(Dialect::csv());
+    td.scanAndTranspose();
+    EXPECT_TRUE(td.refresh());
+    td.setDialect(Dialect::tsv());
+    EXPECT_FALSE(td.refresh());
+}
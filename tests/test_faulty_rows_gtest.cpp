@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include "TabularData/TabularData.hpp"
+#include "TabularData/ColumnStore.hpp"
+#include "TabularData/FaultyRows.hpp"
+#include "test_util.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+using tabular::ColumnStore;
+using tabular::FaultyRow;
+using tabular::FaultyRowMode;
+using tabular::FaultyRowReport;
+using tabular::FaultyRowsError;
+using tabular::TabularData;
+using tabular_test::test_dir;
+
+namespace {
+
+// 4 columns; every `every`th row from row 5 on has 3 or 6 fields instead.
+// Returns the faulty rows as they should be reported.
+std::vector<FaultyRow> append_table(const fs::path& csv, int first, int last, int every) {
+    std::vector<FaultyRow> faulty;
+    std::ofstream out(csv, std::ios::binary | std::ios::app);
+    if (first == 0) out << "id,city,amount,note\n";
+    out.seekp(0, std::ios::end);
+    std::mt19937 rng(first + 3);
+    for (int r = first; r < last; ++r) {
+        const std::uint64_t at = static_cast<std::uint64_t>(out.tellp());
+        out << r << ",c" << rng() % 40 << "," << rng() % 1000;
+        if (r >= 5 && r % every == 0) {
+            const bool wide = (r / every) % 2;
+            out << (wide ? ",\"x,\ny\",extra,more\n" : "\n");
+            faulty.push_back({at, wide ? 6u : 3u});
+        } else {
+            out << "," << (r % 11 ? "n" + std::to_string(rng() % 90) : std::string("\"a\nb\"")) << "\n";
+        }
+    }
+    return faulty;
+}
+
+void expect_same(const std::vector<FaultyRow>& a, const std::vector<FaultyRow>& b) {
+    ASSERT_EQ(a.size(), b.size());
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        EXPECT_EQ(a[i].offset, b[i].offset) << "entry " << i;
+        EXPECT_EQ(a[i].found, b[i].found) << "entry " << i;
+    }
+}
+
+} // end anon
+
+TEST(FaultyRowsTest, RecordListsEveryFaultyRow) {
+    const fs::path csv = test_dir() / "record.csv";
+    const std::vector<FaultyRow> faulty = append_table(csv, 0, 200000, 997);
+
+    const fs::path skipOut = test_dir() / "skip";
+    TabularData skip(csv.string(), skipOut.string());
+    skip.setThreadCount(4);
+    skip.parseHeaderRow();
+    skip.findRowOffsets();
+    EXPECT_EQ(skip.metrics().faultyRows, faulty.size()); // counted while skipping too
+    EXPECT_FALSE(fs::exists(FaultyRowReport::path(skipOut.string())));
+
+    for (bool fused : {false, true}) {
+        const fs::path out = test_dir() / (fused ? "record_fused" : "record");
+        TabularData td(csv.string(), out.string());
+        td.setThreadCount(4);
+        td.setFaultyRowMode(FaultyRowMode::Record);
+        if (fused) {
+            td.scanAndTranspose();
+            EXPECT_EQ(ColumnStore(out.string()).rowCount(), 200000u - faulty.size());
+        } else {
+            td.parseHeaderRow();
+            td.findRowOffsets();
+        }
+        EXPECT_EQ(td.rowOffsets(), skip.rowOffsets());
+        EXPECT_EQ(td.metrics().faultyRows, faulty.size());
+
+        FaultyRowReport report;
+        ASSERT_TRUE(FaultyRowReport::load(out.string(), report));
+        EXPECT_EQ(report.expected, 4u);
+        expect_same(report.rows, faulty);
+    }
+
+    // switching back to Skip drops the report it would no longer match
+    TabularData td(csv.string(), (test_dir() / "record").string());
+    td.parseHeaderRow();
+    td.findRowOffsets();
+    EXPECT_FALSE(fs::exists(FaultyRowReport::path((test_dir() / "record").string())));
+}
+
+TEST(FaultyRowsTest, FailThrowsAtTheFirstFaultyRow) {
+    const fs::path csv = test_dir() / "fail.csv";
+    const std::vector<FaultyRow> faulty = append_table(csv, 0, 50000, 4001);
+    ASSERT_GE(faulty.size(), 2u);
+
+    TabularData td(csv.string(), (test_dir() / "fail").string());
+    td.setThreadCount(3);
+    td.skipFaultyRows(false);
+    EXPECT_EQ(td.faultyRowMode(), FaultyRowMode::Fail);
+    td.parseHeaderRow();
+    try {
+        td.findRowOffsets();
+        FAIL() << "no exception";
+    } catch (const FaultyRowsError& e) {
+        EXPECT_EQ(e.first().offset, faulty[0].offset);
+        EXPECT_EQ(e.first().found, faulty[0].found);
+        EXPECT_EQ(e.expected(), 4u);
+        EXPECT_EQ(e.count(), 1u);
+        EXPECT_NE(std::string(e.what()).find("offset " + std::to_string(faulty[0].offset)), std::string::npos);
+    }
+    EXPECT_THROW(td.scanAndTranspose(), FaultyRowsError);
+
+    // the object is still usable
+    td.skipFaultyRows(true);
+    td.findRowOffsets();
+    EXPECT_EQ(td.rowOffsets().size(), 50000u - faulty.size());
+}
+
+TEST(FaultyRowsTest, LimitAbortsWithThePartialReport) {
+    const fs::path csv = test_dir() / "limit.csv";
+    const std::vector<FaultyRow> faulty = append_table(csv, 0, 200000, 101);
+    const fs::path out = test_dir() / "limit";
+
+    TabularData td(csv.string(), out.string());
+    td.setThreadCount(4);
+    td.setFaultyRowMode(FaultyRowMode::Record, 50);
+    td.parseHeaderRow();
+    std::uint64_t first = 0;
+    try {
+        td.findRowOffsets();
+        FAIL() << "no exception";
+    } catch (const FaultyRowsError& e) {
+        EXPECT_GT(e.count(), 50u);
+        EXPECT_LT(e.count(), faulty.size()); // stopped early
+        first = e.first().offset;
+    }
+    FaultyRowReport report;
+    ASSERT_TRUE(FaultyRowReport::load(out.string(), report));
+    EXPECT_GT(report.rows.size(), 50u);
+    // the lowest found, not necessarily the file's first: any slice can
+    // be the one that runs past the limit
+    EXPECT_EQ(first, report.rows[0].offset);
+    for (std::size_t i = 0; i < report.rows.size(); ++i) {
+        if (i > 0) {
+            EXPECT_LT(report.rows[i - 1].offset, report.rows[i].offset);
+        }
+        EXPECT_TRUE(std::any_of(faulty.begin(), faulty.end(),
+                                [&](const FaultyRow& f) { return f.offset == report.rows[i].offset; }));
+    }
+
+    // within the limit the scan completes
+    td.setFaultyRowMode(FaultyRowMode::Record, faulty.size());
+    td.findRowOffsets();
+    ASSERT_TRUE(FaultyRowReport::load(out.string(), report));
+    expect_same(report.rows, faulty);
+}
+
+TEST(FaultyRowsTest, RefreshExtendsTheReport) {
+    const fs::path csv = test_dir() / "refresh.csv";
+    std::vector<FaultyRow> faulty = append_table(csv, 0, 3000, 97);
+    const fs::path out = test_dir() / "refresh";
+    {
+        TabularData td(csv.string(), out.string());
+        td.setFaultyRowMode(FaultyRowMode::Record);
+        td.scanAndTranspose();
+    }
+    const std::vector<FaultyRow> added = append_table(csv, 3000, 5000, 97);
+    faulty.insert(faulty.end(), added.begin(), added.end());
+
+    TabularData td(csv.string(), out.string());
+    td.setFaultyRowMode(FaultyRowMode::Record);
+    EXPECT_TRUE(td.refresh());
+    FaultyRowReport report;
+    ASSERT_TRUE(FaultyRowReport::load(out.string(), report));
+    expect_same(report.rows, faulty);
+
+    // a clean file gets an empty report
+    const fs::path clean = test_dir() / "clean.csv";
+    append_table(clean, 0, 4, 97);
+    TabularData c(clean.string(), (test_dir() / "clean").string());
+    c.setFaultyRowMode(FaultyRowMode::Record);
+    c.scanAndTranspose();
+    ASSERT_TRUE(FaultyRowReport::load((test_dir() / "clean").string(), report));
+    EXPECT_TRUE(report.rows.empty());
+}
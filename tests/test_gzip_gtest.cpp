@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include "TabularData/TabularData.hpp"
+#include "TabularData/ColumnStore.hpp"
+#include "TabularData/InputSource.hpp"
+#include "test_util.hpp"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace fs = std::filesystem;
+using tabular::ColumnStore;
+using tabular::TabularData;
+using tabular_test::test_dir;
+
+namespace {
+
+// one gzip member holding `data`
+std::string gzip_member(std::string_view data, int level) {
+    z_stream strm {};
+    if (deflateInit2(&strm, level, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY) != Z_OK) throw std::runtime_error("deflateInit2");
+    std::string out(deflateBound(&strm, static_cast<uLong>(data.size())), '\0');
+    strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    strm.avail_in = static_cast<uInt>(data.size());
+    strm.next_out = reinterpret_cast<Bytef*>(out.data());
+    strm.avail_out = static_cast<uInt>(out.size());
+    deflate(&strm, Z_FINISH);
+    out.resize(strm.total_out);
+    deflateEnd(&strm);
+    return out;
+}
+
+// ~12 MB, several access points' worth: quoted line breaks, CRLF rows
+std::string make_csv() {
+    std::ostringstream out;
+    out << "id,city,\"amount, eur\",note\n";
+    std::mt19937 rng(3);
+    for (int r = 0; r < 360000; ++r) {
+        out << r << ",city" << rng() % 300 << "," << rng() % 100000 << ",";
+        if (r % 13 == 0) out << "\"two\nlines, " << rng() % 1000 << "\"";
+        else out << "n" << rng() << "-" << rng() % 77;
+        out << (r % 5 ? "\n" : "\r\n");
+    }
+    return out.str();
+}
+
+// `data` as consecutive members, cut at `cuts` (ascending); a cut given
+// twice leaves an empty member in between
+std::string gzip_members(std::string_view data, const std::vector<std::size_t>& cuts) {
+    std::string out;
+    std::size_t from = 0;
+    for (std::size_t k = 0; k <= cuts.size(); ++k) {
+        const std::size_t to = k < cuts.size() ? cuts[k] : data.size();
+        out += gzip_member(data.substr(from, to - from), k % 2 ? 1 : 6);
+        from = to;
+    }
+    return out;
+}
+
+void write_file(const fs::path& path, const std::string& bytes) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes;
+}
+
+} // end anon
+
+TEST(GzipTest, MatchesPlainCsv) {
+    const std::string csv = make_csv();
+    const fs::path plain = test_dir() / "plain.csv";
+    write_file(plain, csv);
+    // members split mid-row, as a concatenating compressor writes them: one
+    // 17 bytes long, one ending inside a quoted line break, one between a
+    // CR and its LF, and an empty one
+    const std::size_t inQuotes = csv.find("\"two\n", 6000000) + 5;
+    const std::size_t inCrlf = csv.find("\r\n", 9000000) + 1;
+    const fs::path gz = test_dir() / "table.csv.gz";
+    write_file(gz, gzip_members(csv, {3000001, 3000018, inQuotes, inCrlf, inCrlf}));
+
+    const fs::path plainOut = test_dir() / "plain_out";
+    TabularData single(plain.string(), plainOut.string());
+    single.setTypeInference(true);
+    single.scanAndTranspose();
+    const ColumnStore expected(plainOut.string());
+
+    for (unsigned threads : {1u, 4u}) {
+        const fs::path out = test_dir() / ("gz_out_" + std::to_string(threads));
+        fs::remove_all(out);
+        TabularData td(gz.string(), out.string());
+        td.setTypeInference(true);
+        td.setThreadCount(threads);
+        td.scanAndTranspose();
+        EXPECT_TRUE(fs::exists(out / "input_index.bin"));
+        EXPECT_EQ(td.getHeader(2), "amount, eur");
+        ASSERT_EQ(td.rowOffsets(), single.rowOffsets()) << threads << " threads";
+
+        const ColumnStore store(out.string());
+        ASSERT_EQ(store.rowCount(), expected.rowCount());
+        for (std::uint32_t c = 0; c < 4; ++c) {
+            EXPECT_EQ(store.column(c).type(), expected.column(c).type());
+            for (std::uint64_t r = 0; r < store.rowCount(); r += 3) {
+                ASSERT_EQ(store.column(c).text(r), expected.column(c).text(r)) << "row " << r << " col " << c;
+            }
+        }
+
+        // random fetches resume at the nearest access point
+        std::mt19937 rng(threads);
+        for (int i = 0; i < 200; ++i) {
+            const std::uint64_t r = rng() % td.getRowCount();
+            ASSERT_EQ(td.getRow(r), single.getRow(r)) << "row " << r;
+        }
+    }
+}
+
+TEST(GzipTest, SeekIndexIsReusedAndValidated) {
+    std::string csv = make_csv();
+    const fs::path gz = test_dir() / "indexed.csv.gz";
+    const fs::path index = test_dir() / "indexed.bin";
+    fs::remove(index);
+    write_file(gz, gzip_member(csv, 1));
+
+    auto check = [&](const tabular::InputSource& src) {
+        ASSERT_EQ(src.size(), csv.size());
+        std::mt19937 rng(9);
+        std::vector<char> scratch;
+        for (int i = 0; i < 100; ++i) {
+            const std::uint64_t at = rng() % csv.size();
+            const std::size_t len = (i % 4 ? rng() % 5000 : rng() % (9u << 20)); // some cross access points
+            ASSERT_EQ(src.read(at, len, scratch), std::string_view(csv).substr(at, len)) << "offset " << at;
+        }
+    };
+    check(*tabular::openInputSource(gz.string(), tabular::InputMode::Auto, index.string()));
+    ASSERT_TRUE(fs::exists(index));
+    check(*tabular::openInputSource(gz.string(), tabular::InputMode::Stream, index.string()));
+
+    // a stale index (other bytes under the same name) or a damaged one is rebuilt
+    csv = "a,b\n" + csv;
+    write_file(gz, gzip_member(csv, 1));
+    check(*tabular::openInputSource(gz.string(), tabular::InputMode::Auto, index.string()));
+    fs::resize_file(index, fs::file_size(index) / 2);
+    check(*tabular::openInputSource(gz.string(), tabular::InputMode::Auto, index.string()));
+    check(*tabular::openInputSource(gz.string(), tabular::InputMode::Auto, index.string()));
+}
+
+TEST(GzipTest, TruncatedAndZstdInputsThrow) {
+    const std::string member = gzip_member(make_csv(), 6);
+    const fs::path cut = test_dir() / "cut.csv.gz";
+    write_file(cut, member.substr(0, member.size() / 2));
+    EXPECT_THROW(tabular::openInputSource(cut.string()), std::runtime_error);
+
+    const fs::path zst = test_dir() / "table.csv.zst";
+    write_file(zst, std::string("\x28\xb5\x2f\xfd", 4) + "frame");
+    TabularData td(zst.string(), (test_dir() / "zst_out").string());
+    EXPECT_THROW(td.parseHeaderRow(), std::runtime_error);
+}
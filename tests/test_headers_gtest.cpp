@@ -1,9 +1,11 @@
 #include <gtest/gtest.h>
 #include "TabularData/TabularData.hpp"
+#include "test_util.hpp"
 #include <filesystem>
 
 namespace fs = std::filesystem;
 using tabular::TabularData;
+using tabular_test::test_dir;
 
 TEST(HeaderTest, SimpleCsv) {
     fs::path csv = fs::path("tests/sample_csv/homes.csv");
@@ -14,7 +16,7 @@ TEST(HeaderTest, SimpleCsv) {
     td.parseHeaderRow();
 
     EXPECT_EQ(td.getHeader(0), "Sell");
-    EXPECT_EQ(td.getHeader(1), "List");
+    EXPECT_EQ(td.getHeader(1), "Listing");
     EXPECT_EQ(td.getHeader(2), "Living");
     EXPECT_EQ(td.getHeader(3), "Rooms");
     EXPECT_EQ(td.getHeader(4), "Beds");
@@ -24,3 +26,26 @@ TEST(HeaderTest, SimpleCsv) {
     EXPECT_EQ(td.getHeader(8), "Taxes");
 }
 
+
+TEST(HeaderTest, CachedLookupAndReload) {
+    fs::path csv = fs::path("tests/sample_csv/homes.csv");
+    fs::path outdir = test_dir() / "meta"; // fresh, so the later session can't find a stale index
+
+    {
+        TabularData td(csv.string(), outdir.string());
+        td.parseHeaderRow();
+        EXPECT_EQ(td.getColumnCount(), 9u);
+        EXPECT_EQ(td.findColumn("Beds"), 4);
+        EXPECT_EQ(td.findColumn("Taxes"), 8);
+        EXPECT_EQ(td.findColumn("beds"), -1);
+        EXPECT_THROW(td.getHeader(9), std::out_of_range);
+    }
+
+    // a later session picks the index up from disk: headers.json, then the CSV
+    for (bool standalone : {true, false}) {
+        TabularData td(csv.string(), outdir.string(), standalone);
+        EXPECT_EQ(td.getColumnCount(), 9u);
+        EXPECT_EQ(td.getHeader(1), "Listing");
+        EXPECT_EQ(td.findColumn("Acres"), 7);
+    }
+}
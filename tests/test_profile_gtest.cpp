@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "TabularData/TabularData.hpp"
+#include "TabularData/ColumnStore.hpp"
+#include "test_util.hpp"
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+using tabular::ColumnStore;
+using tabular::ColumnType;
+using tabular::DataProfile;
+using tabular::TabularData;
+using tabular_test::test_dir;
+
+namespace {
+
+// id (unique), city (70 values), amount (integers), note (text, some
+// quoted with an embedded newline)
+fs::path write_table(const std::string& name, int rows) {
+    const fs::path csv = test_dir() / name;
+    std::ofstream out(csv, std::ios::binary);
+    out << "id,city,amount,note\n";
+    std::mt19937 rng(7);
+    for (int r = 0; r < rows; ++r) {
+        out << r << ",c" << rng() % 70 << "," << rng() % 100000 << ",";
+        out << (r % 13 ? "n" + std::to_string(rng() % 900) : std::string("\"a,\nb\"")) << "\n";
+    }
+    return csv;
+}
+
+double relative_error(double estimate, double truth) { return std::fabs(estimate - truth) / truth; }
+
+} // end anon
+
+TEST(ProfileTest, SmallFileIsReadWhole) {
+    const fs::path csv = write_table("small.csv", 2000);
+    TabularData td(csv.string(), (test_dir() / "small").string());
+    td.setTypeInference(true);
+    const DataProfile& p = td.profile();
+    EXPECT_TRUE(p.exact);
+    EXPECT_EQ(p.fileBytes, fs::file_size(csv));
+    EXPECT_EQ(p.sampledRows, 2000u);
+    EXPECT_EQ(p.estimatedRows, 2000u);
+    ASSERT_EQ(p.columns.size(), 4u);
+    EXPECT_EQ(p.columns[0].type, ColumnType::Int64);
+    EXPECT_EQ(p.columns[1].type, ColumnType::String);
+    EXPECT_EQ(p.columns[2].type, ColumnType::Int64);
+    EXPECT_TRUE(p.columns[1].provenString);
+    EXPECT_FALSE(p.columns[0].provenString);
+    EXPECT_LT(relative_error(static_cast<double>(p.columns[0].distinct), 2000), 0.05);
+    EXPECT_LT(relative_error(static_cast<double>(p.columns[1].distinct), 70), 0.05);
+}
+
+TEST(ProfileTest, SampledEstimatesAreClose) {
+    const int rows = 400000; // ~8 MB, four times the sample
+    const fs::path csv = write_table("large.csv", rows);
+    TabularData td(csv.string(), (test_dir() / "large").string());
+    const DataProfile& p = td.profile();
+    EXPECT_FALSE(p.exact);
+    EXPECT_LT(p.sampledBytes, p.fileBytes / 2);
+    EXPECT_LT(relative_error(static_cast<double>(p.estimatedRows), rows), 0.05);
+    EXPECT_LT(relative_error(static_cast<double>(p.columns[0].distinct), rows), 0.25); // unique: grows with the rows
+    EXPECT_LT(relative_error(static_cast<double>(p.columns[1].distinct), 70), 0.1);    // saturated: doesn't
+    EXPECT_LE(p.columns[3].distinct, static_cast<std::uint64_t>(rows));
+    EXPECT_EQ(p.columns[2].type, ColumnType::Int64);
+    EXPECT_EQ(p.columns[3].type, ColumnType::String);
+    EXPECT_NEAR(p.avgRowBytes, static_cast<double>(p.fileBytes) / rows, p.avgRowBytes * 0.05);
+}
+
+TEST(ProfileTest, ProfiledPassesMatchUnprofiledOnes) {
+    const fs::path csv = write_table("match.csv", 150000);
+    const fs::path refOut = test_dir() / "ref";
+    TabularData ref(csv.string(), refOut.string());
+    ref.setThreadCount(3);
+    ref.setTypeInference(true);
+    ref.scanAndTranspose();
+    const ColumnStore expected(refOut.string());
+
+    const fs::path out = test_dir() / "profiled";
+    TabularData td(csv.string(), out.string());
+    td.setThreadCount(3);
+    td.setTypeInference(true);
+    td.profile();
+    td.scanAndTranspose();
+    ASSERT_EQ(td.rowOffsets(), ref.rowOffsets());
+    const ColumnStore store(out.string());
+    ASSERT_EQ(store.rowCount(), expected.rowCount());
+    for (std::uint32_t c = 0; c < 4; ++c) {
+        EXPECT_EQ(store.column(c).type(), expected.column(c).type());
+        for (std::uint64_t r = 0; r < store.rowCount(); r += 7) {
+            ASSERT_EQ(store.column(c).text(r), expected.column(c).text(r)) << "row " << r << " col " << c;
+        }
+    }
+}
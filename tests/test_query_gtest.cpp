@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include "TabularData/TabularData.hpp"
+#include "TabularData/ColumnStore.hpp"
+#include "TabularData/Query.hpp"
+#include "test_util.hpp"
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+
+namespace fs = std::filesystem;
+using tabular::ColumnStore;
+using tabular::Query;
+using tabular::TabularData;
+using tabular_test::test_dir;
+
+namespace {
+
+const char* const kCities[] = {"oslo", "lima", "rome", "kyiv", "bern"};
+
+// rows [first, last) of the CSV
+void append_rows(const fs::path& csv, int first, int last) {
+    std::ofstream out(csv, std::ios::binary | std::ios::app);
+    for (int r = first; r < last; ++r) {
+        out << kCities[r % 5] << "," << (r % 97) - 20 << ",";
+        if (r % 13) out << r % 50 << ".5";
+        out << ",2024-01-" << (r % 28 + 1) / 10 << (r % 28 + 1) % 10
+            << "," << (r % 3 ? "true" : "false") << ",name" << r % 400 << "\n";
+    }
+}
+
+fs::path write_csv() {
+    const fs::path csv = test_dir() / "query.csv";
+    { std::ofstream(csv, std::ios::binary | std::ios::trunc) << "city,n,price,day,flag,name\n"; }
+    append_rows(csv, 0, 1000);
+    return csv;
+}
+
+// store of the CSV, with or without type inference and sorted dictionaries
+ColumnStore build(bool infer, bool sorted = false) {
+    const fs::path outdir = test_dir() / ((infer ? "typed" : "plain") + std::string(sorted ? "_sorted" : ""));
+    TabularData td(write_csv().string(), outdir.string());
+    td.setTypeInference(infer);
+    td.setSortedDictionaries(sorted);
+    td.scanAndTranspose();
+    return ColumnStore(outdir.string());
+}
+
+std::vector<std::uint64_t> brute_force(const ColumnStore& store, const std::function<bool(std::uint64_t)>& keep) {
+    std::vector<std::uint64_t> rows;
+    for (std::uint64_t r = 0; r < store.rowCount(); ++r) {
+        if (keep(r)) rows.push_back(r);
+    }
+    return rows;
+}
+
+} // end anon
+
+TEST(QueryTest, StringPredicates) {
+    for (const auto& [infer, sorted] : {std::pair{false, false}, std::pair{true, false}, std::pair{false, true}}) {
+        const ColumnStore store = build(infer, sorted);
+        EXPECT_EQ(store.column(5).sortedDictionary(), sorted);
+        auto cell = [&](std::uint32_t c, std::uint64_t r) { return store.column(c).text(r); };
+
+        Query eq(store);
+        eq.whereEquals(0, "rome");
+        EXPECT_EQ(eq.rowIds(), brute_force(store, [&](auto r) { return cell(0, r) == "rome"; }));
+        EXPECT_EQ(eq.count(), 200u);
+
+        Query in(store);
+        in.whereIn(0, {"oslo", "bern", "nowhere"}).whereIn(5, {"name1", "name7", "name399"});
+        EXPECT_EQ(in.rowIds(), brute_force(store, [&](auto r) {
+            const std::string c = cell(0, r), n = cell(5, r);
+            return (c == "oslo" || c == "bern") && (n == "name1" || n == "name7" || n == "name399");
+        }));
+
+        Query range(store);
+        range.whereRange(5, "name10", "name19");
+        EXPECT_EQ(range.rowIds(), brute_force(store, [&](auto r) {
+            const std::string n = cell(5, r);
+            return n >= "name10" && n <= "name19";
+        }));
+
+        Query missing(store);
+        missing.whereEquals(0, "paris");
+        EXPECT_EQ(missing.count(), 0u);
+        Query empty(store);
+        empty.whereRange(5, "name2", "name1");
+        EXPECT_EQ(empty.count(), 0u);
+
+        // every value is found under its own id, absent ones nowhere
+        const ColumnStore::Column names = store.column(5);
+        for (std::uint64_t id = 0; id < names.dictionarySize(); ++id) {
+            ASSERT_EQ(names.find(names.value(id)), static_cast<std::int64_t>(id));
+        }
+        EXPECT_EQ(names.find("name"), -1);
+        EXPECT_EQ(names.find("name400"), -1);
+        EXPECT_EQ(names.find(""), -1);
+    }
+}
+
+TEST(QueryTest, TypedPredicates) {
+    const ColumnStore store = build(true);
+    ASSERT_EQ(store.column(1).type(), tabular::ColumnType::Int64);
+    ASSERT_EQ(store.column(2).type(), tabular::ColumnType::Float64);
+    ASSERT_EQ(store.column(3).type(), tabular::ColumnType::Date);
+    ASSERT_EQ(store.column(4).type(), tabular::ColumnType::Bool);
+
+    Query q(store);
+    q.whereRange(1, "-5", "10.5").whereRange(2, "3", "30").whereEquals(4, "true").whereRange(3, "2024-01-05", "2024-01-20");
+    EXPECT_EQ(q.rowIds(), brute_force(store, [&](std::uint64_t r) {
+        const std::int64_t n = store.column(1).int64(r);
+        const double p = store.column(2).float64(r); // NaN when missing: never in range
+        const std::int64_t d = store.column(3).int64(r);
+        return n >= -5 && n <= 10 && p >= 3 && p <= 30 && store.column(4).int64(r) == 1
+            && d >= store.column(3).int64(4) && d <= store.column(3).int64(19);
+    }));
+    EXPECT_GT(q.count(), 0u);
+
+    Query in(store);
+    in.whereIn(1, {"-20", "0", "76", "x"}).whereIn(2, {"0.5", "49.5"});
+    EXPECT_EQ(in.rowIds(), brute_force(store, [&](std::uint64_t r) {
+        const std::int64_t n = store.column(1).int64(r);
+        const double p = store.column(2).float64(r);
+        return (n == -20 || n == 0 || n == 76) && (p == 0.5 || p == 49.5);
+    }));
+
+    Query none(store);
+    none.whereEquals(1, "not a number");
+    EXPECT_EQ(none.count(), 0u);
+}
+
+TEST(QueryTest, ProjectionDecodesMatches) {
+    const ColumnStore store = build(true);
+    Query q(store);
+    q.select({5, 1}).whereEquals(0, "kyiv").whereRange(1, "0", "3");
+    const std::vector<std::uint64_t> rows = q.rowIds();
+    const auto values = q.values();
+    ASSERT_EQ(values.size(), 2u);
+    ASSERT_EQ(values[0].size(), rows.size());
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        EXPECT_EQ(values[0][i], store.column(5).text(rows[i]));
+        EXPECT_EQ(values[1][i], store.column(1).text(rows[i]));
+    }
+    EXPECT_THROW(q.select({6}), std::out_of_range);
+}
+
+TEST(QueryTest, RunsAppendedByRefresh) {
+    // runs that start and end mid-word, one a single row
+    const fs::path csv = test_dir() / "query.csv";
+    const fs::path outdir = test_dir() / "refreshed";
+    { std::ofstream(csv, std::ios::binary | std::ios::trunc) << "city,n,price,day,flag,name\n"; }
+    append_rows(csv, 0, 100);
+    TabularData td(csv.string(), outdir.string());
+    td.setTypeInference(true);
+    td.scanAndTranspose();
+    for (const auto& [first, last] : {std::pair{100, 101}, std::pair{101, 230}, std::pair{230, 300}}) {
+        append_rows(csv, first, last);
+        ASSERT_TRUE(td.refresh());
+    }
+    const ColumnStore store(outdir.string());
+    ASSERT_EQ(store.rowCount(), 300u);
+    ASSERT_EQ(store.column(0).runCount(), 4u);
+    ASSERT_EQ(store.column(2).runCount(), 4u);
+    auto cell = [&](std::uint32_t c, std::uint64_t r) { return store.column(c).text(r); };
+
+    Query eq(store);
+    eq.whereEquals(0, "lima").whereRange(2, "10", "40");
+    EXPECT_EQ(eq.rowIds(), brute_force(store, [&](auto r) {
+        const double p = store.column(2).float64(r);
+        return cell(0, r) == "lima" && p >= 10 && p <= 40;
+    }));
+    EXPECT_GT(eq.count(), 0u);
+
+    Query in(store);
+    in.whereIn(0, {"oslo", "kyiv"}).whereIn(1, {"0", "5", "50"}).whereEquals(4, "true");
+    EXPECT_EQ(in.rowIds(), brute_force(store, [&](auto r) {
+        const std::string c = cell(0, r);
+        const std::int64_t n = store.column(1).int64(r);
+        return (c == "oslo" || c == "kyiv") && (n == 0 || n == 5 || n == 50) && cell(4, r) == "true";
+    }));
+    EXPECT_GT(in.count(), 0u);
+}
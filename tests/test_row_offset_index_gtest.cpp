@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include "TabularData/TabularData.hpp"
+#include "TabularData/RowOffsetIndex.hpp"
+#include "CsvScanner.hpp"
+#include "test_util.hpp"
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace fs = std::filesystem;
+using tabular::RowOffsetIndex;
+using tabular::TabularData;
+using tabular_test::test_dir;
+
+namespace {
+
+void expect_round_trip(const std::vector<std::uint64_t>& offsets) {
+    const std::string path = (test_dir() / "round_trip.bin").string();
+    RowOffsetIndex::write(path, offsets.data(), offsets.size());
+    RowOffsetIndex index(path);
+    ASSERT_EQ(index.rowCount(), offsets.size());
+    EXPECT_EQ(index.decode(), offsets);
+    for (std::size_t i = 0; i < offsets.size(); ++i) {
+        ASSERT_EQ(index.offset(i), offsets[i]) << "row " << i;
+    }
+    EXPECT_THROW(index.offset(offsets.size()), std::out_of_range);
+}
+
+} // end anon
+
+TEST(RowOffsetIndexTest, RoundTrip) {
+    expect_round_trip({});
+    expect_round_trip({17});
+
+    std::vector<std::uint64_t> fixed;             // equal row lengths pack to 0 bits
+    for (std::uint64_t i = 0; i < 1000; ++i) fixed.push_back(10 + 64 * i);
+    expect_round_trip(fixed);
+
+    std::mt19937_64 rng(7);
+    std::vector<std::uint64_t> mixed{3};
+    for (int i = 1; i < 5000; ++i) {
+        const std::uint64_t gap = (i % 997 == 0) ? (1ull << 60) : 1 + rng() % 300;
+        mixed.push_back(mixed.back() + gap);
+    }
+    expect_round_trip(mixed);
+}
+
+TEST(RowOffsetIndexTest, SmallerThanRawOffsets) {
+    std::mt19937_64 rng(11);
+    std::vector<std::uint64_t> offsets{0};
+    for (int i = 1; i < 100000; ++i) offsets.push_back(offsets.back() + 200 + rng() % 100);
+    const std::string path = (test_dir() / "smaller.bin").string();
+    RowOffsetIndex::write(path, offsets.data(), offsets.size());
+    EXPECT_LT(fs::file_size(path) * 5, offsets.size() * sizeof(std::uint64_t));
+}
+
+TEST(RowOffsetIndexTest, ReadsLegacyFlatFile) {
+    const std::vector<std::uint64_t> offsets{5, 40, 41, 900};
+    const std::string path = (test_dir() / "legacy.bin").string();
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(offsets.data()),
+                                                offsets.size() * sizeof(std::uint64_t));
+    RowOffsetIndex index(path);
+    EXPECT_EQ(index.decode(), offsets);
+    EXPECT_EQ(index.offset(3), 900u);
+}
+
+TEST(RowOffsetIndexTest, LoadMatchesScan) {
+    const fs::path outdir = test_dir() / "homes";
+    fs::create_directories(outdir);
+
+    TabularData td("tests/sample_csv/homes.csv", outdir.string());
+    td.parseHeaderRow();
+    td.findRowOffsets();
+    td.flushRowOffsets();
+    const std::vector<std::uint64_t> scanned = td.rowOffsets();
+    ASSERT_EQ(scanned.size(), 50u);
+
+    TabularData reloaded("tests/sample_csv/homes.csv", outdir.string());
+    reloaded.loadRowOffsets();
+    EXPECT_EQ(reloaded.rowOffsets(), scanned);
+    EXPECT_EQ(reloaded.getRowCount(), 50u);
+}
+
+TEST(RowOffsetIndexTest, RowAndCellAccess) {
+    const fs::path csv = test_dir() / "rows.csv";
+    {
+        std::ofstream out(csv, std::ios::binary);
+        out << "id,text,n\r\n";
+        for (int r = 0; r < 5000; ++r) {
+            out << r << ", \"line " << r << "\nnext, " << r % 11 << "\" ," << r * 3;
+            out << (r % 2 ? "\r\n" : "\n");
+        }
+    }
+    for (auto mode : {tabular::InputMode::Mmap, tabular::InputMode::Stream}) {
+        TabularData td(csv.string(), (test_dir() / "rows").string());
+        td.setInputMode(mode);
+        td.parseHeaderRow();
+        td.findRowOffsets();
+        ASSERT_EQ(td.getRowCount(), 5000u);
+
+        EXPECT_EQ(td.getRow(0), "0, \"line 0\nnext, 0\" ,0");
+        EXPECT_EQ(td.getRow(4999), "4999, \"line 4999\nnext, 5\" ,14997");
+        EXPECT_EQ(td.getCell(7, 0), "7");
+        EXPECT_EQ(td.getCell(7, 1), "\"line 7\nnext, 7\"");
+        EXPECT_EQ(td.getCell(7, 2), "21");
+        EXPECT_THROW(td.getRow(5000), std::out_of_range);
+        EXPECT_THROW(td.getCell(0, 3), std::out_of_range);
+
+        std::mt19937_64 rng(42);
+        std::vector<std::uint64_t> rows(300);
+        for (auto& r : rows) r = rng() % 5000;
+        std::vector<std::string> expected;
+        for (auto r : rows) expected.emplace_back(td.getRow(r));
+        std::vector<std::string_view> got;
+        td.getRows(rows.data(), rows.size(), got);
+        ASSERT_EQ(got.size(), rows.size());
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            EXPECT_EQ(got[i], expected[i]) << "row " << rows[i];
+        }
+    }
+}
+
+TEST(RowOffsetIndexTest, QuotedFieldsSpanningMorsels) {
+    // quoted fields with line breaks, commas and "" that are often longer
+    // than a morsel, so most morsel boundaries fall inside one
+    const fs::path csv = test_dir() / "quoted.csv";
+    std::vector<std::uint64_t> expected;
+    {
+        std::ofstream out(csv, std::ios::binary);
+        std::mt19937 rng(11);
+        std::string text = "id,note,tail\n";
+        for (int r = 0; r < 400; ++r) {
+            expected.push_back(text.size());
+            text += std::to_string(r) + ",\"";
+            const int len = (r % 4 == 0) ? 200000 + static_cast<int>(rng() % 9000) : static_cast<int>(rng() % 50);
+            for (int i = 0; i < len; ++i) {
+                const unsigned k = rng() % 16;
+                text += k == 0 ? "\n" : k == 1 ? "\"\"" : k == 2 ? "," : k == 3 ? "\r\n" : "x";
+            }
+            text += (r % 3) ? "\",t\n" : "\",t\r\n";
+        }
+        out << text;
+    }
+
+    for (unsigned threads : {1u, 2u, 4u, 7u}) {
+        TabularData td(csv.string(), (test_dir() / "quoted_out").string(), false);
+        td.setThreadCount(threads);
+        td.setWriteRowOffsets(false);
+        td.parseHeaderRow();
+        td.findRowOffsets();
+        EXPECT_EQ(td.rowOffsets(), expected) << threads << " threads";
+
+        const tabular::Metrics m = td.metrics();
+        EXPECT_GT(m.slices.size(), 1u);
+        for (const auto& s : m.slices) EXPECT_FALSE(s.reparsed) << threads << " threads, slice at " << s.begin;
+    }
+}
+
+TEST(RowOffsetIndexTest, ClassifiersMatchScalar) {
+    // random blocks weighted towards the bytes with a role, plus high bytes
+    const tabular::ClassifyFn scalar = tabular::classifierNamed("scalar");
+    ASSERT_NE(scalar, nullptr);
+    const char special[] = {'"', ',', ';', '\r', '\n', ' ', '\t', '\0',
+                            '\x80', '\x9f', '\xa0', '\xc3', '\xff'};
+    std::mt19937 rng(6);
+    for (const char* name : {"sse2", "avx2", "neon"}) {
+        const tabular::ClassifyFn fn = tabular::classifierNamed(name);
+        if (!fn) continue;
+        for (int block = 0; block < 2000; ++block) {
+            char bytes[64];
+            for (char& b : bytes) {
+                b = (rng() % 2) ? special[rng() % sizeof special] : static_cast<char>(rng() % 256);
+            }
+            for (const auto& [delimiter, quote] : {std::pair{',', '"'}, std::pair{';', '\''}, std::pair{'\t', '\0'}}) {
+                tabular::BlockMasks want, got;
+                scalar(bytes, delimiter, quote, want);
+                fn(bytes, delimiter, quote, got);
+                const std::string at = std::string(name) + ", block " + std::to_string(block);
+                ASSERT_EQ(got.quote, want.quote) << at;
+                ASSERT_EQ(got.delimiter, want.delimiter) << at;
+                ASSERT_EQ(got.cr, want.cr) << at;
+                ASSERT_EQ(got.lf, want.lf) << at;
+                ASSERT_EQ(got.nonBlank, want.nonBlank) << at;
+            }
+        }
+    }
+}
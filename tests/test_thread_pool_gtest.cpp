@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include "TabularData/TabularData.hpp"
+#include "TabularData/ColumnStore.hpp"
+#include "TabularData/ThreadPool.hpp"
+#include "test_util.hpp"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+using tabular::ColumnStore;
+using tabular::TabularData;
+using tabular::ThreadPool;
+using tabular_test::test_dir;
+
+namespace {
+
+// `rows` rows with quoted line breaks; the amount of row `textAt` (if any)
+// is text, so the column is typed in every morsel but the one holding it
+fs::path write_table(int rows = 60000, int textAt = -1) {
+    const fs::path csv = test_dir() / "table.csv";
+    std::ofstream out(csv, std::ios::binary);
+    out << "id,city,\"amount, eur\",note\n";
+    std::mt19937 rng(21);
+    for (int r = 0; r < rows; ++r) {
+        out << r << ",c" << rng() % 70 << ",";
+        if (r == textAt) out << "many";
+        else out << rng() % 100000;
+        out << "," << (r % 17 ? "n" + std::to_string(rng() % 90) : std::string("\"a\nb\"")) << "\n";
+    }
+    return csv;
+}
+
+} // end anon
+
+TEST(ThreadPoolTest, RunsEveryLaneOnceAndRethrowsTheFirstError) {
+    ThreadPool pool(3);
+    EXPECT_EQ(pool.size(), 3u);
+    for (unsigned lanes : {0u, 1u, 2u, 3u, 17u}) {
+        std::vector<std::atomic<int>> hits(lanes);
+        pool.run(lanes, [&](unsigned lane) { ++hits[lane]; });
+        for (auto& h : hits) EXPECT_EQ(h.load(), 1);
+    }
+
+    std::atomic<int> ran{0};
+    try {
+        pool.run(8, [&](unsigned lane) {
+            ++ran;
+            if (lane == 5 || lane == 3) throw std::runtime_error("lane " + std::to_string(lane));
+        });
+        FAIL() << "no exception";
+    } catch (const std::runtime_error& e) {
+        EXPECT_STREQ(e.what(), "lane 3");
+    }
+    EXPECT_EQ(ran.load(), 8); // the other lanes still ran
+
+    ThreadPool single(1);
+    int sum = 0;
+    single.run(4, [&](unsigned lane) { sum += static_cast<int>(lane); }); // all on the caller
+    EXPECT_EQ(sum, 6);
+}
+
+TEST(ThreadPoolTest, NestedRunsAndConcurrentCallers) {
+    ThreadPool pool(2, true);
+    std::atomic<int> total{0};
+    auto work = [&] {
+        pool.run(4, [&](unsigned) {
+            pool.run(3, [&](unsigned lane) { total += static_cast<int>(lane) + 1; });
+        });
+    };
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 4; ++i) callers.emplace_back(work);
+    for (auto& t : callers) t.join();
+    EXPECT_EQ(total.load(), 4 * 4 * 6);
+}
+
+TEST(ThreadPoolTest, SharedAndOwnedPoolsMatchEachOther) {
+    const fs::path csv = write_table();
+    const fs::path refOut = test_dir() / "ref";
+    TabularData ref(csv.string(), refOut.string());
+    ref.setThreadCount(1);
+    ref.setTypeInference(true);
+    ref.scanAndTranspose();
+    const ColumnStore expected(refOut.string());
+
+    const auto shared = std::make_shared<ThreadPool>(3);
+    for (int i = 0; i < 3; ++i) {
+        const fs::path out = test_dir() / ("shared_" + std::to_string(i));
+        TabularData td(csv.string(), out.string());
+        td.setThreadPool(shared);
+        td.setThreadCount(4 + i); // more lanes than the pool has threads
+        td.setTypeInference(true);
+        td.scanAndTranspose();
+        EXPECT_EQ(&td.threadPool(), shared.get());
+        ASSERT_EQ(td.rowOffsets(), ref.rowOffsets());
+        const ColumnStore store(out.string());
+        ASSERT_EQ(store.rowCount(), expected.rowCount());
+        for (std::uint32_t c = 0; c < 4; ++c) {
+            for (std::uint64_t r = 0; r < store.rowCount(); r += 11) {
+                ASSERT_EQ(store.column(c).text(r), expected.column(c).text(r)) << "row " << r << " col " << c;
+            }
+        }
+    }
+
+    // an owned pool is kept across calls and follows the thread count
+    TabularData td(csv.string(), (test_dir() / "owned").string());
+    td.setThreadCount(3);
+    ThreadPool& first = td.threadPool();
+    EXPECT_EQ(first.size(), 3u);
+    td.findRowOffsets();
+    EXPECT_EQ(&td.threadPool(), &first);
+    td.setThreadCount(2);
+    EXPECT_EQ(td.threadPool().size(), 2u);
+    td.setThreadPool(nullptr);
+    EXPECT_EQ(td.threadPool().size(), 2u);
+}
+
+TEST(ThreadPoolTest, TransposeMorselsOutnumberTheLanes) {
+    // enough rows for several morsels per lane; the amounts turn to text
+    // near the end, so the other morsels' typed runs are re-encoded
+    const fs::path csv = write_table(150000, 140001);
+
+    for (bool sorted : {false, true}) {
+        auto transpose = [&](const fs::path& out, unsigned threads) {
+            TabularData td(csv.string(), out.string());
+            td.setThreadCount(threads);
+            td.setTypeInference(true);
+            td.setSortedDictionaries(sorted);
+            td.parseHeaderRow();
+            td.findRowOffsets();
+            td.mapIntTranspose();
+            return td.metrics();
+        };
+        const std::string suffix = sorted ? "_sorted" : "";
+        transpose(test_dir() / ("one" + suffix), 1);
+        const tabular::Metrics m = transpose(test_dir() / ("two" + suffix), 2);
+        EXPECT_GT(m.phase(tabular::Phase::TransposeChunk).calls, 2u); // morsels, not one range per lane
+        ASSERT_EQ(m.chunks.size(), 1u);
+
+        const ColumnStore expected((test_dir() / ("one" + suffix)).string());
+        const ColumnStore store((test_dir() / ("two" + suffix)).string());
+        ASSERT_EQ(store.rowCount(), 150000u);
+        EXPECT_EQ(store.column(2).type(), tabular::ColumnType::String);
+        for (std::uint32_t c = 0; c < 4; ++c) {
+            ASSERT_EQ(store.column(c).type(), expected.column(c).type());
+            for (std::uint64_t r = 0; r < store.rowCount(); r += 7) {
+                ASSERT_EQ(store.column(c).text(r), expected.column(c).text(r)) << "row " << r << " col " << c;
+                if (store.column(c).type() == tabular::ColumnType::String && sorted) {
+                    ASSERT_EQ(store.column(c).id(r), expected.column(c).id(r)) << "row " << r << " col " << c;
+                }
+            }
+        }
+    }
+}
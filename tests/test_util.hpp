@@ -0,0 +1,29 @@
+#pragma once
+// Test infrastructure shared by the gtest suites. gtest_discover_tests runs
+// every TEST as its own process and ctest may run them in parallel, so
+// whatever a test writes goes under test_dir(), a directory no other test
+// uses. The tables themselves are each suite's own.
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+
+namespace tabular_test {
+
+namespace fs = std::filesystem;
+
+// <tmp>/tabular_tests/<suite>.<test>, emptied the first time a test asks
+inline fs::path test_dir() {
+    const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+    const std::string name = info ? std::string(info->test_suite_name()) + "." + info->name() : "no_test";
+    const fs::path dir = fs::temp_directory_path() / "tabular_tests" / name;
+    static std::string cleared;
+    if (cleared != name) {
+        std::error_code ec;
+        fs::remove_all(dir, ec);
+        cleared = name;
+    }
+    fs::create_directories(dir);
+    return dir;
+}
+
+} // namespace tabular_test
@@ -0,0 +1,435 @@
+// tabular: command-line driver over the library, for batch jobs and for
+// recording throughput baselines. Every command ends with a report of
+// what the passes did on stderr (stdout carries only the command's data).
+//
+//   tabular transpose -t 16 -m 2G --infer-types -o out data.csv
+//   tabular query -o out --where city=Oslo --select id,amount --limit 0
+//
+// Run `tabular help` for the full usage.
+#include "TabularData/ColumnStore.hpp"
+#include "TabularData/Query.hpp"
+#include "TabularData/TabularData.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace tabular;
+
+namespace {
+
+const char* const kUsage =
+    "usage: tabular <command> [options] [<csv>...]\n"
+    "\n"
+    "commands:\n"
+    "  index       find the row offsets of <csv> (output/row_offsets.bin)\n"
+    "  transpose   index <csv> and write its column store (output/columns/);\n"
+    "              with --refresh, only scan what was appended since the last run\n"
+    "  stat        profile a sample of <csv>, and summarize the column store\n"
+    "              when the output directory has one\n"
+    "  fetch-row   print rows of an indexed <csv>: --rows 0,7,100-120\n"
+    "  query       filter the column store of the output directory, no <csv>\n"
+    "              needed (give it to select columns by header name)\n"
+    "\n"
+    "options:\n"
+    "  -o, --output DIR          output directory (default: output)\n"
+    "  -t, --threads N           worker threads, 0 = all cores (default)\n"
+    "  -m, --memory-budget SIZE  bytes per transpose column chunk, K/M/G suffix\n"
+    "      --dialect NAME        csv (default), tsv or pipe\n"
+    "      --delimiter C         field delimiter; \\t for a tab\n"
+    "      --quote C             quote byte; '' for none\n"
+    "      --escape C            escape byte (default: quotes are doubled)\n"
+    "      --comment C           skip rows starting with this byte\n"
+    "      --input MODE          auto (default), mmap or stream\n"
+    "      --infer-types         store int / float / bool / date columns natively\n"
+    "      --sorted-ids          assign dictionary ids in value order\n"
+    "      --strict              fail on a row with the wrong field count\n"
+    "      --record-faults       list rows with the wrong field count in\n"
+    "                            output/faulty_rows.bin (default: skip them)\n"
+    "      --max-faults N        with --record-faults, fail past N of them\n"
+    "      --refresh             transpose: extend an earlier run\n"
+    "      --rows LIST           fetch-row: rows and ranges, e.g. 0,7,100-120\n"
+    "      --where COL=V         query: equals V; COL=A|B|C any of; COL=LO..HI range\n"
+    "      --select COLS         query: columns to print (default: all)\n"
+    "      --count               query: print only the number of matches\n"
+    "      --limit N             query: print at most N rows, 0 = all (default 20)\n"
+    "      --metrics-json FILE   also write the pass metrics as JSON\n"
+    "  -q, --quiet               no report on stderr\n"
+    "\n"
+    "exit status: 0 done, 1 failed, 2 bad usage, 3 stopped on faulty rows\n"
+    "(--strict, or more than --max-faults)\n";
+
+struct UsageError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+struct Options {
+    std::string command;
+    std::vector<std::string> inputs;
+    std::string output = "output";
+    unsigned threads = 0;
+    std::size_t memoryBudget = 0;
+    Dialect dialect;
+    InputMode inputMode = InputMode::Auto;
+    bool inferTypes = false;
+    bool sortedIds = false;
+    bool strict = false;
+    bool recordFaults = false;
+    std::uint64_t maxFaults = 0;
+    bool refresh = false;
+    bool count = false;
+    bool quiet = false;
+    std::size_t limit = 20;
+    std::string rows;
+    std::vector<std::string> where;
+    std::string select;
+    std::string metricsJson;
+};
+
+std::uint64_t parse_number(const std::string& text, const char* what) {
+    std::size_t used = 0;
+    unsigned long long v = 0;
+    try {
+        v = std::stoull(text, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != text.size() || text[0] == '-') throw UsageError(std::string("bad ") + what + ": " + text);
+    return v;
+}
+
+// "512M" -> 536870912
+std::size_t parse_size(std::string text) {
+    std::uint64_t scale = 1;
+    if (!text.empty()) {
+        switch (text.back()) {
+            case 'k': case 'K': scale = 1ull << 10; break;
+            case 'm': case 'M': scale = 1ull << 20; break;
+            case 'g': case 'G': scale = 1ull << 30; break;
+            default: break;
+        }
+        if (scale != 1) text.pop_back();
+    }
+    return static_cast<std::size_t>(parse_number(text, "size") * scale);
+}
+
+// one byte, "\t" for a tab, "" for none
+char parse_byte(const std::string& text, const char* what) {
+    if (text.empty()) return '\0';
+    if (text == "\\t") return '\t';
+    if (text.size() != 1) throw UsageError(std::string("bad ") + what + ": " + text);
+    return text[0];
+}
+
+Options parse_options(int argc, char** argv) {
+    if (argc < 2) throw UsageError("no command");
+    Options o;
+    o.command = argv[1];
+    static const char* const commands[] = {"index", "transpose", "stat", "fetch-row", "query"};
+    if (std::none_of(std::begin(commands), std::end(commands), [&](const char* c) { return o.command == c; })) {
+        throw UsageError("unknown command: " + o.command);
+    }
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw UsageError(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "-o" || arg == "--output") o.output = value();
+        else if (arg == "-t" || arg == "--threads") o.threads = static_cast<unsigned>(parse_number(value(), "thread count"));
+        else if (arg == "-m" || arg == "--memory-budget") o.memoryBudget = parse_size(value());
+        else if (arg == "--dialect") {
+            const std::string name = value();
+            if (name == "csv") o.dialect = Dialect::csv();
+            else if (name == "tsv") o.dialect = Dialect::tsv();
+            else if (name == "pipe") o.dialect = Dialect::pipe();
+            else throw UsageError("unknown dialect: " + name);
+        }
+        else if (arg == "--delimiter") o.dialect.delimiter = parse_byte(value(), "delimiter");
+        else if (arg == "--quote") o.dialect.quote = parse_byte(value(), "quote");
+        else if (arg == "--escape") o.dialect.escape = parse_byte(value(), "escape");
+        else if (arg == "--comment") o.dialect.comment = parse_byte(value(), "comment");
+        else if (arg == "--input") {
+            const std::string mode = value();
+            if (mode == "auto") o.inputMode = InputMode::Auto;
+            else if (mode == "mmap") o.inputMode = InputMode::Mmap;
+            else if (mode == "stream") o.inputMode = InputMode::Stream;
+            else throw UsageError("unknown input mode: " + mode);
+        }
+        else if (arg == "--infer-types") o.inferTypes = true;
+        else if (arg == "--sorted-ids") o.sortedIds = true;
+        else if (arg == "--strict") o.strict = true;
+        else if (arg == "--record-faults") o.recordFaults = true;
+        else if (arg == "--max-faults") o.maxFaults = parse_number(value(), "fault limit");
+        else if (arg == "--refresh") o.refresh = true;
+        else if (arg == "--rows") o.rows = value();
+        else if (arg == "--where") o.where.push_back(value());
+        else if (arg == "--select") o.select = value();
+        else if (arg == "--count") o.count = true;
+        else if (arg == "--limit") o.limit = static_cast<std::size_t>(parse_number(value(), "limit"));
+        else if (arg == "--metrics-json") o.metricsJson = value();
+        else if (arg == "-q" || arg == "--quiet") o.quiet = true;
+        else if (arg.size() > 1 && arg[0] == '-') throw UsageError("unknown option: " + arg);
+        else o.inputs.push_back(arg);
+    }
+    if (o.strict && o.recordFaults) throw UsageError("--strict and --record-faults exclude each other");
+    if (o.maxFaults && !o.recordFaults) throw UsageError("--max-faults needs --record-faults");
+    o.dialect.validate();
+    return o;
+}
+
+std::vector<std::string> split(const std::string& text, char sep) {
+    std::vector<std::string> parts;
+    std::size_t from = 0;
+    for (std::size_t at; (at = text.find(sep, from)) != std::string::npos; from = at + 1) {
+        parts.push_back(text.substr(from, at - from));
+    }
+    parts.push_back(text.substr(from));
+    return parts;
+}
+
+std::unique_ptr<TabularData> open_table(const Options& o) {
+    if (o.inputs.empty()) throw UsageError(o.command + " needs a <csv>");
+    fs::create_directories(o.output);
+    auto td = o.inputs.size() == 1 ? std::make_unique<TabularData>(o.inputs[0], o.output)
+                                   : std::make_unique<TabularData>(o.inputs, o.output);
+    td->setThreadCount(o.threads);
+    td->setMemoryBudget(o.memoryBudget);
+    td->setDialect(o.dialect);
+    td->setInputMode(o.inputMode);
+    td->setTypeInference(o.inferTypes);
+    td->setSortedDictionaries(o.sortedIds);
+    td->setFaultyRowMode(o.strict ? FaultyRowMode::Fail : o.recordFaults ? FaultyRowMode::Record : FaultyRowMode::Skip,
+                         o.maxFaults);
+    return td;
+}
+
+const char* type_name(ColumnType type) {
+    switch (type) {
+        case ColumnType::String:  return "string";
+        case ColumnType::Int64:   return "int64";
+        case ColumnType::Float64: return "float64";
+        case ColumnType::Bool:    return "bool";
+        case ColumnType::Date:    return "date";
+    }
+    return "unknown";
+}
+
+// column by index, or by header name when the CSV is known
+std::uint32_t resolve_column(const std::string& name, const TabularData* td, std::uint32_t ncols) {
+    std::int64_t col = -1;
+    if (!name.empty() && std::all_of(name.begin(), name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        col = static_cast<std::int64_t>(parse_number(name, "column"));
+    } else if (td) {
+        col = td->findColumn(name);
+    }
+    if (col < 0 || col >= static_cast<std::int64_t>(ncols)) throw UsageError("no such column: " + name);
+    return static_cast<std::uint32_t>(col);
+}
+
+// ------------------------------- commands --------------------------------
+
+void run_index(const Options&, TabularData& td) {
+    td.parseHeaderRow();
+    td.findRowOffsets();
+    td.flushRowOffsets();
+    std::cout << td.getRowCount() << " rows, " << td.getColumnCount() << " columns\n";
+}
+
+void run_transpose(const Options& o, TabularData& td) {
+    if (o.refresh) {
+        const bool extended = td.refresh();
+        std::cout << (extended ? "extended" : "rebuilt") << ": ";
+    } else {
+        td.scanAndTranspose();
+    }
+    std::cout << td.getRowCount() << " rows, " << td.getColumnCount() << " columns\n";
+}
+
+void run_stat(const Options& o, TabularData& td) {
+    const DataProfile& p = td.profile();
+    std::cout << "input        " << p.fileBytes << " bytes\n"
+              << "rows         " << (p.exact ? "" : "~") << p.estimatedRows
+              << " (" << p.sampledRows << " sampled, " << p.avgRowBytes << " bytes each)\n"
+              << "columns      " << p.columns.size() << "\n";
+    std::cout << "\n  #  name                     type      distinct    bytes\n";
+    for (std::size_t c = 0; c < p.columns.size(); ++c) {
+        const DataProfile::Column& col = p.columns[c];
+        char line[160];
+        std::snprintf(line, sizeof(line), "%3zu  %-24.24s %-8s %s%-10llu %6.1f\n", c, td.getHeader(c).c_str(),
+                      type_name(col.type), p.exact ? " " : "~", static_cast<unsigned long long>(col.distinct), col.avgBytes);
+        std::cout << line;
+    }
+    if (!o.quiet) std::cerr << "profiled in " << p.seconds << " s\n";
+
+    if (!fs::exists(fs::path(td.outputDir()) / "columns" / "manifest.bin")) return;
+    const ColumnStore store(td.outputDir());
+    std::cout << "\ncolumn store " << store.rowCount() << " rows, " << store.columnCount() << " columns, "
+              << store.chunkCount() << " chunks\n";
+    std::cout << "\n  #  type      width  dictionary\n";
+    for (std::uint32_t c = 0; c < store.columnCount(); ++c) {
+        const ColumnStore::Column col = store.column(c);
+        char line[96];
+        std::snprintf(line, sizeof(line), "%3u  %-8s  %5u  %llu\n", c, type_name(col.type()), col.width(),
+                      static_cast<unsigned long long>(col.dictionarySize()));
+        std::cout << line;
+    }
+}
+
+void run_fetch_rows(const Options& o, TabularData& td) {
+    if (o.rows.empty()) throw UsageError("fetch-row needs --rows");
+    td.loadRowOffsets();
+    std::vector<std::uint64_t> rows;
+    for (const std::string& part : split(o.rows, ',')) {
+        const std::size_t dash = part.find('-');
+        const std::uint64_t lo = parse_number(part.substr(0, dash), "row");
+        const std::uint64_t hi = dash == std::string::npos ? lo : parse_number(part.substr(dash + 1), "row");
+        if (lo > hi) throw UsageError("bad row range: " + part);
+        if (hi >= td.getRowCount()) {
+            throw UsageError("row " + std::to_string(hi) + " out of range (" + std::to_string(td.getRowCount()) + " rows)");
+        }
+        for (std::uint64_t r = lo; r <= hi; ++r) rows.push_back(r);
+    }
+    std::vector<std::string_view> out;
+    td.getRows(rows.data(), rows.size(), out);
+    for (std::string_view row : out) std::cout << row << '\n';
+}
+
+// matches of the query, for the report
+std::uint64_t run_query(const Options& o, const ColumnStore& store, const TabularData* td) {
+    Query q(store);
+    for (const std::string& w : o.where) {
+        const std::size_t eq = w.find('=');
+        if (eq == std::string::npos) throw UsageError("bad --where: " + w);
+        const std::uint32_t col = resolve_column(w.substr(0, eq), td, store.columnCount());
+        const std::string value = w.substr(eq + 1);
+        const std::size_t dots = value.find("..");
+        if (dots != std::string::npos) q.whereRange(col, value.substr(0, dots), value.substr(dots + 2));
+        else if (value.find('|') != std::string::npos) q.whereIn(col, split(value, '|'));
+        else q.whereEquals(col, value);
+    }
+    std::vector<std::uint32_t> columns;
+    if (!o.select.empty()) {
+        for (const std::string& name : split(o.select, ',')) columns.push_back(resolve_column(name, td, store.columnCount()));
+    } else {
+        for (std::uint32_t c = 0; c < store.columnCount(); ++c) columns.push_back(c);
+    }
+    q.select(columns);
+
+    if (o.count) {
+        const std::uint64_t n = q.count();
+        std::cout << n << '\n';
+        return n;
+    }
+    const std::vector<std::uint64_t> ids = q.rowIds();
+    const std::size_t shown = o.limit == 0 ? ids.size() : std::min(o.limit, ids.size());
+    for (std::size_t i = 0; i < shown; ++i) {
+        std::cout << ids[i];
+        for (std::uint32_t c : columns) std::cout << ',' << store.column(c).text(ids[i]);
+        std::cout << '\n';
+    }
+    return ids.size();
+}
+
+// -------------------------------- report ---------------------------------
+
+double rate(double amount, double seconds) { return seconds > 0 ? amount / seconds : 0; }
+
+// Per phase: its time, and the input bytes and rows over that time. Worker
+// phases sum their threads' time, so their rate is per thread and the
+// elapsed column divides by the lanes.
+void report(const Metrics& m, std::uint64_t inputBytes, unsigned lanes, double seconds) {
+    std::fprintf(stderr, "\n%-17s %6s %10s %10s %10s %10s %10s\n",
+                 "phase", "calls", "wall s", "cpu s", "elapsed s", "GB/s", "Mrows/s");
+    for (std::size_t p = 0; p < kPhaseCount; ++p) {
+        const Phase phase = static_cast<Phase>(p);
+        const Metrics::PhaseStats& s = m.phase(phase);
+        if (s.calls == 0) continue;
+        const bool worker = phase == Phase::Resync || phase == Phase::SliceParse || phase == Phase::TransposeChunk;
+        const double elapsed = worker ? s.wallSeconds / lanes : s.wallSeconds;
+        std::fprintf(stderr, "%-17s %6llu %10.4f %10.4f %10.4f %10.3f %10.3f\n", phaseName(phase),
+                     static_cast<unsigned long long>(s.calls), s.wallSeconds, s.cpuSeconds, elapsed,
+                     rate(static_cast<double>(inputBytes), elapsed) / 1e9, rate(static_cast<double>(m.rows), elapsed) / 1e6);
+    }
+    auto total = [&](const char* name, double wall) {
+        if (wall <= 0) return;
+        std::fprintf(stderr, "%-17s %6s %10.4f %10s %10.4f %10.3f %10.3f\n", name, "", wall, "", wall,
+                     rate(static_cast<double>(inputBytes), wall) / 1e9, rate(static_cast<double>(m.rows), wall) / 1e6);
+    };
+    total("scan", m.scanSeconds);
+    total("transpose", m.transposeSeconds);
+    total("command", seconds);
+    std::fprintf(stderr, "%llu bytes, %llu rows, %u threads", static_cast<unsigned long long>(inputBytes),
+                 static_cast<unsigned long long>(m.rows), lanes);
+    if (m.faultyRows) std::fprintf(stderr, ", %llu faulty rows", static_cast<unsigned long long>(m.faultyRows));
+    if (m.peakRssBytes) std::fprintf(stderr, ", peak RSS %.1f MiB", static_cast<double>(m.peakRssBytes) / (1 << 20));
+    std::fprintf(stderr, "\n");
+}
+
+int run(const Options& o) {
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+    if (o.command == "query") {
+        const std::unique_ptr<TabularData> td = o.inputs.empty() ? nullptr : open_table(o);
+        const ColumnStore store(o.output);
+        const std::uint64_t matches = run_query(o, store, td.get());
+        const double seconds = elapsed();
+        if (!o.quiet) {
+            std::fprintf(stderr, "\n%llu of %llu rows matched in %.4f s, %.3f Mrows/s scanned\n",
+                         static_cast<unsigned long long>(matches), static_cast<unsigned long long>(store.rowCount()),
+                         seconds, rate(static_cast<double>(store.rowCount()), seconds) / 1e6);
+        }
+        return 0;
+    }
+
+    const std::unique_ptr<TabularData> td = open_table(o);
+    if (o.command == "index") run_index(o, *td);
+    else if (o.command == "transpose") run_transpose(o, *td);
+    else if (o.command == "stat") run_stat(o, *td);
+    else run_fetch_rows(o, *td);
+    const double seconds = elapsed();
+
+    const Metrics m = td->metrics();
+    if (!o.metricsJson.empty()) {
+        std::ofstream out(o.metricsJson, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Failed to open " + o.metricsJson);
+        out << m.toJson();
+    }
+    if (o.quiet || o.command == "stat") return 0; // stat reports the profile's time itself
+    if (o.command == "fetch-row") std::fprintf(stderr, "\nfetched in %.4f s\n", seconds);
+    else report(m, td->input().size(), td->threadCount(), seconds);
+    return 0;
+}
+
+} // end anon
+
+int main(int argc, char** argv) {
+    if (argc == 2 && (std::strcmp(argv[1], "help") == 0 || std::strcmp(argv[1], "--help") == 0 || std::strcmp(argv[1], "-h") == 0)) {
+        std::cout << kUsage;
+        return 0;
+    }
+    try {
+        return run(parse_options(argc, argv));
+    } catch (const UsageError& e) {
+        std::cerr << "tabular: " << e.what() << "\n\n" << kUsage;
+        return 2;
+    } catch (const FaultyRowsError& e) {
+        std::cerr << "tabular: " << e.what() << '\n';
+        return 3;
+    } catch (const std::exception& e) {
+        std::cerr << "tabular: " << e.what() << '\n';
+        return 1;
+    }
+}